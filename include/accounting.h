@@ -0,0 +1,97 @@
+#ifndef ACCOUNTING_H
+#define ACCOUNTING_H
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "process_manager.h"
+
+/**
+ * @brief Ressources consommées par une étape (processus ou commande interne).
+ */
+typedef struct {
+    char name[64];              ///< Nom de l'étape (argv[0]).
+    int exit_status;            ///< Code de retour de l'étape.
+    double real;                ///< Temps écoulé, en secondes.
+    struct rusage usage;        ///< CPU user/sys, RSS max, changements de contexte, E/S bloc.
+    struct timespec started;    ///< Début de la mesure (commandes internes).
+} StageUsage;
+
+/**
+ * @brief Ressources consommées par une commande au premier plan et ses étapes.
+ */
+typedef struct {
+    char command[256];          ///< Texte de la commande.
+    StageUsage total;           ///< Somme des étapes ; temps réel de la commande entière.
+    StageUsage *stages;         ///< Étapes, dans l'ordre du pipeline.
+    int num_stages;             ///< Nombre d'étapes.
+    int stages_cap;             ///< Capacité du tableau `stages`.
+    struct timespec started;    ///< Début de la commande.
+} CommandUsage;
+
+/**
+ * @brief Temps écoulé entre deux instants, en secondes.
+ */
+double elapsed_seconds(const struct timespec *start, const struct timespec *end);
+
+/**
+ * @brief Commence le relevé d'une nouvelle commande au premier plan.
+ *
+ * @param command Texte de la commande (peut être `NULL`).
+ */
+void accounting_begin(const char *command);
+
+/**
+ * @brief Termine le relevé en cours, qui devient celui affiché par `status -v`.
+ */
+void accounting_end();
+
+/**
+ * @brief Dernier relevé terminé (préfixe `time`, `status -v`).
+ *
+ * @return const CommandUsage* Le relevé, ou `NULL` si aucune commande n'a été mesurée.
+ */
+const CommandUsage *accounting_last();
+
+/**
+ * @brief Ajoute une étape au relevé en cours.
+ */
+void accounting_add(const StageUsage *stage);
+
+/**
+ * @brief Ajoute au relevé en cours un processus terminé d'un job.
+ */
+void accounting_add_process(const JobProcess *process);
+
+/**
+ * @brief Commence la mesure d'une commande interne exécutée dans le thread courant.
+ *
+ * @param stage Mesure à remplir.
+ * @param name Nom de la commande.
+ */
+void stage_usage_begin(StageUsage *stage, const char *name);
+
+/**
+ * @brief Termine la mesure : l'étape reçoit la consommation du thread depuis stage_usage_begin.
+ *
+ * @param stage Mesure commencée par stage_usage_begin, dans le même thread.
+ * @param exit_status Code de retour de la commande.
+ */
+void stage_usage_end(StageUsage *stage, int exit_status);
+
+/**
+ * @brief Affiche sur une ligne les ressources consommées par une étape.
+ *
+ * @param out Flux de sortie.
+ * @param stage Étape à afficher.
+ */
+void print_usage(FILE *out, const StageUsage *stage);
+
+/**
+ * @brief Affiche le relevé de la dernière commande au premier plan (`status -v`).
+ *
+ * @param out Flux de sortie.
+ */
+void print_last_usage(FILE *out);
+
+#endif // ACCOUNTING_H
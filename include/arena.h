@@ -0,0 +1,93 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @brief Bloc mémoire d'une arène.
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;  ///< Bloc alloué précédemment.
+    size_t size;              ///< Taille utile du bloc.
+    size_t used;              ///< Octets déjà distribués.
+    _Alignas(16) char data[]; ///< Zone distribuée par l'arène (malloc aligne le bloc sur 16).
+} ArenaChunk;
+
+/**
+ * @brief Allocateur par incrément de pointeur, libéré en une seule fois.
+ *
+ * Toutes les structures issues de l'analyse d'une ligne (jetons, arbre syntaxique,
+ * arguments) sont allouées dans une arène remise à zéro après l'exécution de la ligne.
+ */
+typedef struct {
+    ArenaChunk *head;  ///< Bloc courant (liste chaînée vers les plus anciens).
+} Arena;
+
+/**
+ * @brief Position dans une arène, pour libérer ce qui a été alloué depuis.
+ */
+typedef struct {
+    ArenaChunk *head;  ///< Bloc courant au moment du marquage.
+    size_t used;       ///< Octets distribués dans ce bloc.
+} ArenaMark;
+
+/**
+ * @brief Initialise une arène vide.
+ *
+ * @param arena Arène à initialiser.
+ */
+void arena_init(Arena *arena);
+
+/**
+ * @brief Alloue une zone alignée dans l'arène.
+ *
+ * @param arena Arène.
+ * @param size Taille demandée.
+ * @return void* Zone allouée, ou `NULL` si la mémoire est épuisée.
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Copie les `len` premiers caractères d'une chaîne dans l'arène.
+ *
+ * @param arena Arène.
+ * @param str Chaîne source.
+ * @param len Nombre de caractères à copier.
+ * @return char* Copie terminée par '\0', ou `NULL` si la mémoire est épuisée.
+ */
+char *arena_strndup(Arena *arena, const char *str, size_t len);
+
+/**
+ * @brief Mémorise la position courante de l'arène.
+ *
+ * @param arena Arène.
+ * @return ArenaMark Position à passer à arena_release.
+ */
+ArenaMark arena_mark(const Arena *arena);
+
+/**
+ * @brief Libère tout ce qui a été alloué depuis la position donnée.
+ *
+ * Les marques s'emboîtent comme une pile : une boucle libère ainsi la mémoire de
+ * chaque commande exécutée sans attendre la fin de la ligne.
+ *
+ * @param arena Arène.
+ * @param mark Position obtenue par arena_mark.
+ */
+void arena_release(Arena *arena, ArenaMark mark);
+
+/**
+ * @brief Libère d'un coup tout ce qui a été alloué, en conservant le premier bloc.
+ *
+ * @param arena Arène.
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * @brief Libère tous les blocs de l'arène.
+ *
+ * @param arena Arène.
+ */
+void arena_destroy(Arena *arena);
+
+#endif // ARENA_H
@@ -0,0 +1,26 @@
+#ifndef ARITHMETIC_H
+#define ARITHMETIC_H
+
+#include <stddef.h>
+
+/**
+ * @brief Évalue une expression arithmétique entière sur 64 bits.
+ *
+ * Opérateurs du C, par priorité croissante : `,`, affectations (`=`, `+=`, `-=`, `*=`,
+ * `/=`, `%=`, `<<=`, `>>=`, `&=`, `^=`, `|=`), `?:`, `||`, `&&`, `|`, `^`, `&`,
+ * `==` `!=`, `<` `<=` `>` `>=`, `<<` `>>`, `+` `-`, `*` `/` `%`, `**`, puis les
+ * opérateurs unaires `+ - ! ~`, `++`/`--` préfixes et suffixes et les parenthèses.
+ * Les constantes sont décimales, hexadécimales (`0x`) ou octales (`0`).
+ *
+ * Un nom désigne une variable, lue avec get_variable_value_n (0 si elle n'est pas
+ * définie ou vide) et modifiée avec set_local_variable. `&&`, `||` et `?:` sont
+ * évalués en court-circuit : la partie ignorée n'a aucun effet.
+ *
+ * @param expr Expression (pas forcément terminée par '\0').
+ * @param len Longueur de l'expression.
+ * @param result Reçoit la valeur de l'expression (0 pour une expression vide).
+ * @return int 0 si réussi, -1 en cas d'erreur (un message est affiché).
+ */
+int arith_evaluate(const char *expr, size_t len, long long *result);
+
+#endif // ARITHMETIC_H
@@ -0,0 +1,55 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "parser.h"
+
+/**
+ * @brief Signature d'une commande interne.
+ * 
+ * @param argc Nombre d'arguments (y compris le nom de la commande).
+ * @param argv Arguments, terminés par `NULL`.
+ * @param out Flux de sortie (seules les commandes BUILTIN_PIPEABLE l'utilisent,
+ *        les autres écrivent sur stdout).
+ * @return int Code de retour de la commande.
+ */
+typedef int (*BuiltinHandler)(int argc, char **argv, FILE *out);
+
+#define BUILTIN_PIPEABLE 0x1  ///< N'écrit que dans `out` : peut tourner dans un thread d'un pipeline.
+
+/**
+ * @brief Description d'une commande interne du shell.
+ */
+typedef struct {
+    const char *name;         ///< Nom de la commande.
+    BuiltinHandler handler;   ///< Fonction exécutant la commande.
+    int flags;                ///< Combinaison de BUILTIN_*.
+} Builtin;
+
+/**
+ * @brief Recherche une commande interne par son nom dans la table de hachage.
+ * 
+ * @param name Début du nom (pas forcément terminé par '\0').
+ * @param len Longueur du nom.
+ * @return const Builtin* La commande interne, ou `NULL` si ce n'en est pas une.
+ */
+const Builtin *find_builtin(const char *name, size_t len);
+
+/**
+ * @brief Exécute une commande interne dans le shell en appliquant ses redirections.
+ * 
+ * Les descripteurs 0, 1 et 2 sont sauvegardés, redirigés le temps de la commande,
+ * puis restaurés : aucun fork n'est nécessaire.
+ * 
+ * @param builtin Commande interne.
+ * @param argc Nombre d'arguments.
+ * @param argv Arguments étendus.
+ * @param arena Arène de la ligne en cours.
+ * @param redirections Redirections de la commande.
+ * @return int Code de retour de la commande.
+ */
+int run_builtin(const Builtin *builtin, int argc, char **argv,
+                Arena *arena, const Redirection *redirections);
+
+#endif // BUILTINS_H
@@ -0,0 +1,26 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stddef.h>
+
+/**
+ * @brief Commande interne `chunk [-j N] [-n N] commande [options] arguments...`.
+ *
+ * Lance la commande autant de fois qu'il le faut pour que chaque ligne de commande
+ * tienne dans ARG_MAX (environnement compris), à la manière de xargs : la commande
+ * et ses options de tête (arguments commençant par `-`, jusqu'à `--` inclus) sont
+ * répétées à chaque lot, les autres arguments sont répartis dans l'ordre. `-n N`
+ * limite le nombre d'arguments par lot, `-j N` lance jusqu'à N lots à la fois
+ * (`-j 0` : un par processeur). Les lancements s'arrêtent si un lot est interrompu.
+ *
+ * @return int 0 si tous les lots ont réussi, sinon le code du premier lot en échec.
+ */
+int chunk_run(int argc, char **argv);
+
+/**
+ * @brief Taille disponible pour les arguments d'une commande : ARG_MAX moins
+ * l'environnement du shell et une marge.
+ */
+size_t chunk_argument_budget();
+
+#endif // CHUNK_H
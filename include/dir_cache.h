@@ -0,0 +1,84 @@
+#ifndef DIR_CACHE_H
+#define DIR_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+/**
+ * @brief Entrée d'un répertoire lu.
+ */
+typedef struct {
+    uint32_t name;          ///< Début du nom dans `names`.
+    uint16_t len;           ///< Longueur du nom.
+    unsigned char type;     ///< d_type renvoyé par getdents64.
+} DirEntry;
+
+/**
+ * @brief Contenu d'un répertoire, tel que le cache le conserve.
+ *
+ * Une liste obtenue par dir_cache_read reste valide jusqu'à dir_cache_release,
+ * même si le cache la remplace ou l'évince entre-temps.
+ */
+typedef struct DirListing {
+    const char *names;      ///< Noms terminés par '\0', à la suite.
+    const DirEntry *entries;
+    size_t count;
+
+    dev_t dev;              ///< Clé : périphérique et inode du répertoire.
+    ino_t ino;
+    struct timespec mtime;  ///< Horodatages à la lecture, comparés à chaque utilisation.
+    struct timespec ctime;
+    bool racy;              ///< Modifié juste avant la lecture : les horodatages ne suffisent pas.
+    int watch;              ///< Surveillance inotify, ou -1.
+    size_t bytes;           ///< Mémoire occupée.
+    int refs;               ///< Utilisateurs en cours.
+    bool cached;            ///< Présent dans le cache (sinon libéré au dernier dir_cache_release).
+    struct DirListing *lru_prev;  ///< Plus récemment utilisé.
+    struct DirListing *lru_next;  ///< Moins récemment utilisé.
+    struct DirListing *hash_next;
+} DirListing;
+
+/**
+ * @brief Lit un répertoire ouvert, depuis le cache s'il n'a pas changé.
+ *
+ * Le répertoire est identifié par (st_dev, st_ino) et la liste en cache n'est
+ * utilisée que si son mtime et son ctime sont inchangés. Un répertoire modifié
+ * dans la seconde qui précède sa lecture n'est réutilisé que s'il est surveillé
+ * par inotify. Sinon il est relu par lots avec getdents64 et la liste remplace
+ * l'ancienne ; les moins récemment utilisées sont évincées au-delà de la limite
+ * d'entrées ou de mémoire. Peut être appelé par plusieurs threads.
+ *
+ * @param fd Descripteur du répertoire (O_DIRECTORY), positionné au début.
+ * @param buffer Tampon de lecture pour getdents64.
+ * @param size Taille du tampon.
+ * @return const DirListing* La liste, à rendre avec dir_cache_release, ou `NULL` en cas d'erreur.
+ */
+const DirListing *dir_cache_read(int fd, char *buffer, size_t size);
+
+/**
+ * @brief Rend une liste obtenue par dir_cache_read.
+ */
+void dir_cache_release(const DirListing *listing);
+
+/**
+ * @brief Vide le cache et remet les statistiques à zéro.
+ */
+void dir_cache_clear();
+
+/**
+ * @brief Active ou désactive l'invalidation par inotify.
+ *
+ * @return int 0 si réussi, -1 si inotify n'est pas disponible.
+ */
+int dir_cache_set_inotify(bool enabled);
+
+/**
+ * @brief Affiche l'occupation du cache et son taux de succès (`cache-stats`).
+ */
+void dir_cache_print_stats(FILE *out);
+
+#endif // DIR_CACHE_H
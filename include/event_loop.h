@@ -0,0 +1,47 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <signal.h>
+
+/**
+ * @brief Prépare la boucle d'événements du shell.
+ *
+ * SIGCHLD (et SIGINT si le shell est interactif) sont bloqués et reçus via un
+ * signalfd : aucun traitement n'a lieu dans un gestionnaire de signal.
+ *
+ * @param handle_sigint 1 pour recevoir aussi SIGINT par la boucle.
+ * @return int 0 si réussi, -1 sinon.
+ */
+int event_loop_init(int handle_sigint);
+
+/**
+ * @brief Attend que le descripteur soit lisible en traitant les signaux reçus entre-temps.
+ *
+ * Les enfants terminés sont récupérés au fil de l'eau (wait4) et leurs jobs mis à jour.
+ *
+ * @param fd Descripteur d'entrée des commandes.
+ * @return int 1 si `fd` est lisible, 0 si un SIGINT a interrompu l'attente.
+ */
+int event_loop_wait(int fd);
+
+/**
+ * @brief Récupère sans bloquer tous les enfants terminés ou stoppés.
+ */
+void reap_children();
+
+/**
+ * @brief Oublie les SIGINT reçus pendant une commande au premier plan.
+ */
+void event_loop_discard_interrupts();
+
+/**
+ * @brief Indique si un SIGINT est arrivé pendant que le shell exécutait lui-même du code.
+ *
+ * Le signal est consommé. Les boucles du shell interrogent cette fonction pour
+ * s'arrêter sur Ctrl+C même si leur corps ne lance que des commandes internes.
+ *
+ * @return int 1 si un SIGINT était en attente, 0 sinon.
+ */
+int event_loop_interrupted();
+
+#endif // EVENT_LOOP_H
@@ -1,11 +1,21 @@
 #ifndef EXECUTOR_H
 #define EXECUTOR_H
 
+#include "arena.h"
+#include "parser.h"
+#include "process_manager.h"
+#include <sys/types.h>
 
-int execute_command(char *command);
+char **expand_arguments(Arena *arena, const SimpleCommand *cmd, int *argc);
+void exec_program(int argc, char **args);
+pid_t launch_command(Arena *arena, int argc, char **args, const Redirection *redirections,
+                     int in_fd, int out_fd, int close_fd, Job *job);
+int execute_command(Arena *arena, const SimpleCommand *cmd, const char *text, int background);
+int execute_simple_node(Arena *arena, const Node *node);
+int execute_background_node(Arena *arena, const Node *node);
+int execute_node(Arena *arena, const Node *node);
 void execute_myjobs();
 void execute_myfg(int job_id);
 void execute_mybg(int job_id);
-void substitute_variables(char *command);
 
 #endif // EXECUTOR_H
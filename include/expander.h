@@ -0,0 +1,58 @@
+#ifndef EXPANDER_H
+#define EXPANDER_H
+
+#include <stdbool.h>
+#include "arena.h"
+
+/**
+ * @brief Étend un mot de l'arbre syntaxique : paramètres, puis retrait des guillemets.
+ *
+ * Formes reconnues : `$nom`, `${nom}`, `${nom:-défaut}`, `${#nom}`, `$?`, `$$`, `$!`,
+ * les paramètres positionnels d'une fonction (`$0` à `$9`, `${10}`, `$#`, `$@` et `$*`,
+ * ces deux derniers joints par des espaces) et `$((expression))`, remplacé par la
+ * valeur de l'expression arithmétique.
+ * Rien n'est étendu entre guillemets simples ; entre guillemets doubles, `\$`
+ * protège le `$`. Un mot sans `$` ni guillemets est renvoyé tel quel, sans copie ;
+ * sinon le résultat est écrit dans un tampon de l'arène.
+ *
+ * @param arena Arène de la ligne en cours.
+ * @param word Mot brut.
+ * @return char* Le mot étendu, ou `NULL` en cas d'erreur (expansion invalide ou
+ *         échec d'allocation, un message est alors affiché).
+ */
+char *expand_word(Arena *arena, const char *word);
+
+/**
+ * @brief Étend un mot qui contient des jokers en motif pour expand_wildcard.
+ *
+ * Comme expand_word, mais les caractères protégés par des guillemets ou un `\`
+ * (valeurs de paramètres entre guillemets doubles comprises) qui ont un sens pour
+ * les jokers (`*`, `?`, `[`, `]`, `\`) sont précédés d'un `\` : `"*"x*` donne
+ * `\*x*`, qui ne désigne que les noms commençant par `*x`.
+ *
+ * Le mot n'est étendu qu'une fois : `literal` reçoit en même temps le résultat
+ * d'expand_word, à garder si aucun fichier ne correspond (`$((i++))*` n'incrémente
+ * `i` qu'une fois).
+ *
+ * @return char* Le motif, ou `NULL` en cas d'erreur (message affiché).
+ */
+char *expand_pattern(Arena *arena, const char *word, char **literal);
+
+/**
+ * @brief Indique si un mot contient un joker (`*`, `?`, `[`) hors guillemets et non échappé.
+ *
+ * Le `?` de `$?`, le `*` de `$*` et le contenu des `${...}` et `$((...))` ne sont pas des jokers.
+ *
+ * @param word Mot brut issu de l'analyseur.
+ * @return bool `true` si le mot doit être étendu par expand_wildcard.
+ */
+bool has_unquoted_wildcard(const char *word);
+
+/**
+ * @brief Indique si le mot ne contient aucun guillemet ni caractère échappé.
+ *
+ * Un tel mot qui s'étend en chaîne vide (`$INCONNUE`) ne produit aucun argument.
+ */
+bool is_unquoted_word(const char *word);
+
+#endif // EXPANDER_H
@@ -0,0 +1,87 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "parser.h"
+
+/**
+ * @brief Arbre syntaxique compilé en une suite d'instructions.
+ */
+typedef struct Program Program;
+
+/**
+ * @brief Fonction définie par `nom() { ... }`.
+ */
+typedef struct Function Function;
+
+/**
+ * @brief Compile un arbre syntaxique en programme pour l'interpréteur.
+ *
+ * Les structures de contrôle (`&&`, `||`, `if`, `while`, `until`, `for`, `break`,
+ * `continue`, `return`) deviennent des sauts ; les commandes simples et les
+ * pipelines restent des feuilles qui pointent vers l'arbre, sans le modifier.
+ * Le corps d'une boucle n'est donc analysé et compilé qu'une fois.
+ *
+ * @param arena Arène recevant le programme.
+ * @param root Racine de l'arbre.
+ * @return Program* Le programme, ou `NULL` si la mémoire est épuisée.
+ */
+Program *compile_program(Arena *arena, const Node *root);
+
+/**
+ * @brief Exécute un programme compilé.
+ *
+ * La mémoire allouée par chaque commande (arguments étendus) est rendue à
+ * l'arène dès la fin de la commande. Un Ctrl+C arrête le programme.
+ *
+ * @param arena Arène de la ligne en cours.
+ * @param program Programme à exécuter.
+ * @return int Le code de retour de la dernière commande exécutée.
+ */
+int run_program(Arena *arena, const Program *program);
+
+/**
+ * @brief Recherche une fonction définie par son nom.
+ *
+ * @param name Nom de la fonction.
+ * @return Function* La fonction, ou `NULL` si aucune fonction ne porte ce nom.
+ */
+Function *find_function(const char *name);
+
+/**
+ * @brief Appelle une fonction avec ses arguments comme paramètres positionnels.
+ *
+ * @param arena Arène de la ligne en cours.
+ * @param function Fonction à appeler.
+ * @param argc Nombre d'arguments (nom de la fonction compris).
+ * @param args Arguments étendus ; `args[0]` est le nom de la fonction.
+ * @param redirections Redirections de l'appel, appliquées le temps de la fonction.
+ * @return int Le code de retour de la fonction.
+ */
+int call_function(Arena *arena, Function *function, int argc, char **args, const Redirection *redirections);
+
+/**
+ * @brief Paramètre positionnel de la fonction en cours (`$0`, `$1`...).
+ *
+ * Hors d'une fonction, `$0` vaut `mysh` et il n'y a aucun autre paramètre.
+ *
+ * @param index Numéro du paramètre.
+ * @param len Reçoit la longueur de la valeur.
+ * @return const char* La valeur, chaîne vide si le paramètre n'existe pas.
+ */
+const char *positional_parameter(size_t index, size_t *len);
+
+/**
+ * @brief Nombre de paramètres positionnels (`$#`).
+ */
+size_t positional_count();
+
+/**
+ * @brief Paramètres positionnels séparés par des espaces (`$@`, `$*`).
+ *
+ * @param len Reçoit la longueur de la valeur.
+ */
+const char *positional_joined(size_t *len);
+
+#endif // INTERPRETER_H
@@ -0,0 +1,16 @@
+#ifndef MYDU_H
+#define MYDU_H
+
+#include <stdio.h>
+
+/**
+ * @brief Commande interne `mydu [-s] [-x] [-d N] [-j N] [chemins...]`.
+ *
+ * Affiche l'espace disque occupé (en Kio, comme du) par chaque répertoire des
+ * arborescences données, sous-répertoires avant leur parent.
+ *
+ * @return int 0 si tout a pu être lu, 1 sinon, 2 pour une option invalide.
+ */
+int mydu_run(int argc, char *argv[], FILE *out);
+
+#endif // MYDU_H
@@ -1,6 +1,8 @@
 #ifndef MYLS_H
 #define MYLS_H
 
-void myls_run(int argc, char *argv[]);
+#include <stdio.h>
+
+int myls_run(int argc, char *argv[], FILE *out);
 
 #endif
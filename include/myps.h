@@ -1,8 +1,10 @@
 #ifndef MYPS_H
 #define MYPS_H
 
+#include <stdio.h>
+
 const char* get_color(int state);
-void myps();
+void myps(FILE *out);
 
 
 #endif // MYPS_H
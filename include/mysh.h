@@ -2,25 +2,22 @@
 #define MYSH_H
 
 #include <sys/types.h>
+#include <signal.h>
 
-/**
- * @brief Gère le signal SIGCHLD pour détecter les processus terminés.
- * 
- * @param sig Signal reçu.
- */
-void handle_sigchld(int sig);
+#define MAX_COMMAND_LENGTH 100
 
-/**
- * @brief Gère le signal SIGTSTP pour arrêter un processus en avant-plan.
- * 
- * @param sig Signal reçu.
- */
-void handle_sigtstp(int sig);
+extern int interactive;                          ///< 1 si les commandes sont lues depuis un terminal.
+extern int last_status;                          ///< Code de retour de la dernière commande.
+extern pid_t shell_pid;                          ///< PID du shell (`$$`).
+extern char last_command_name[MAX_COMMAND_LENGTH];  ///< Texte de la dernière commande (pour `status`).
+extern volatile sig_atomic_t foreground_running; ///< 1 pendant l'exécution d'une commande au premier plan.
 
 /**
  * @brief Boucle principale du shell.
+ * 
+ * @param input_fd Descripteur d'où sont lues les commandes (terminal, fichier ou pipe).
  */
-void run_shell();
+void run_shell(int input_fd);
 
 /**
  * @brief Change le répertoire de travail.
@@ -2,20 +2,128 @@
 #define PARSER_H
 
 #include <stdbool.h>
+#include "arena.h"
 
+/**
+ * @brief Types de redirection reconnus par l'analyseur.
+ */
 typedef enum {
-    COND_SUCCESS,  // Corresponds to &&
-    COND_FAILURE,  // Corresponds to ||
-    COND_ALWAYS    // Corresponds to ;
-} ConditionType;
+    REDIR_INPUT,             // Corresponds to <
+    REDIR_OUTPUT,            // Corresponds to >
+    REDIR_APPEND,            // Corresponds to >>
+    REDIR_ERROR,             // Corresponds to 2>
+    REDIR_ERROR_APPEND,      // Corresponds to 2>>
+    REDIR_OUTPUT_ERROR,      // Corresponds to >&
+    REDIR_OUTPUT_ERROR_APPEND // Corresponds to >>&
+} RedirectionType;
 
+/**
+ * @brief Redirection attachée à une commande simple.
+ */
+typedef struct Redirection {
+    RedirectionType type;       ///< Type de redirection.
+    char *target;               ///< Mot désignant le fichier (guillemets conservés).
+    struct Redirection *next;   ///< Redirection suivante, dans l'ordre de la ligne.
+} Redirection;
+
+/**
+ * @brief Commande simple : une liste de mots et ses redirections.
+ */
 typedef struct {
-    char *command;
-    ConditionType condition;
-} ParsedCommand;
+    int argc;                   ///< Nombre de mots.
+    char **argv;                ///< Mots bruts (guillemets conservés), terminés par `NULL`.
+    Redirection *redirections;  ///< Redirections, dans l'ordre de la ligne.
+} SimpleCommand;
+
+typedef enum {
+    NODE_COMMAND,     // Simple command
+    NODE_PIPELINE,    // Corresponds to |
+    NODE_AND,         // Corresponds to &&
+    NODE_OR,          // Corresponds to ||
+    NODE_SEQUENCE,    // Corresponds to ; or a newline
+    NODE_BACKGROUND,  // Corresponds to a trailing &
+    NODE_IF,          // if ... then ... [elif ... then ...] [else ...] fi
+    NODE_WHILE,       // while/until ... do ... done
+    NODE_FOR,         // for name [in words] do ... done
+    NODE_GROUP,       // { list; }
+    NODE_FUNCTION     // name() compound-command
+} NodeType;
+
+/**
+ * @brief Nœud de l'arbre syntaxique d'une ligne de commande.
+ */
+typedef struct Node {
+    NodeType type;
+    char *text;  ///< Texte source de la commande ou du pipeline (pour les messages et les jobs).
+    bool timed;  ///< Préfixe `time` : afficher les ressources consommées (NODE_COMMAND, NODE_PIPELINE).
+    union {
+        SimpleCommand command;                                  ///< NODE_COMMAND
+        struct { int num_stages; SimpleCommand *stages; } pipeline; ///< NODE_PIPELINE
+        struct { struct Node *left; struct Node *right; } binary;   ///< NODE_AND, NODE_OR, NODE_SEQUENCE
+        struct Node *child;                                     ///< NODE_BACKGROUND, NODE_GROUP
+        struct {
+            struct Node *condition;
+            struct Node *then_part;
+            struct Node *else_part;   ///< `NULL`, liste du `else`, ou NODE_IF pour un `elif`.
+        } if_clause;                                            ///< NODE_IF
+        struct {
+            struct Node *condition;
+            struct Node *body;
+            bool until;               ///< Boucle tant que la condition échoue (`until`).
+        } loop;                                                 ///< NODE_WHILE
+        struct {
+            char *variable;           ///< Variable de boucle.
+            int num_words;            ///< Nombre de mots après `in`.
+            char **words;             ///< Mots bruts, ou `NULL` sans `in` (paramètres positionnels).
+            struct Node *body;
+        } for_loop;                                             ///< NODE_FOR
+        struct {
+            char *name;
+            struct Node *body;        ///< Commande composée formant le corps.
+        } function;                                             ///< NODE_FUNCTION
+    };
+} Node;
+
+/**
+ * @brief Résultat de l'analyse d'une entrée.
+ */
+typedef enum {
+    PARSE_OK,          ///< Entrée complète et valide (éventuellement vide).
+    PARSE_ERROR,       ///< Erreur de syntaxe, déjà signalée.
+    PARSE_INCOMPLETE   ///< Commande composée non terminée : il faut lire la ligne suivante.
+} ParseStatus;
+
+/**
+ * @brief Analyse une ligne en un arbre syntaxique, en une seule passe.
+ * 
+ * Tous les nœuds et les mots sont alloués dans l'arène fournie.
+ * 
+ * @param arena Arène recevant l'arbre.
+ * @param input Ligne(s) à analyser (non modifiées).
+ * @param status Reçoit PARSE_OK, PARSE_ERROR (un message est alors affiché) ou
+ *        PARSE_INCOMPLETE si une commande composée (`if`, `while`, `for`, `{`,
+ *        fonction) n'est pas terminée.
+ * @return Node* Racine de l'arbre, ou `NULL` si l'entrée est vide, invalide ou incomplète.
+ */
+Node *parse_input(Arena *arena, const char *input, ParseStatus *status);
+
+/**
+ * @brief Cherche l'accolade qui ferme un `${`, en sautant les guillemets et les `${...}` imbriqués.
+ * 
+ * @param s Texte qui suit le `${`.
+ * @return const char* L'accolade fermante, ou `NULL` s'il n'y en a pas.
+ */
+const char *find_closing_brace(const char *s);
+
+/**
+ * @brief Cherche la fin d'un `$((...))`, en tenant compte des parenthèses imbriquées.
+ * 
+ * @param s Texte qui suit le `$((`.
+ * @return const char* La première des deux parenthèses fermantes, ou `NULL` s'il n'y en a pas.
+ */
+const char *find_arithmetic_end(const char *s);
 
 void remove_quotes(char *str);
-ParsedCommand *parse_input(char *input, int *num_commands);
 void trim_whitespace(char *str);
 
 
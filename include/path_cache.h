@@ -0,0 +1,26 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+/**
+ * @brief Résout le chemin absolu d'une commande en parcourant $PATH, avec mise en cache.
+ * 
+ * Le cache est vidé automatiquement lorsque la valeur de $PATH change.
+ * Les noms contenant un '/' sont renvoyés tels quels.
+ * 
+ * @param name Nom de la commande.
+ * @return const char* Chemin de l'exécutable (valide jusqu'au prochain vidage du cache),
+ *         ou `NULL` si la commande est introuvable.
+ */
+const char *path_cache_lookup(const char *name);
+
+/**
+ * @brief Vide le cache des chemins (`hash -r`).
+ */
+void path_cache_clear();
+
+/**
+ * @brief Affiche le contenu du cache (`hash`).
+ */
+void path_cache_list();
+
+#endif // PATH_CACHE_H
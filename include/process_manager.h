@@ -2,52 +2,216 @@
 #define PROCESS_MANAGER_H
 
 #include <sys/types.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <pthread.h>
+
+#define PROCESS_RUNNING 0  ///< Le processus s'exécute.
+#define PROCESS_STOPPED 1  ///< Le processus est stoppé (Ctrl+Z, SIGTTIN, ...).
+#define PROCESS_DONE 2     ///< Le processus est terminé et récupéré.
 
 /**
- * @brief Structure représentant un job en arrière-plan.
+ * @brief Processus appartenant à un job.
  */
 typedef struct {
-    int job_id;         ///< Identifiant unique du job.
-    pid_t pid;          ///< PID du processus associé.
-    char command[256];  ///< Commande exécutée.
-    int running;        ///< 1 si en cours d'exécution, 0 si stoppé.
+    pid_t pid;                  ///< PID du processus.
+    char name[64];              ///< Nom de la commande (argv[0]).
+    int state;                  ///< PROCESS_RUNNING, PROCESS_STOPPED ou PROCESS_DONE.
+    int exit_status;            ///< Code de retour (ou 128 + signal) une fois terminé.
+    struct timespec started;    ///< Lancement du processus (horloge monotone).
+    struct timespec finished;   ///< Récupération du processus terminé.
+    struct rusage usage;        ///< Ressources consommées, relevées par wait4 à la fin.
+} JobProcess;
+
+/**
+ * @brief Thread du shell rattaché à un job stoppé (commande interne au milieu
+ * d'un pipeline), joint quand le job est retiré.
+ */
+typedef struct JobThread {
+    pthread_t thread;
+    pid_t owner;            ///< Processus qui a créé le thread (un fork n'en hérite pas).
+    void *data;             ///< Données du thread, libérées après pthread_join.
+    struct JobThread *next;
+} JobThread;
+
+/**
+ * @brief Structure représentant un job : une commande ou un pipeline complet.
+ *
+ * Lorsque le contrôle des jobs est actif (shell interactif), tous les processus
+ * d'un job partagent un groupe de processus, qui reçoit le terminal quand le job
+ * est au premier plan : Ctrl+Z, Ctrl+C, `myfg` et `mybg` agissent sur tout le pipeline.
+ */
+typedef struct Job {
+    int job_id;             ///< Identifiant du job (0 tant qu'il n'est pas enregistré).
+    pid_t pgid;             ///< Groupe de processus du job (0 avant le premier processus).
+    int own_group;          ///< 1 si le job a son propre groupe de processus.
+    int foreground;         ///< 1 si le job est au premier plan.
+    char *command;          ///< Commande exécutée.
+    JobProcess *procs;      ///< Processus du job, dans l'ordre du pipeline.
+    int num_procs;          ///< Nombre de processus.
+    int procs_cap;          ///< Capacité du tableau `procs`.
+    int running;            ///< 1 si en cours d'exécution, 0 si stoppé.
+    int done;               ///< 1 si tous les processus sont terminés mais le job pas encore signalé.
+    int exit_status;        ///< Code de retour du dernier processus une fois terminé.
+    JobThread *threads;     ///< Threads à joindre quand le job est retiré.
+    struct Job *prev;       ///< Job enregistré précédent (identifiants croissants).
+    struct Job *next;       ///< Job enregistré suivant.
+    struct Job *id_next;    ///< Suivant dans la même case de l'index par identifiant.
 } Job;
 
-extern Job jobs[];     ///< Tableau global des jobs.
-extern int job_count;  ///< Nombre total de jobs.
+extern int job_count;  ///< Nombre de jobs enregistrés.
+extern pid_t last_background_pid;  ///< Dernier processus lancé en arrière-plan (`$!`), 0 si aucun.
+
+/**
+ * @brief Active le contrôle des jobs sur le terminal donné.
+ *
+ * Le shell se place dans son propre groupe de processus, prend le terminal et
+ * ignore SIGTSTP, SIGTTIN et SIGTTOU ; chaque job lancé ensuite a son propre groupe.
+ *
+ * @param fd Descripteur du terminal.
+ * @return int 0 si réussi, -1 sinon (les jobs restent alors dans le groupe du shell).
+ */
+int job_control_init(int fd);
+
+/**
+ * @brief Désactive le contrôle des jobs (dans un sous-shell forké).
+ */
+void job_control_disable();
+
+/**
+ * @brief Crée un job vide, pas encore enregistré dans la table.
+ *
+ * @param command Texte de la commande (peut être `NULL`).
+ * @param foreground 1 si le job sera attendu au premier plan.
+ * @return Job* Le job créé, ou `NULL` en cas d'échec d'allocation.
+ */
+Job *job_create(const char *command, int foreground);
+
+/**
+ * @brief Groupe de processus à donner au prochain processus du job.
+ *
+ * @param job Job en cours de lancement.
+ * @return pid_t -1 si le job n'a pas de groupe propre, 0 pour créer le groupe
+ *         (premier processus), sinon le groupe à rejoindre.
+ */
+pid_t job_next_pgid(const Job *job);
+
+/**
+ * @brief Terminal à donner au groupe du job lors du lancement.
+ *
+ * @param job Job en cours de lancement.
+ * @return int Descripteur du terminal, ou -1 si le job ne doit pas le prendre.
+ */
+int job_terminal(const Job *job);
 
 /**
- * @brief Ajoute un nouveau job à la liste des jobs.
- * 
+ * @brief Prépare un enfant forké pour le job : groupe de processus, terminal,
+ * signaux de contrôle des jobs remis par défaut et masque de signaux vidé.
+ *
+ * @param job Job auquel appartient l'enfant (peut être `NULL`).
+ */
+void job_setup_child(const Job *job);
+
+/**
+ * @brief Ajoute un processus lancé au job et l'indexe par son PID.
+ *
+ * @param job Job concerné.
  * @param pid PID du processus.
- * @param command Commande associée au job.
+ * @param name Nom de la commande, pour les relevés de ressources.
+ * @return int 0 si réussi, -1 en cas d'échec d'allocation.
+ */
+int job_add_process(Job *job, pid_t pid, const char *name);
+
+/**
+ * @brief Rattache un thread du shell à un job, pour qu'il soit joint (et `data`
+ * libéré) quand le job se termine ou est tué, sans bloquer le shell entre-temps.
+ *
+ * @return int 0 si réussi, -1 en cas d'échec d'allocation.
+ */
+int job_add_thread(Job *job, pthread_t thread, void *data);
+
+/**
+ * @brief Attend un job au premier plan jusqu'à sa fin ou son arrêt.
+ *
+ * Les processus sont récupérés avec wait4, qui fournit leur consommation de ressources.
+ * Un job terminé est libéré ; un job stoppé (Ctrl+Z) est enregistré dans la table.
+ *
+ * @param job Job à attendre.
+ * @param results Reçoit une copie de chaque processus (code, ressources), dans l'ordre
+ *        d'ajout, ou `NULL`. Un processus stoppé a le code 128 + SIGTSTP.
+ * @return int Le code de retour du dernier processus, ou 128 + SIGTSTP si le job a été stoppé.
+ */
+int wait_for_job(Job *job, JobProcess *results);
+
+/**
+ * @brief Attend qu'un seul processus d'un job au premier plan se termine ou s'arrête.
+ *
+ * Permet de garder un nombre fixe de processus en cours dans un même job (`chunk -j`) :
+ * le suivant est lancé dès qu'une place se libère. Les enfants d'autres jobs
+ * récupérés au passage sont mis à jour. Le terminal reste au groupe du job ;
+ * wait_for_job termine l'attente et le rend au shell.
+ *
+ * @param job Job à attendre.
+ * @return int Indice du processus dans `job->procs`, ou -1 si aucun n'est en cours.
+ */
+int wait_for_job_process(Job *job);
+
+/**
+ * @brief Enregistre un job lancé en arrière-plan et affiche son identifiant.
+ *
+ * @param job Job à enregistrer (libéré s'il n'a aucun processus).
+ */
+void put_job_in_background(Job *job);
+
+/**
+ * @brief Retire un job de la table et libère sa mémoire.
+ *
+ * Les threads rattachés au job sont joints : ses processus étant terminés, un
+ * thread qui écrivait dans leurs pipes reçoit EPIPE et se termine.
+ *
+ * @param job Job à retirer (enregistré ou non).
+ */
+void remove_job(Job *job);
+
+/**
+ * @brief Met à jour un job après un changement d'état signalé par wait4.
+ *
+ * Appelée depuis la boucle d'événements (jamais depuis un gestionnaire de signal).
+ *
+ * @param pid PID du processus concerné.
+ * @param status Statut renvoyé par wait4 (terminé, tué, stoppé ou relancé).
+ * @param usage Ressources consommées par le processus, s'il est terminé.
  */
-void add_job(pid_t pid, const char *command);
+void job_status_changed(pid_t pid, int status, const struct rusage *usage);
 
 /**
- * @brief Supprime un job de la liste en fonction de son PID.
- * 
- * @param pid PID du processus à supprimer.
+ * @brief Signale les jobs terminés depuis le dernier prompt et les retire de la liste.
+ *
+ * @param print 1 pour afficher une ligne par job terminé.
  */
-void remove_job(pid_t pid);
+void notify_jobs(int print);
 
 /**
  * @brief Affiche la liste des jobs actifs.
+ *
+ * @param verbose 1 pour détailler chaque processus et ses ressources (`myjobs -v`).
  */
-void list_jobs();
+void list_jobs(int verbose);
 
 /**
- * @brief Ramène un job en avant-plan.
- * 
- * @param job_id Identifiant du job à ramener en avant-plan.
+ * @brief Ramène un job en avant-plan et l'attend.
+ *
+ * @param job_id Identifiant du job (0 pour le plus récent).
+ * @return int Code de retour du job, ou 1 s'il n'existe pas.
  */
-void bring_job_to_foreground(int job_id);
+int bring_job_to_foreground(int job_id);
 
 /**
- * @brief Déplace un job en arrière-plan.
- * 
- * @param job_id Identifiant du job à déplacer en arrière-plan.
+ * @brief Relance un job stoppé en arrière-plan.
+ *
+ * @param job_id Identifiant du job (0 pour le plus récent).
+ * @return int 0 si réussi, 1 sinon.
  */
-void move_job_to_background(int job_id);
+int move_job_to_background(int job_id);
 
 #endif // PROCESS_MANAGER_H
@@ -0,0 +1,54 @@
+#ifndef READER_H
+#define READER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define READER_EOF -1          ///< Fin de l'entrée ou erreur de lecture.
+#define READER_INTERRUPTED -2  ///< L'attente de données a été interrompue (SIGINT).
+
+/**
+ * @brief Lecteur de lignes bufferisé sur un descripteur de fichier.
+ *
+ * Les données sont lues par blocs et découpées ligne par ligne, sans limite
+ * de longueur : la ligne courante est stockée dans un tampon qui grandit au besoin.
+ */
+typedef struct {
+    int fd;             ///< Descripteur lu.
+    char *buf;          ///< Tampon de lecture.
+    size_t buf_len;     ///< Nombre d'octets valides dans le tampon.
+    size_t buf_pos;     ///< Position du prochain octet non consommé.
+    size_t buf_cap;     ///< Capacité du tampon de lecture.
+    char *line;         ///< Dernière ligne lue, terminée par '\0' (sans le '\n').
+    size_t line_cap;    ///< Capacité du tampon de ligne.
+    int eof;            ///< 1 lorsque la fin du fichier a été atteinte.
+    int (*wait_input)(int fd);  ///< Attente avant chaque read (0 = interrompue), ou `NULL`.
+} LineReader;
+
+/**
+ * @brief Initialise un lecteur sur le descripteur donné.
+ *
+ * @param reader Lecteur à initialiser.
+ * @param fd Descripteur de fichier à lire.
+ * @return int 0 si réussi, -1 en cas d'échec d'allocation.
+ */
+int reader_init(LineReader *reader, int fd);
+
+/**
+ * @brief Lit la ligne suivante.
+ *
+ * @param reader Lecteur initialisé.
+ * @param line Reçoit un pointeur vers la ligne, valide jusqu'au prochain appel.
+ * @return ssize_t Longueur de la ligne, READER_EOF à la fin de l'entrée ou en cas d'erreur,
+ *         ou READER_INTERRUPTED si l'attente a été interrompue (la ligne partielle est abandonnée).
+ */
+ssize_t reader_getline(LineReader *reader, char **line);
+
+/**
+ * @brief Libère les tampons du lecteur (le descripteur n'est pas fermé).
+ *
+ * @param reader Lecteur à libérer.
+ */
+void reader_free(LineReader *reader);
+
+#endif // READER_H
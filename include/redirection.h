@@ -1,9 +1,18 @@
 #ifndef REDIRECTION_H
 #define REDIRECTION_H
 
+#include "arena.h"
+#include "parser.h"
+#include <spawn.h>
 
-void handle_redirection(char *command);
-int handle_pipeline(char *command);
+extern int pipefail_enabled;  ///< 1 si un pipeline renvoie le dernier code non nul de ses étapes.
 
-#endif // REDIRECTION_H
+int save_fd(int fd);
+void restore_fd(int saved, int fd);
+int apply_redirections(Arena *arena, const Redirection *redirections);
+int add_redirection_actions(Arena *arena, posix_spawn_file_actions_t *actions, const Redirection *redirections);
+int status_to_exit_code(int status);
+int handle_pipeline(Arena *arena, const SimpleCommand *stages, int num_commands,
+                    const char *text, int background);
 
+#endif // REDIRECTION_H
@@ -0,0 +1,61 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <sys/types.h>
+#include <time.h>
+
+extern int trace_enabled;  ///< 1 si les événements sont enregistrés.
+
+/**
+ * @brief Démarre l'enregistrement d'une trace au format Chrome trace-event.
+ *
+ * Le fichier obtenu (tableau JSON d'événements "X") se charge dans
+ * chrome://tracing ou Perfetto. Une trace déjà ouverte est d'abord terminée.
+ *
+ * @param path Fichier de sortie.
+ * @return int 0 si réussi, -1 sinon.
+ */
+int trace_start(const char *path);
+
+/**
+ * @brief Termine la trace en cours et écrit la fin du fichier.
+ */
+void trace_stop();
+
+/**
+ * @brief Abandonne la trace dans un enfant forké, sans rien écrire.
+ *
+ * Le tampon hérité du shell ne doit pas être vidé une seconde fois par l'enfant.
+ */
+void trace_drop_in_child();
+
+/**
+ * @brief Début d'un intervalle.
+ *
+ * @return long long Horodatage en microsecondes, ou 0 si la trace est inactive.
+ */
+long long trace_begin();
+
+/**
+ * @brief Enregistre l'intervalle commencé par trace_begin, dans le thread courant.
+ *
+ * @param start Valeur renvoyée par trace_begin (rien n'est écrit si elle vaut 0).
+ * @param category Catégorie de l'événement (`shell`, `expand`, `process`, `builtin`).
+ * @param name Nom de l'événement.
+ * @param detail Texte associé (commande, motif...), ou `NULL`.
+ */
+void trace_end(long long start, const char *category, const char *name, const char *detail);
+
+/**
+ * @brief Enregistre la durée de vie d'un processus enfant, sur sa propre piste.
+ *
+ * @param pid PID de l'enfant.
+ * @param name Nom de la commande.
+ * @param started Lancement (horloge monotone).
+ * @param finished Fin (horloge monotone).
+ * @param exit_status Code de retour.
+ */
+void trace_process(pid_t pid, const char *name, const struct timespec *started,
+                   const struct timespec *finished, int exit_status);
+
+#endif // TRACE_H
@@ -1,6 +1,8 @@
 #ifndef VARIABLES_H
 #define VARIABLES_H
 
+#include <stddef.h>
+
 void init_shared_memory();
 void destroy_shared_memory();
 void set_local_variable(const char *name, const char *value);
@@ -10,6 +12,9 @@ void set_env_variable(const char *name, const char *value);
 void unset_env_variable(const char *name);
 void list_env_variables();
 char *get_variable_value(const char *name);
+char *get_variable_value_n(const char *name, size_t name_len, size_t *value_len);
+char **get_environment();
+const char *get_environment_value(const char *name);
 void save_shared_memory();
 void load_shared_memory();
 
@@ -2,9 +2,53 @@
 #define WILDCARD_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+/**
+ * @brief Forme d'un motif compilé, qui choisit la méthode de comparaison.
+ */
+typedef enum {
+    GLOB_LITERAL,        ///< Aucun joker : comparaison exacte.
+    GLOB_ANY,            ///< `*` : tout nom convient.
+    GLOB_PREFIX,         ///< `début*` : memcmp du préfixe.
+    GLOB_SUFFIX,         ///< `*.ext` : memcmp du suffixe.
+    GLOB_PREFIX_SUFFIX,  ///< `début*fin` : memcmp des deux bouts.
+    GLOB_GENERAL         ///< `?`, classes `[...]` ou plusieurs `*` : automate.
+} GlobKind;
+
+/**
+ * @brief Élément d'un motif général : `*`, ou un caractère décrit par l'ensemble
+ * des octets qu'il accepte (littéral, `?` ou classe `[...]`).
+ */
+typedef struct {
+    bool star;
+    uint64_t accept[4];  ///< Octets acceptés (bit c de accept[c / 64]).
+} GlobToken;
+
+/**
+ * @brief Motif compilé une fois, puis comparé à chaque entrée d'un répertoire.
+ */
+typedef struct {
+    GlobKind kind;
+    char *literal;       ///< Parties littérales : préfixe puis suffixe, ou nom exact
+                         ///< (motif général : texte fixe au début et à la fin).
+    size_t prefix_len;
+    size_t suffix_len;
+    GlobToken *tokens;   ///< Motif général.
+    int num_tokens;
+    size_t min_len;      ///< Motif général : longueur minimale d'un nom (éléments autres que `*`).
+    bool has_star;       ///< Motif général : contient au moins un `*`.
+    uint64_t *char_masks; ///< Motif général de moins de 64 éléments : pour chaque octet,
+                          ///< les éléments qui l'acceptent (`NULL` sinon).
+    uint64_t star_mask;  ///< Éléments `*` (avec `char_masks`).
+    bool match_dot;      ///< Le motif commence par un `.` : les fichiers cachés peuvent correspondre.
+} GlobPattern;
+
+int glob_compile(GlobPattern *glob, const char *pattern, size_t len);
+bool glob_match(const GlobPattern *glob, const char *name, size_t len);
+void glob_free(GlobPattern *glob);
 char **expand_wildcard(const char *pattern, int *num_matches);
-bool is_escaped(const char *pattern, int index);
 void free_matches(char **matches, int num_matches);
 
 #endif
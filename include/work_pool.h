@@ -0,0 +1,52 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdbool.h>
+
+typedef struct WorkPool WorkPool;
+
+/**
+ * @brief Traite une tâche ; peut en ajouter d'autres avec work_pool_push.
+ *
+ * @param worker Numéro du thread (0 à num_workers - 1), pour choisir son état propre.
+ */
+typedef void (*WorkFunction)(WorkPool *pool, int worker, void *item, void *context);
+
+/**
+ * @brief Crée un groupe de threads à vol de tâches (work stealing).
+ *
+ * Chaque thread a sa propre file : il y ajoute les tâches qu'il crée et prend
+ * d'abord la plus récente (parcours en profondeur, répertoires encore en cache) ;
+ * un thread sans travail vole la plus ancienne tâche d'un autre. Le groupe se
+ * termine quand il n'y a plus de tâche en file ni en cours.
+ *
+ * @return WorkPool* Le groupe, ou `NULL` si la mémoire manque.
+ */
+WorkPool *work_pool_create(int num_workers, WorkFunction function, void *context);
+
+/**
+ * @brief Ajoute une tâche à la file du thread `worker` (0 avant work_pool_start).
+ *
+ * @return bool `false` si la mémoire manque : la tâche n'est pas ajoutée.
+ */
+bool work_pool_push(WorkPool *pool, int worker, void *item);
+
+/**
+ * @brief Démarre les threads.
+ *
+ * @return int Le nombre de threads démarrés (0 si aucun n'a pu l'être).
+ */
+int work_pool_start(WorkPool *pool);
+
+/**
+ * @brief Attend la fin de toutes les tâches ; si aucun thread n'a démarré, elles
+ * sont traitées par le thread appelant.
+ */
+void work_pool_wait(WorkPool *pool);
+
+/**
+ * @brief Libère le groupe (après work_pool_wait, ou s'il n'a pas démarré).
+ */
+void work_pool_destroy(WorkPool *pool);
+
+#endif // WORK_POOL_H
@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include "../include/accounting.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+
+static CommandUsage records[2];
+static CommandUsage *current = &records[0];
+static CommandUsage *last = &records[1];
+static int has_last = 0;
+
+
+/**
+ * @brief Convertit un struct timeval en secondes.
+ */
+static double timeval_seconds(const struct timeval *tv) {
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+
+/**
+ * @brief a += b, champ par champ (le RSS max est un maximum, pas une somme).
+ */
+static void add_rusage(struct rusage *a, const struct rusage *b) {
+    timeradd(&a->ru_utime, &b->ru_utime, &a->ru_utime);
+    timeradd(&a->ru_stime, &b->ru_stime, &a->ru_stime);
+    if (b->ru_maxrss > a->ru_maxrss) {
+        a->ru_maxrss = b->ru_maxrss;
+    }
+    a->ru_nvcsw += b->ru_nvcsw;
+    a->ru_nivcsw += b->ru_nivcsw;
+    a->ru_inblock += b->ru_inblock;
+    a->ru_oublock += b->ru_oublock;
+}
+
+
+double elapsed_seconds(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void accounting_begin(const char *command) {
+    current->num_stages = 0;
+    memset(&current->total, 0, sizeof(current->total));
+    strncpy(current->command, command ? command : "", sizeof(current->command) - 1);
+    current->command[sizeof(current->command) - 1] = '\0';
+    clock_gettime(CLOCK_MONOTONIC, &current->started);
+}
+
+void accounting_end() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    current->total.real = elapsed_seconds(&current->started, &now);
+    if (current->num_stages > 0) {
+        current->total.exit_status = current->stages[current->num_stages - 1].exit_status;
+    }
+
+    CommandUsage *swap = last;
+    last = current;
+    current = swap;
+    has_last = 1;
+}
+
+const CommandUsage *accounting_last() {
+    return has_last ? last : NULL;
+}
+
+void accounting_add(const StageUsage *stage) {
+    if (current->num_stages == current->stages_cap) {
+        int new_cap = current->stages_cap ? current->stages_cap * 2 : 4;
+        StageUsage *stages = realloc(current->stages, new_cap * sizeof(StageUsage));
+        if (!stages) {
+            return;
+        }
+        current->stages = stages;
+        current->stages_cap = new_cap;
+    }
+    current->stages[current->num_stages++] = *stage;
+    add_rusage(&current->total.usage, &stage->usage);
+}
+
+void accounting_add_process(const JobProcess *process) {
+    StageUsage stage;
+
+    memset(&stage, 0, sizeof(stage));
+    strncpy(stage.name, process->name, sizeof(stage.name) - 1);
+    stage.exit_status = process->exit_status;
+    stage.real = elapsed_seconds(&process->started, &process->finished);
+    stage.usage = process->usage;
+    accounting_add(&stage);
+}
+
+void stage_usage_begin(StageUsage *stage, const char *name) {
+    memset(stage, 0, sizeof(*stage));
+    strncpy(stage->name, name, sizeof(stage->name) - 1);
+    getrusage(RUSAGE_THREAD, &stage->usage);
+    clock_gettime(CLOCK_MONOTONIC, &stage->started);
+}
+
+void stage_usage_end(StageUsage *stage, int exit_status) {
+    struct timespec now;
+    struct rusage usage;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    getrusage(RUSAGE_THREAD, &usage);
+
+    stage->exit_status = exit_status;
+    stage->real = elapsed_seconds(&stage->started, &now);
+    timersub(&usage.ru_utime, &stage->usage.ru_utime, &stage->usage.ru_utime);
+    timersub(&usage.ru_stime, &stage->usage.ru_stime, &stage->usage.ru_stime);
+    stage->usage.ru_maxrss = usage.ru_maxrss;
+    stage->usage.ru_nvcsw = usage.ru_nvcsw - stage->usage.ru_nvcsw;
+    stage->usage.ru_nivcsw = usage.ru_nivcsw - stage->usage.ru_nivcsw;
+    stage->usage.ru_inblock = usage.ru_inblock - stage->usage.ru_inblock;
+    stage->usage.ru_oublock = usage.ru_oublock - stage->usage.ru_oublock;
+}
+
+void print_usage(FILE *out, const StageUsage *stage) {
+    fprintf(out, "réel %.3fs  user %.3fs  sys %.3fs  maxrss %ld Kio  csw %ld/%ld  blocs %ld/%ld\n",
+            stage->real,
+            timeval_seconds(&stage->usage.ru_utime),
+            timeval_seconds(&stage->usage.ru_stime),
+            stage->usage.ru_maxrss,
+            stage->usage.ru_nvcsw, stage->usage.ru_nivcsw,
+            stage->usage.ru_inblock, stage->usage.ru_oublock);
+}
+
+void print_last_usage(FILE *out) {
+    const CommandUsage *record = accounting_last();
+    if (!record) {
+        return;
+    }
+    fprintf(out, "  %s : ", record->command);
+    print_usage(out, &record->total);
+    for (int i = 0; i < record->num_stages; i++) {
+        fprintf(out, "    [%d] %s (code %d) : ", i + 1, record->stages[i].name, record->stages[i].exit_status);
+        print_usage(out, &record->stages[i]);
+    }
+}
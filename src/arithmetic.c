@@ -0,0 +1,485 @@
+#include "../include/arithmetic.h"
+#include "../include/variable.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#define MAX_NAME_LENGTH 256
+
+/**
+ * @brief Opérateurs binaires, dans l'ordre des tests (les plus longs d'abord).
+ */
+typedef enum {
+    OP_NONE,
+    OP_OR, OP_AND,
+    OP_BIT_OR, OP_BIT_XOR, OP_BIT_AND,
+    OP_EQ, OP_NE,
+    OP_LE, OP_GE, OP_LT, OP_GT,
+    OP_SHL, OP_SHR,
+    OP_ADD, OP_SUB,
+    OP_MUL, OP_DIV, OP_MOD,
+    OP_POW
+} BinaryOp;
+
+typedef struct {
+    const char *text;
+    int len;
+    BinaryOp op;
+    int precedence;
+} OperatorInfo;
+
+// Les opérateurs composés sont listés avant leurs préfixes ("<<" avant "<")
+static const OperatorInfo operators[] = {
+    { "||", 2, OP_OR,      1 },
+    { "&&", 2, OP_AND,     2 },
+    { "==", 2, OP_EQ,      6 },
+    { "!=", 2, OP_NE,      6 },
+    { "<=", 2, OP_LE,      7 },
+    { ">=", 2, OP_GE,      7 },
+    { "<<", 2, OP_SHL,     8 },
+    { ">>", 2, OP_SHR,     8 },
+    { "**", 2, OP_POW,     11 },
+    { "|",  1, OP_BIT_OR,  3 },
+    { "^",  1, OP_BIT_XOR, 4 },
+    { "&",  1, OP_BIT_AND, 5 },
+    { "<",  1, OP_LT,      7 },
+    { ">",  1, OP_GT,      7 },
+    { "+",  1, OP_ADD,     9 },
+    { "-",  1, OP_SUB,     9 },
+    { "*",  1, OP_MUL,     10 },
+    { "/",  1, OP_DIV,     10 },
+    { "%",  1, OP_MOD,     10 },
+};
+
+#define NUM_OPERATORS (sizeof(operators) / sizeof(operators[0]))
+
+typedef struct {
+    const char *start;  ///< Début de l'expression (pour les messages).
+    const char *pos;    ///< Position de lecture.
+    const char *end;    ///< Fin de l'expression.
+    bool error;         ///< Une erreur a été signalée.
+} ArithParser;
+
+
+/**
+ * @brief Signale une erreur (une seule par expression).
+ */
+static void arith_error(ArithParser *p, const char *message) {
+    if (!p->error) {
+        fprintf(stderr, "mysh: %.*s: %s\n", (int)(p->end - p->start), p->start, message);
+    }
+    p->error = true;
+}
+
+
+static void skip_spaces(ArithParser *p) {
+    while (p->pos < p->end && isspace((unsigned char)*p->pos)) {
+        p->pos++;
+    }
+}
+
+
+/**
+ * @brief Teste si le texte courant commence par `text`, sans le consommer.
+ */
+static bool looking_at(ArithParser *p, const char *text) {
+    size_t len = strlen(text);
+    return (size_t)(p->end - p->pos) >= len && memcmp(p->pos, text, len) == 0;
+}
+
+
+/**
+ * @brief Consomme `text` s'il est en tête (après les espaces).
+ */
+static bool accept(ArithParser *p, const char *text) {
+    skip_spaces(p);
+    if (looking_at(p, text)) {
+        p->pos += strlen(text);
+        return true;
+    }
+    return false;
+}
+
+
+static bool is_name_start(char c) {
+    return isalpha((unsigned char)c) || c == '_';
+}
+
+
+static bool is_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+
+/**
+ * @brief Convertit une constante décimale, hexadécimale (0x) ou octale (0).
+ *
+ * @param text Début de la constante.
+ * @param end Fin du texte disponible.
+ * @param value Reçoit la valeur.
+ * @return const char* Position après la constante, ou `NULL` si un chiffre est invalide.
+ */
+static const char *parse_number(const char *text, const char *end, long long *value) {
+    unsigned long long result = 0;
+    int base = 10;
+    const char *s = text;
+
+    if (end - s > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    } else if (end - s > 1 && s[0] == '0') {
+        base = 8;
+        s++;
+    }
+    while (s < end && isalnum((unsigned char)*s)) {
+        int digit = isdigit((unsigned char)*s) ? *s - '0' : tolower((unsigned char)*s) - 'a' + 10;
+        if (digit >= base) {
+            return NULL;
+        }
+        result = result * base + digit;
+        s++;
+    }
+    *value = (long long)result;
+    return s;
+}
+
+
+/**
+ * @brief Valeur numérique d'une variable (0 si elle n'est pas définie ou vide).
+ */
+static long long read_variable(ArithParser *p, const char *name, size_t len) {
+    size_t value_len;
+    const char *value = get_variable_value_n(name, len, &value_len);
+    if (!value) {
+        return 0;
+    }
+    const char *s = value;
+    const char *end = value + value_len;
+    while (s < end && isspace((unsigned char)*s)) {
+        s++;
+    }
+    bool negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) {
+        s++;
+    }
+    long long number = 0;
+    if (s < end && isdigit((unsigned char)*s)) {
+        s = parse_number(s, end, &number);
+    }
+    while (s && s < end && isspace((unsigned char)*s)) {
+        s++;
+    }
+    if (!s || s != end) {
+        fprintf(stderr, "mysh: %.*s: invalid number `%.*s'\n", (int)len, name, (int)value_len, value);
+        p->error = true;
+        return 0;
+    }
+    return negative ? (long long)(0ULL - (unsigned long long)number) : number;
+}
+
+
+/**
+ * @brief Affecte une valeur à une variable locale.
+ */
+static void write_variable(ArithParser *p, const char *name, size_t len, long long value) {
+    char variable[MAX_NAME_LENGTH];
+    char number[24];
+
+    if (len >= sizeof(variable)) {
+        arith_error(p, "variable name too long");
+        return;
+    }
+    memcpy(variable, name, len);
+    variable[len] = '\0';
+    snprintf(number, sizeof(number), "%lld", value);
+    set_local_variable(variable, number);
+}
+
+
+/**
+ * @brief Applique un opérateur binaire. L'arithmétique déborde modulo 2^64, comme en C sur
+ * la plupart des machines, mais sans comportement indéfini.
+ */
+static long long apply_operator(ArithParser *p, BinaryOp op, long long a, long long b) {
+    unsigned long long ua = (unsigned long long)a, ub = (unsigned long long)b;
+
+    switch (op) {
+        case OP_OR:      return a || b;
+        case OP_AND:     return a && b;
+        case OP_BIT_OR:  return a | b;
+        case OP_BIT_XOR: return a ^ b;
+        case OP_BIT_AND: return a & b;
+        case OP_EQ:      return a == b;
+        case OP_NE:      return a != b;
+        case OP_LE:      return a <= b;
+        case OP_GE:      return a >= b;
+        case OP_LT:      return a < b;
+        case OP_GT:      return a > b;
+        case OP_SHL:     return (long long)(ua << (ub & 63));
+        case OP_SHR:     return a >> (ub & 63);
+        case OP_ADD:     return (long long)(ua + ub);
+        case OP_SUB:     return (long long)(ua - ub);
+        case OP_MUL:     return (long long)(ua * ub);
+        case OP_DIV:
+        case OP_MOD:
+            if (b == 0) {
+                arith_error(p, "division by zero");
+                return 0;
+            }
+            if (a == LLONG_MIN && b == -1) {
+                return op == OP_DIV ? LLONG_MIN : 0;
+            }
+            return op == OP_DIV ? a / b : a % b;
+        case OP_POW: {
+            if (b < 0) {
+                arith_error(p, "exponent less than 0");
+                return 0;
+            }
+            unsigned long long result = 1;
+            while (ub) {
+                if (ub & 1) {
+                    result *= ua;
+                }
+                ua *= ua;
+                ub >>= 1;
+            }
+            return (long long)result;
+        }
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * @brief Reconnaît un opérateur binaire en tête, sans le consommer.
+ *
+ * Un opérateur suivi de `=` est une affectation composée (`+=`), pas un opérateur binaire.
+ */
+static const OperatorInfo *peek_operator(ArithParser *p) {
+    skip_spaces(p);
+    for (size_t i = 0; i < NUM_OPERATORS; i++) {
+        const OperatorInfo *info = &operators[i];
+        if (!looking_at(p, info->text)) {
+            continue;
+        }
+        bool comparison = info->op == OP_EQ || info->op == OP_NE || info->op == OP_LE || info->op == OP_GE;
+        if (!comparison && p->pos + info->len < p->end && p->pos[info->len] == '=') {
+            return NULL;
+        }
+        return info;
+    }
+    return NULL;
+}
+
+
+static long long parse_assignment(ArithParser *p, bool evaluate);
+static long long parse_comma(ArithParser *p, bool evaluate);
+
+
+/**
+ * @brief Opérande : constante, variable (avec `++`/`--` suffixes), parenthèses ou opérateur unaire.
+ */
+static long long parse_unary(ArithParser *p, bool evaluate) {
+    skip_spaces(p);
+    if (p->error) {
+        return 0;
+    }
+
+    if (looking_at(p, "++") || looking_at(p, "--")) {
+        int delta = *p->pos == '+' ? 1 : -1;
+        p->pos += 2;
+        skip_spaces(p);
+        const char *name = p->pos;
+        while (p->pos < p->end && is_name_char(*p->pos)) {
+            p->pos++;
+        }
+        if (name == p->pos || !is_name_start(*name)) {
+            arith_error(p, "`++' or `--' needs a variable");
+            return 0;
+        }
+        if (!evaluate) {
+            return 0;
+        }
+        long long value = (long long)((unsigned long long)read_variable(p, name, p->pos - name) + delta);
+        write_variable(p, name, p->pos - name, value);
+        return value;
+    }
+
+    if (p->pos < p->end && (*p->pos == '-' || *p->pos == '+' || *p->pos == '!' || *p->pos == '~')) {
+        char op = *p->pos++;
+        long long value = parse_unary(p, evaluate);
+        switch (op) {
+            case '-': return (long long)(0ULL - (unsigned long long)value);
+            case '!': return !value;
+            case '~': return ~value;
+            default:  return value;
+        }
+    }
+
+    if (accept(p, "(")) {
+        long long value = parse_comma(p, evaluate);
+        if (!accept(p, ")")) {
+            arith_error(p, "missing `)'");
+        }
+        return value;
+    }
+
+    if (p->pos < p->end && isdigit((unsigned char)*p->pos)) {
+        long long value;
+        const char *next = parse_number(p->pos, p->end, &value);
+        if (!next) {
+            arith_error(p, "invalid number");
+            return 0;
+        }
+        p->pos = next;
+        return value;
+    }
+
+    if (p->pos < p->end && is_name_start(*p->pos)) {
+        const char *name = p->pos;
+        while (p->pos < p->end && is_name_char(*p->pos)) {
+            p->pos++;
+        }
+        size_t len = p->pos - name;
+        long long value = evaluate ? read_variable(p, name, len) : 0;
+
+        skip_spaces(p);
+        if (looking_at(p, "++") || looking_at(p, "--")) {
+            int delta = *p->pos == '+' ? 1 : -1;
+            p->pos += 2;
+            if (evaluate) {
+                write_variable(p, name, len, (long long)((unsigned long long)value + delta));
+            }
+        }
+        return value;
+    }
+
+    arith_error(p, p->pos < p->end ? "syntax error: operand expected" : "syntax error: unexpected end of expression");
+    return 0;
+}
+
+
+/**
+ * @brief Opérateurs binaires de priorité au moins `min_precedence` (précédence ascendante).
+ */
+static long long parse_binary(ArithParser *p, int min_precedence, bool evaluate) {
+    long long lhs = parse_unary(p, evaluate);
+
+    const OperatorInfo *info;
+    while (!p->error && (info = peek_operator(p)) && info->precedence >= min_precedence) {
+        p->pos += info->len;
+        // `**` est associatif à droite, les autres à gauche
+        int next_precedence = info->op == OP_POW ? info->precedence : info->precedence + 1;
+
+        bool evaluate_rhs = evaluate;
+        if (info->op == OP_AND) {
+            evaluate_rhs = evaluate && lhs;
+        } else if (info->op == OP_OR) {
+            evaluate_rhs = evaluate && !lhs;
+        }
+        long long rhs = parse_binary(p, next_precedence, evaluate_rhs);
+        if (evaluate && !p->error) {
+            lhs = info->op == OP_AND || info->op == OP_OR
+                ? (info->op == OP_AND ? lhs && rhs : lhs || rhs)
+                : apply_operator(p, info->op, lhs, rhs);
+        }
+    }
+    return lhs;
+}
+
+
+/**
+ * @brief Condition `a ? b : c`.
+ */
+static long long parse_conditional(ArithParser *p, bool evaluate) {
+    long long condition = parse_binary(p, 1, evaluate);
+    if (p->error || !accept(p, "?")) {
+        return condition;
+    }
+    long long then_value = parse_assignment(p, evaluate && condition);
+    if (!accept(p, ":")) {
+        arith_error(p, "expected `:' in conditional expression");
+        return 0;
+    }
+    long long else_value = parse_conditional(p, evaluate && !condition);
+    return condition ? then_value : else_value;
+}
+
+
+/**
+ * @brief Affectation simple ou composée (associative à droite), sinon condition.
+ */
+static long long parse_assignment(ArithParser *p, bool evaluate) {
+    static const struct { const char *text; BinaryOp op; } assignments[] = {
+        { "<<=", OP_SHL }, { ">>=", OP_SHR }, { "**=", OP_POW },
+        { "+=", OP_ADD }, { "-=", OP_SUB }, { "*=", OP_MUL }, { "/=", OP_DIV }, { "%=", OP_MOD },
+        { "&=", OP_BIT_AND }, { "^=", OP_BIT_XOR }, { "|=", OP_BIT_OR }, { "=", OP_NONE },
+    };
+
+    skip_spaces(p);
+    const char *saved = p->pos;
+    if (p->pos < p->end && is_name_start(*p->pos)) {
+        const char *name = p->pos;
+        while (p->pos < p->end && is_name_char(*p->pos)) {
+            p->pos++;
+        }
+        size_t len = p->pos - name;
+        skip_spaces(p);
+        for (size_t i = 0; i < sizeof(assignments) / sizeof(assignments[0]); i++) {
+            if (!looking_at(p, assignments[i].text) || looking_at(p, "==")) {
+                continue;
+            }
+            p->pos += strlen(assignments[i].text);
+            long long value = parse_assignment(p, evaluate);
+            if (!evaluate || p->error) {
+                return value;
+            }
+            if (assignments[i].op != OP_NONE) {
+                value = apply_operator(p, assignments[i].op, read_variable(p, name, len), value);
+            }
+            if (!p->error) {
+                write_variable(p, name, len, value);
+            }
+            return value;
+        }
+    }
+    p->pos = saved;
+    return parse_conditional(p, evaluate);
+}
+
+
+/**
+ * @brief Liste `a, b` : les deux sont évaluées, la valeur est celle de la dernière.
+ */
+static long long parse_comma(ArithParser *p, bool evaluate) {
+    long long value = parse_assignment(p, evaluate);
+    while (!p->error && accept(p, ",")) {
+        value = parse_assignment(p, evaluate);
+    }
+    return value;
+}
+
+
+int arith_evaluate(const char *expr, size_t len, long long *result) {
+    ArithParser parser = { expr, expr, expr + len, false };
+
+    skip_spaces(&parser);
+    if (parser.pos == parser.end) {
+        *result = 0;
+        return 0;
+    }
+
+    long long value = parse_comma(&parser, true);
+    skip_spaces(&parser);
+    if (!parser.error && parser.pos != parser.end) {
+        arith_error(&parser, "syntax error in expression");
+    }
+    if (parser.error) {
+        return -1;
+    }
+    *result = value;
+    return 0;
+}
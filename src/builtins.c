@@ -0,0 +1,333 @@
+#include "../include/builtins.h"
+#include "../include/mysh.h"
+#include "../include/myls.h"
+#include "../include/myps.h"
+#include "../include/redirection.h"
+#include "../include/process_manager.h"
+#include "../include/variable.h"
+#include "../include/path_cache.h"
+#include "../include/accounting.h"
+#include "../include/trace.h"
+#include "../include/arithmetic.h"
+#include "../include/dir_cache.h"
+#include "../include/chunk.h"
+#include "../include/mydu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BUILTIN_TABLE_SIZE 32
+
+
+/**
+ * @brief Recolle les arguments à partir de `argv[1]` sous la forme "nom=valeur".
+ * 
+ * @return char* Chaîne allouée, ou `NULL` s'il n'y a pas d'argument.
+ */
+static char *join_arguments(int argc, char **argv) {
+    if (argc < 2) {
+        return NULL;
+    }
+    size_t len = 0;
+    for (int i = 1; i < argc; i++) {
+        len += strlen(argv[i]) + 1;
+    }
+    char *joined = malloc(len);
+    if (!joined) {
+        perror("malloc failed");
+        return NULL;
+    }
+    joined[0] = '\0';
+    for (int i = 1; i < argc; i++) {
+        if (i > 1) {
+            strcat(joined, " ");
+        }
+        strcat(joined, argv[i]);
+    }
+    return joined;
+}
+
+
+static int builtin_cd(int argc, char **argv, FILE *out) {
+    return change_directory(argc > 1 ? argv[1] : NULL);
+}
+
+static int builtin_exit(int argc, char **argv, FILE *out) {
+    int code = argc > 1 ? atoi(argv[1]) : 0;
+    if (interactive) {
+        printf("Exiting mysh.\n");
+    }
+    exit(code);
+}
+
+static int builtin_status(int argc, char **argv, FILE *out) {
+    print_status();
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+        print_last_usage(stdout);
+    }
+    return 0;
+}
+
+static int builtin_myps(int argc, char **argv, FILE *out) {
+    myps(out);
+    return 0;
+}
+
+static int builtin_myls(int argc, char **argv, FILE *out) {
+    return myls_run(argc, argv, out);
+}
+
+static int builtin_mydu(int argc, char **argv, FILE *out) {
+    return mydu_run(argc, argv, out);
+}
+
+static int builtin_chunk(int argc, char **argv, FILE *out) {
+    return chunk_run(argc, argv);
+}
+
+static int builtin_myjobs(int argc, char **argv, FILE *out) {
+    list_jobs(argc > 1 && strcmp(argv[1], "-v") == 0);
+    return 0;
+}
+
+static int builtin_myfg(int argc, char **argv, FILE *out) {
+    return bring_job_to_foreground(argc > 1 ? atoi(argv[1]) : 0);
+}
+
+static int builtin_mybg(int argc, char **argv, FILE *out) {
+    return move_job_to_background(argc > 1 ? atoi(argv[1]) : 0);
+}
+
+/**
+ * @brief Définit une variable locale ou d'environnement à partir de "nom=valeur".
+ */
+static int assign_variable(int argc, char **argv, void (*setter)(const char *, const char *)) {
+    char *assignment = join_arguments(argc, argv);
+    char *name = assignment ? strtok(assignment, "=") : NULL;
+    char *value = name ? strtok(NULL, "") : NULL;
+
+    if (!name || !value) {
+        fprintf(stderr, "Usage: %s name=value\n", argv[0]);
+        free(assignment);
+        return 1;
+    }
+    setter(name, value);
+    if (strcmp(name, "PATH") == 0) {
+        path_cache_clear();
+    }
+    free(assignment);
+    return 0;
+}
+
+static int builtin_set(int argc, char **argv, FILE *out) {
+    if (argc == 3 && strcmp(argv[2], "pipefail") == 0 &&
+        (strcmp(argv[1], "-o") == 0 || strcmp(argv[1], "+o") == 0)) {
+        pipefail_enabled = (argv[1][0] == '-');
+        return 0;
+    }
+    return assign_variable(argc, argv, set_local_variable);
+}
+
+static int builtin_setenv(int argc, char **argv, FILE *out) {
+    return assign_variable(argc, argv, set_env_variable);
+}
+
+/**
+ * @brief Supprime chaque variable nommée, avec ou sans '$' devant le nom.
+ */
+static int unset_variables(int argc, char **argv, void (*unsetter)(const char *)) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s name\n", argv[0]);
+        return 1;
+    }
+    for (int i = 1; i < argc; i++) {
+        const char *name = argv[i][0] == '$' ? argv[i] + 1 : argv[i];
+        unsetter(name);
+        if (strcmp(name, "PATH") == 0) {
+            path_cache_clear();
+        }
+    }
+    return 0;
+}
+
+static int builtin_unset(int argc, char **argv, FILE *out) {
+    return unset_variables(argc, argv, unset_local_variable);
+}
+
+static int builtin_unsetenv(int argc, char **argv, FILE *out) {
+    return unset_variables(argc, argv, unset_env_variable);
+}
+
+/**
+ * @brief `let EXPR...` évalue chaque expression arithmétique ; le code de retour
+ * vaut 0 si la dernière est non nulle, 1 sinon (comme une condition).
+ */
+static int builtin_let(int argc, char **argv, FILE *out) {
+    long long value = 0;
+    if (argc < 2) {
+        fprintf(stderr, "Usage: let expression...\n");
+        return 2;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (arith_evaluate(argv[i], strlen(argv[i]), &value) == -1) {
+            return 2;
+        }
+    }
+    return value != 0 ? 0 : 1;
+}
+
+/**
+ * @brief `settrace FICHIER` démarre une trace JSON, `settrace off` la termine.
+ */
+static int builtin_settrace(int argc, char **argv, FILE *out) {
+    if (argc == 1) {
+        printf("trace %s\n", trace_enabled ? "on" : "off");
+        return 0;
+    }
+    if (strcmp(argv[1], "off") == 0) {
+        trace_stop();
+        return 0;
+    }
+    return trace_start(argv[1]) == 0 ? 0 : 1;
+}
+
+static int builtin_hash(int argc, char **argv, FILE *out) {
+    if (argc == 1) {
+        path_cache_list();
+        return 0;
+    }
+    if (strcmp(argv[1], "-r") == 0) {
+        path_cache_clear();
+        return 0;
+    }
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!path_cache_lookup(argv[i])) {
+            fprintf(stderr, "hash: %s: not found\n", argv[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief `cache-stats` affiche le cache des répertoires, `-r` le vide,
+ * `inotify on|off` active ou non son invalidation par inotify.
+ */
+static int builtin_cache_stats(int argc, char **argv, FILE *out) {
+    if (argc == 1) {
+        dir_cache_print_stats(out);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "-r") == 0) {
+        dir_cache_clear();
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "inotify") == 0 &&
+        (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+        return dir_cache_set_inotify(strcmp(argv[2], "on") == 0) == 0 ? 0 : 1;
+    }
+    fprintf(stderr, "Usage: cache-stats [-r | inotify on|off]\n");
+    return 2;
+}
+
+
+static const Builtin builtins[] = {
+    { "cd",       builtin_cd,       0 },
+    { "exit",     builtin_exit,     0 },
+    { "status",   builtin_status,   0 },
+    { "myls",     builtin_myls,     BUILTIN_PIPEABLE },
+    { "myps",     builtin_myps,     BUILTIN_PIPEABLE },
+    { "mydu",     builtin_mydu,     BUILTIN_PIPEABLE },
+    { "myjobs",   builtin_myjobs,   0 },
+    { "myfg",     builtin_myfg,     0 },
+    { "mybg",     builtin_mybg,     0 },
+    { "set",      builtin_set,      0 },
+    { "setenv",   builtin_setenv,   0 },
+    { "unset",    builtin_unset,    0 },
+    { "unsetenv", builtin_unsetenv, 0 },
+    { "hash",     builtin_hash,     0 },
+    { "settrace", builtin_settrace, 0 },
+    { "let",      builtin_let,      0 },
+    { "cache-stats", builtin_cache_stats, BUILTIN_PIPEABLE },
+    { "chunk",    builtin_chunk,    0 },
+};
+
+#define NUM_BUILTINS (sizeof(builtins) / sizeof(builtins[0]))
+
+// Table à adressage ouvert, remplie au premier appel : indices dans builtins[], -1 si vide
+static int builtin_table[BUILTIN_TABLE_SIZE];
+static int builtin_table_ready = 0;
+
+
+/**
+ * @brief Fonction de hachage FNV-1a sur les `len` premiers caractères.
+ */
+static unsigned int hash_name(const char *name, size_t len) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+static void build_builtin_table() {
+    for (int i = 0; i < BUILTIN_TABLE_SIZE; i++) {
+        builtin_table[i] = -1;
+    }
+    for (size_t i = 0; i < NUM_BUILTINS; i++) {
+        unsigned int slot = hash_name(builtins[i].name, strlen(builtins[i].name)) & (BUILTIN_TABLE_SIZE - 1);
+        while (builtin_table[slot] != -1) {
+            slot = (slot + 1) & (BUILTIN_TABLE_SIZE - 1);
+        }
+        builtin_table[slot] = (int)i;
+    }
+    builtin_table_ready = 1;
+}
+
+
+const Builtin *find_builtin(const char *name, size_t len) {
+    if (!builtin_table_ready) {
+        build_builtin_table();
+    }
+
+    unsigned int slot = hash_name(name, len) & (BUILTIN_TABLE_SIZE - 1);
+    while (builtin_table[slot] != -1) {
+        const Builtin *builtin = &builtins[builtin_table[slot]];
+        if (strncmp(builtin->name, name, len) == 0 && builtin->name[len] == '\0') {
+            return builtin;
+        }
+        slot = (slot + 1) & (BUILTIN_TABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+
+int run_builtin(const Builtin *builtin, int argc, char **argv,
+                Arena *arena, const Redirection *redirections) {
+    if (!redirections) {
+        return builtin->handler(argc, argv, stdout);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    int saved_in = save_fd(STDIN_FILENO);
+    int saved_out = save_fd(STDOUT_FILENO);
+    int saved_err = save_fd(STDERR_FILENO);
+
+    int status = 1;
+    if (apply_redirections(arena, redirections) == 0) {
+        status = builtin->handler(argc, argv, stdout);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    restore_fd(saved_in, STDIN_FILENO);
+    restore_fd(saved_out, STDOUT_FILENO);
+    restore_fd(saved_err, STDERR_FILENO);
+    clearerr(stdout);
+    return status;
+}
@@ -0,0 +1,267 @@
+#include "../include/chunk.h"
+#include "../include/arena.h"
+#include "../include/executor.h"
+#include "../include/process_manager.h"
+#include "../include/accounting.h"
+#include "../include/variable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#define CHUNK_MARGIN 2048                 ///< Marge laissée sous ARG_MAX, comme xargs.
+#define CHUNK_MAX_ARGUMENT (32 * 4096)    ///< Longueur maximale d'un argument (MAX_ARG_STRLEN de Linux).
+
+
+/**
+ * @brief Place occupée par un argument sur la pile du nouveau programme.
+ */
+static size_t argument_cost(const char *arg) {
+    return strlen(arg) + 1 + sizeof(char *);
+}
+
+
+size_t chunk_argument_budget() {
+    long arg_max = sysconf(_SC_ARG_MAX);
+    if (arg_max <= 0) {
+        arg_max = _POSIX_ARG_MAX;
+    }
+    // Les deux NULL qui terminent argv et envp
+    size_t used = CHUNK_MARGIN + 2 * sizeof(char *);
+    for (char **env = get_environment(); *env; env++) {
+        used += argument_cost(*env);
+    }
+    return (size_t)arg_max > used ? (size_t)arg_max - used : 0;
+}
+
+
+static int chunk_usage() {
+    fprintf(stderr, "Usage: chunk [-j jobs] [-n max-args] command [options] arguments...\n");
+    return 2;
+}
+
+
+/**
+ * @brief Découpe les arguments en lots qui tiennent dans le budget.
+ *
+ * @param bounds Reçoit le début de chaque lot, puis `num_items` (au moins `num_items + 2` cases).
+ * @return int Le nombre de lots, ou -1 si un argument ne tient pas seul dans une commande.
+ */
+static int split_batches(char **items, int num_items, size_t fixed_cost, size_t budget,
+                         long per_batch, int *bounds) {
+    int num_batches = 0;
+    size_t used = fixed_cost;
+    int in_batch = 0;
+
+    bounds[num_batches++] = 0;
+    for (int i = 0; i < num_items; i++) {
+        size_t cost = argument_cost(items[i]);
+        if (strlen(items[i]) >= CHUNK_MAX_ARGUMENT || fixed_cost + cost > budget) {
+            fprintf(stderr, "chunk: argument too long: %.40s...\n", items[i]);
+            return -1;
+        }
+        if (in_batch > 0 && (used + cost > budget || (per_batch > 0 && in_batch == per_batch))) {
+            bounds[num_batches++] = i;
+            used = fixed_cost;
+            in_batch = 0;
+        }
+        used += cost;
+        in_batch++;
+    }
+    bounds[num_batches] = num_items;
+    return num_batches;
+}
+
+
+/**
+ * @brief Lance un lot dans le job.
+ *
+ * @return int 0 si réussi, sinon le code d'échec (1 : mémoire épuisée, 127 : lancement impossible).
+ */
+static int launch_batch(Arena *arena, char **command, int fixed, char **items, const int *bounds,
+                        int batch, Job *job) {
+    int count = bounds[batch + 1] - bounds[batch];
+    char **args = arena_alloc(arena, (fixed + count + 1) * sizeof(char *));
+    if (!args) {
+        return 1;
+    }
+    memcpy(args, command, fixed * sizeof(char *));
+    memcpy(args + fixed, items + bounds[batch], count * sizeof(char *));
+    args[fixed + count] = NULL;
+
+    if (launch_command(arena, fixed + count, args, NULL, STDIN_FILENO, STDOUT_FILENO, -1, job) == -1) {
+        return 127;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Relève un lot terminé : ressources consommées et code du premier échec.
+ *
+ * @param stop Mis à 1 si le lot a été interrompu (signal, Ctrl+Z).
+ */
+static void collect_batch(const JobProcess *process, int *status, int *stop) {
+    if (process->state == PROCESS_DONE) {
+        accounting_add_process(process);
+    }
+    if (process->exit_status != 0 && *status == 0) {
+        *status = process->exit_status;
+    }
+    if (process->exit_status > 128) {
+        *stop = 1;
+    }
+}
+
+
+/**
+ * @brief Attend les lots encore en cours du job, puis le libère (ou l'enregistre
+ * s'il a été stoppé).
+ *
+ * @param collected Processus déjà relevés par collect_batch, à ne pas compter deux fois.
+ */
+static void finish_job(Arena *arena, Job *job, const char *collected, int *status, int *stop) {
+    int num_procs = job->num_procs;
+    if (num_procs == 0) {
+        remove_job(job);
+        return;
+    }
+
+    JobProcess *results = arena_alloc(arena, num_procs * sizeof(JobProcess));
+    int job_status = wait_for_job(job, results);
+    for (int i = 0; results && i < num_procs; i++) {
+        if (!collected[i]) {
+            collect_batch(&results[i], status, stop);
+        }
+    }
+    if (!results && job_status != 0) {
+        if (*status == 0) {
+            *status = job_status;
+        }
+        *stop = 1;
+    }
+}
+
+
+int chunk_run(int argc, char **argv) {
+    long parallel = 1;
+    long per_batch = 0;
+    int i = 1;
+
+    while (i < argc && argv[i][0] == '-') {
+        if (strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        }
+        if ((strcmp(argv[i], "-j") != 0 && strcmp(argv[i], "-n") != 0) || i + 1 >= argc) {
+            return chunk_usage();
+        }
+        char *end;
+        long value = strtol(argv[i + 1], &end, 10);
+        if (end == argv[i + 1] || *end != '\0' || value < 0 || (argv[i][1] == 'n' && value == 0)) {
+            return chunk_usage();
+        }
+        if (argv[i][1] == 'j') {
+            parallel = value;
+        } else {
+            per_batch = value;
+        }
+        i += 2;
+    }
+    if (i >= argc) {
+        return chunk_usage();
+    }
+    if (parallel == 0) {
+        parallel = sysconf(_SC_NPROCESSORS_ONLN);
+        parallel = parallel > 0 ? parallel : 1;
+    }
+
+    // La commande et ses options de tête sont répétées à chaque lot
+    char **command = argv + i;
+    int fixed = 1;
+    while (i + fixed < argc && command[fixed][0] == '-') {
+        if (strcmp(command[fixed++], "--") == 0) {
+            break;
+        }
+    }
+    char **items = command + fixed;
+    int num_items = argc - i - fixed;
+
+    size_t budget = chunk_argument_budget();
+    size_t fixed_cost = 0;
+    for (int j = 0; j < fixed; j++) {
+        fixed_cost += argument_cost(command[j]);
+    }
+
+    int *bounds = malloc((num_items + 2) * sizeof(int));
+    if (!bounds) {
+        perror("malloc failed");
+        return 1;
+    }
+    int num_batches = split_batches(items, num_items, fixed_cost, budget, per_batch, bounds);
+    if (num_batches == -1) {
+        free(bounds);
+        return 1;
+    }
+
+    char *collected = calloc(num_batches + 1, 1);
+    if (!collected) {
+        perror("calloc failed");
+        free(bounds);
+        return 1;
+    }
+
+    // Tous les lots en cours forment un job au premier plan (Ctrl+C, Ctrl+Z les atteignent
+    // tous) ; dès que l'un se termine, le suivant prend sa place
+    Arena arena;
+    arena_init(&arena);
+    Job *job = NULL;
+    int in_flight = 0;
+    int status = 0;
+    int stop = 0;
+    for (int batch = 0; batch < num_batches && !stop; batch++) {
+        while (in_flight >= parallel && !stop) {
+            int proc = wait_for_job_process(job);
+            if (proc == -1) {
+                in_flight = 0;
+            } else if (job->procs[proc].state == PROCESS_DONE) {
+                collected[proc] = 1;
+                collect_batch(&job->procs[proc], &status, &stop);
+                in_flight--;
+            } else {
+                // Stoppé : finish_job enregistre le job
+                stop = 1;
+            }
+        }
+        if (stop) {
+            break;
+        }
+
+        // Groupe de processus vide : il ne peut plus accueillir de lot, un nouveau job le remplace
+        if (job && in_flight == 0) {
+            finish_job(&arena, job, collected, &status, &stop);
+            job = NULL;
+            memset(collected, 0, num_batches + 1);
+            arena_reset(&arena);
+        }
+        if (!job && !(job = job_create(command[0], 1))) {
+            status = status ? status : 1;
+            break;
+        }
+
+        int launch_status = launch_batch(&arena, command, fixed, items, bounds, batch, job);
+        if (launch_status != 0) {
+            status = status ? status : launch_status;
+            break;
+        }
+        in_flight++;
+    }
+    if (job) {
+        finish_job(&arena, job, collected, &status, &stop);
+    }
+    arena_destroy(&arena);
+    free(collected);
+    free(bounds);
+    return status;
+}
@@ -0,0 +1,370 @@
+#define _GNU_SOURCE
+#include "../include/dir_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/inotify.h>
+
+#define DIR_CACHE_BUCKETS 256
+#define DIR_CACHE_MAX_ENTRIES 8192
+#define DIR_CACHE_MAX_BYTES (64 * 1024 * 1024)
+#define DIR_CACHE_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                              IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+/**
+ * @brief Entrée renvoyée par getdents64.
+ */
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static DirListing *buckets[DIR_CACHE_BUCKETS];
+static DirListing *lru_head = NULL;
+static DirListing *lru_tail = NULL;
+static size_t entry_count = 0;
+static size_t total_bytes = 0;
+static int inotify_fd = -1;
+
+static struct {
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long stale;       ///< Trouvées mais périmées (horodatages différents ou trop récents).
+    unsigned long evictions;
+    unsigned long notified;    ///< Invalidées par un événement inotify.
+} stats;
+
+
+static size_t bucket_of(dev_t dev, ino_t ino) {
+    uint64_t hash = ((uint64_t)ino * 0x9E3779B97F4A7C15ULL) ^ (uint64_t)dev;
+    return (hash >> 32) & (DIR_CACHE_BUCKETS - 1);
+}
+
+
+static bool same_time(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+
+static void lru_unlink(DirListing *listing) {
+    if (listing->lru_prev) {
+        listing->lru_prev->lru_next = listing->lru_next;
+    } else {
+        lru_head = listing->lru_next;
+    }
+    if (listing->lru_next) {
+        listing->lru_next->lru_prev = listing->lru_prev;
+    } else {
+        lru_tail = listing->lru_prev;
+    }
+}
+
+
+static void lru_push_front(DirListing *listing) {
+    listing->lru_prev = NULL;
+    listing->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = listing;
+    } else {
+        lru_tail = listing;
+    }
+    lru_head = listing;
+}
+
+
+/**
+ * @brief Retire une liste du cache ; elle n'est libérée qu'une fois rendue par tous ses utilisateurs.
+ */
+static void remove_listing(DirListing *listing) {
+    DirListing **link = &buckets[bucket_of(listing->dev, listing->ino)];
+    while (*link != listing) {
+        link = &(*link)->hash_next;
+    }
+    *link = listing->hash_next;
+    lru_unlink(listing);
+    entry_count--;
+    total_bytes -= listing->bytes;
+
+    if (listing->watch != -1 && inotify_fd != -1) {
+        inotify_rm_watch(inotify_fd, listing->watch);
+    }
+    listing->watch = -1;
+    listing->cached = false;
+    if (listing->refs == 0) {
+        free(listing);
+    }
+}
+
+
+static DirListing *find_listing(dev_t dev, ino_t ino) {
+    for (DirListing *l = buckets[bucket_of(dev, ino)]; l; l = l->hash_next) {
+        if (l->dev == dev && l->ino == ino) {
+            return l;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Applique les événements inotify reçus : chaque répertoire modifié quitte le cache.
+ */
+static void drain_notifications() {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+
+    while (inotify_fd != -1 && (n = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + n; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Des événements ont été perdus : plus aucune liste n'est sûre
+                while (lru_head) {
+                    remove_listing(lru_head);
+                    stats.notified++;
+                }
+                continue;
+            }
+            for (DirListing *l = lru_head; l; l = l->lru_next) {
+                if (l->watch == event->wd) {
+                    // Le noyau retire lui-même la surveillance d'un répertoire supprimé
+                    if (event->mask & IN_IGNORED) {
+                        l->watch = -1;
+                    }
+                    remove_listing(l);
+                    stats.notified++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Lit toutes les entrées d'un répertoire par lots avec getdents64.
+ *
+ * @return DirListing* Liste allouée d'un seul bloc (structure, entrées, noms), ou `NULL`.
+ */
+static DirListing *read_listing(int fd, char *buffer, size_t size) {
+    DirEntry *entries = NULL;
+    char *names = NULL;
+    size_t count = 0, entries_cap = 0, names_len = 0, names_cap = 0;
+    long n;
+    bool failed = false;
+
+    while (!failed && (n = syscall(SYS_getdents64, fd, buffer, size)) > 0) {
+        for (long offset = 0; offset < n; ) {
+            const struct linux_dirent64 *entry = (const struct linux_dirent64 *)(buffer + offset);
+            offset += entry->d_reclen;
+
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            size_t len = strlen(name);
+
+            if (count == entries_cap) {
+                entries_cap = entries_cap ? entries_cap * 2 : 64;
+                DirEntry *grown = realloc(entries, entries_cap * sizeof(DirEntry));
+                if (!grown) {
+                    failed = true;
+                    break;
+                }
+                entries = grown;
+            }
+            if (names_len + len + 1 > names_cap) {
+                names_cap = names_cap ? names_cap * 2 : 4096;
+                char *grown = realloc(names, names_cap);
+                if (!grown) {
+                    failed = true;
+                    break;
+                }
+                names = grown;
+            }
+            entries[count].name = names_len;
+            entries[count].len = len;
+            entries[count].type = entry->d_type;
+            count++;
+            memcpy(names + names_len, name, len + 1);
+            names_len += len + 1;
+        }
+    }
+
+    size_t bytes = sizeof(DirListing) + count * sizeof(DirEntry) + names_len;
+    DirListing *listing = failed || n < 0 ? NULL : malloc(bytes);
+    if (listing) {
+        memset(listing, 0, sizeof(DirListing));
+        DirEntry *packed = (DirEntry *)(listing + 1);
+        char *packed_names = (char *)(packed + count);
+        if (count > 0) {
+            memcpy(packed, entries, count * sizeof(DirEntry));
+            memcpy(packed_names, names, names_len);
+        }
+        listing->entries = packed;
+        listing->names = packed_names;
+        listing->count = count;
+        listing->bytes = bytes;
+        listing->watch = -1;
+    } else {
+        perror(n < 0 ? "getdents64 failed" : "malloc failed");
+    }
+    free(entries);
+    free(names);
+    return listing;
+}
+
+
+/**
+ * @brief Surveille un répertoire ouvert avec inotify.
+ */
+static int add_watch(int fd) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    return inotify_add_watch(inotify_fd, path, DIR_CACHE_WATCH_MASK);
+}
+
+
+const DirListing *dir_cache_read(int fd, char *buffer, size_t size) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&lock);
+    drain_notifications();
+    stats.lookups++;
+
+    int watch = -1;
+    DirListing *found = find_listing(st.st_dev, st.st_ino);
+    if (found && same_time(&found->mtime, &st.st_mtim) && same_time(&found->ctime, &st.st_ctim) &&
+        (!found->racy || found->watch != -1)) {
+        stats.hits++;
+        found->refs++;
+        lru_unlink(found);
+        lru_push_front(found);
+        pthread_mutex_unlock(&lock);
+        return found;
+    }
+    if (found) {
+        // La surveillance porte sur l'inode : elle sert aussi à la nouvelle liste
+        stats.stale++;
+        watch = found->watch;
+        found->watch = -1;
+        remove_listing(found);
+    } else if (inotify_fd != -1) {
+        // Surveillé avant la lecture : aucune modification ultérieure n'échappe au cache
+        watch = add_watch(fd);
+    }
+    int watch_fd = inotify_fd;
+    pthread_mutex_unlock(&lock);
+
+    struct timespec started;
+    clock_gettime(CLOCK_REALTIME, &started);
+    DirListing *listing = read_listing(fd, buffer, size);
+    if (!listing || listing->bytes > DIR_CACHE_MAX_BYTES / 4) {
+        if (watch != -1) {
+            inotify_rm_watch(watch_fd, watch);
+        }
+        if (listing) {
+            listing->refs = 1;
+        }
+        return listing;
+    }
+
+    listing->dev = st.st_dev;
+    listing->ino = st.st_ino;
+    listing->mtime = st.st_mtim;
+    listing->ctime = st.st_ctim;
+    // Une modification dans la même seconde pourrait garder les mêmes horodatages
+    listing->racy = st.st_mtim.tv_sec >= started.tv_sec - 1 || st.st_ctim.tv_sec >= started.tv_sec - 1;
+    listing->refs = 1;
+
+    pthread_mutex_lock(&lock);
+    listing->watch = inotify_fd == watch_fd ? watch : -1;
+    listing->cached = true;
+    DirListing *other = find_listing(st.st_dev, st.st_ino);
+    if (other) {
+        // Lu en même temps par un autre thread
+        if (other->watch == listing->watch) {
+            other->watch = -1;
+        }
+        remove_listing(other);
+    }
+    DirListing **bucket = &buckets[bucket_of(st.st_dev, st.st_ino)];
+    listing->hash_next = *bucket;
+    *bucket = listing;
+    lru_push_front(listing);
+    entry_count++;
+    total_bytes += listing->bytes;
+
+    while (lru_tail != listing && (entry_count > DIR_CACHE_MAX_ENTRIES || total_bytes > DIR_CACHE_MAX_BYTES)) {
+        remove_listing(lru_tail);
+        stats.evictions++;
+    }
+    pthread_mutex_unlock(&lock);
+    return listing;
+}
+
+
+void dir_cache_release(const DirListing *listing) {
+    DirListing *l = (DirListing *)listing;
+    pthread_mutex_lock(&lock);
+    if (--l->refs == 0 && !l->cached) {
+        free(l);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+
+void dir_cache_clear() {
+    pthread_mutex_lock(&lock);
+    while (lru_head) {
+        remove_listing(lru_head);
+    }
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&lock);
+}
+
+
+int dir_cache_set_inotify(bool enabled) {
+    int status = 0;
+    pthread_mutex_lock(&lock);
+    if (enabled && inotify_fd == -1) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd == -1) {
+            perror("inotify_init1 failed");
+            status = -1;
+        }
+    } else if (!enabled && inotify_fd != -1) {
+        // Les listes récentes ne sont plus protégées par une surveillance
+        for (DirListing *l = lru_head; l; l = l->lru_next) {
+            l->watch = -1;
+        }
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    pthread_mutex_unlock(&lock);
+    return status;
+}
+
+
+void dir_cache_print_stats(FILE *out) {
+    pthread_mutex_lock(&lock);
+    drain_notifications();
+    fprintf(out, "directory cache: %zu entries, %zu KiB (limits: %d entries, %d KiB)\n",
+            entry_count, total_bytes / 1024, DIR_CACHE_MAX_ENTRIES, DIR_CACHE_MAX_BYTES / 1024);
+    fprintf(out, "lookups %lu, hits %lu (%.1f%%), misses %lu, stale %lu, evictions %lu\n",
+            stats.lookups, stats.hits, stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0,
+            stats.lookups - stats.hits, stats.stale, stats.evictions);
+    fprintf(out, "inotify %s, %lu invalidations\n", inotify_fd != -1 ? "on" : "off", stats.notified);
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,131 @@
+#include "../include/event_loop.h"
+#include "../include/process_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+
+static int signal_fd = -1;
+static sigset_t handled_signals;
+
+
+int event_loop_init(int handle_sigint) {
+    sigemptyset(&handled_signals);
+    sigaddset(&handled_signals, SIGCHLD);
+    if (handle_sigint) {
+        sigaddset(&handled_signals, SIGINT);
+    }
+
+    if (sigprocmask(SIG_BLOCK, &handled_signals, NULL) == -1) {
+        perror("sigprocmask failed");
+        return -1;
+    }
+
+    signal_fd = signalfd(-1, &handled_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == -1) {
+        perror("signalfd failed");
+        return -1;
+    }
+    return 0;
+}
+
+
+void reap_children() {
+    while (1) {
+        int status;
+        struct rusage usage;
+        // wait4 plutôt que waitid : il rend aussi les ressources consommées par l'enfant
+        pid_t pid = wait4(-1, &status, WNOHANG | WUNTRACED | WCONTINUED, &usage);
+        if (pid <= 0) {
+            break;
+        }
+        job_status_changed(pid, status, &usage);
+    }
+}
+
+
+/**
+ * @brief Vide le signalfd et traite les signaux en attente.
+ *
+ * @return int 1 si un SIGINT a été reçu.
+ */
+static int drain_signals() {
+    struct signalfd_siginfo info;
+    int interrupted = 0;
+    int child_exited = 0;
+
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+        if (info.ssi_signo == SIGCHLD) {
+            child_exited = 1;
+        } else if (info.ssi_signo == SIGINT) {
+            interrupted = 1;
+        }
+    }
+
+    // Plusieurs SIGCHLD peuvent être fusionnés : on récupère tous les enfants prêts
+    if (child_exited) {
+        reap_children();
+    }
+    return interrupted;
+}
+
+
+int event_loop_wait(int fd) {
+    if (signal_fd == -1) {
+        return 1;
+    }
+
+    struct pollfd fds[2] = {
+        { .fd = fd, .events = POLLIN },
+        { .fd = signal_fd, .events = POLLIN },
+    };
+
+    while (1) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll failed");
+            return 1;
+        }
+
+        if ((fds[1].revents & POLLIN) && drain_signals()) {
+            return 0;
+        }
+        if (fds[0].revents) {
+            return 1;
+        }
+    }
+}
+
+
+void event_loop_discard_interrupts() {
+    sigset_t pending;
+    if (!sigismember(&handled_signals, SIGINT) || sigpending(&pending) == -1 || !sigismember(&pending, SIGINT)) {
+        return;
+    }
+
+    sigset_t sigint_only;
+    struct timespec no_wait = { 0, 0 };
+    sigemptyset(&sigint_only);
+    sigaddset(&sigint_only, SIGINT);
+    while (sigtimedwait(&sigint_only, NULL, &no_wait) == SIGINT) {
+    }
+}
+
+
+
+int event_loop_interrupted() {
+    sigset_t pending;
+    if (!sigismember(&handled_signals, SIGINT) || sigpending(&pending) == -1 || !sigismember(&pending, SIGINT)) {
+        return 0;
+    }
+    event_loop_discard_interrupts();
+    return 1;
+}
@@ -1,171 +1,480 @@
+#define _GNU_SOURCE
 #include "../include/executor.h"
-#include "../include/myls.h"
-#include "../include/myps.h"
+#include "../include/mysh.h"
+#include "../include/builtins.h"
 #include "../include/parser.h"
 #include "../include/wildcard.h"
+#include "../include/expander.h"
 #include "../include/redirection.h"
 #include "../include/process_manager.h"
 #include "../include/variable.h"
+#include "../include/path_cache.h"
+#include "../include/accounting.h"
+#include "../include/trace.h"
+#include "../include/interpreter.h"
+#include "../include/chunk.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <string.h>
-#include <ctype.h>
+#include <spawn.h>
+#include <signal.h>
+#include <errno.h>
 
 
-int background = 0;
+/**
+ * @brief Étend les mots d'une commande simple en tableau d'arguments.
+ * 
+ * Les paramètres (`$nom`, `${...}`) sont étendus et les guillemets retirés ; les
+ * mots contenant des jokers non protégés sont remplacés par la liste des fichiers
+ * correspondants (ou conservés tels quels si aucun fichier ne correspond). Un mot
+ * sans guillemets qui s'étend en chaîne vide ne produit aucun argument. Le tableau
+ * est alloué dans l'arène et grandit au besoin.
+ * 
+ * @param arena Arène de la ligne en cours.
+ * @param cmd Commande simple à étendre.
+ * @param argc Reçoit le nombre d'arguments produits.
+ * @return char** Tableau d'arguments terminé par `NULL`, ou `NULL` en cas d'échec d'allocation.
+ */
+char **expand_arguments(Arena *arena, const SimpleCommand *cmd, int *argc) {
+    int capacity = cmd->argc + 1;
+    int count = 0;
+    char **args = arena_alloc(arena, capacity * sizeof(char *));
+    if (!args) {
+        return NULL;
+    }
+
+    for (int i = 0; i < cmd->argc; i++) {
+        char *word = cmd->argv[i];
+        int num_matches = 0;
+        char **matches = NULL;
+        char *literal = NULL;
+
+        if (has_unquoted_wildcard(word)) {
+            char *pattern = expand_pattern(arena, word, &literal);
+            if (!pattern) {
+                return NULL;
+            }
+            matches = expand_wildcard(pattern, &num_matches);
+        }
+
+        if (num_matches == 0) {
+            free_matches(matches, 0);
+            matches = NULL;
+            num_matches = 1;
+        }
+
+        if (count + num_matches + 1 > capacity) {
+            while (count + num_matches + 1 > capacity) {
+                capacity *= 2;
+            }
+            char **temp = arena_alloc(arena, capacity * sizeof(char *));
+            if (!temp) {
+                free_matches(matches, num_matches);
+                return NULL;
+            }
+            memcpy(temp, args, count * sizeof(char *));
+            args = temp;
+        }
+
+        if (matches) {
+            for (int j = 0; j < num_matches; j++) {
+                args[count++] = arena_strndup(arena, matches[j], strlen(matches[j]));
+            }
+            free_matches(matches, num_matches);
+        } else {
+            args[count] = literal ? literal : expand_word(arena, word);
+            if (!args[count]) {
+                return NULL;
+            }
+            if (args[count][0] != '\0' || !is_unquoted_word(word)) {
+                count++;
+            }
+        }
+    }
 
+    args[count] = NULL;
+    *argc = count;
+    return args;
+}
 
 
 /**
- * @brief Exécute une commande avec ou sans arguments.
+ * @brief Exécute un programme externe dans le processus courant (après un fork).
  * 
- * @param command La commande à exécuter, incluant éventuellement des arguments.
- * @return int Le code de retour de la commande après son exécution.
+ * Les fonctions et les commandes internes sont exécutées directement ; les autres
+ * commandes sont résolues via le cache des chemins puis lancées avec execve, avec
+ * l'environnement du shell (variables du segment partagé comprises). Ne retourne jamais.
  * 
+ * @param argc Nombre d'arguments.
+ * @param args Arguments terminés par `NULL`.
  */
-int execute_command(char *command) {
+void exec_program(int argc, char **args) {
+    Function *function = find_function(args[0]);
+    if (function) {
+        // Les commandes de la fonction restent dans le groupe de processus de l'étape
+        Arena arena;
+        arena_init(&arena);
+        job_control_disable();
+        int status = call_function(&arena, function, argc, args, NULL);
+        fflush(stdout);
+        exit(status);
+    }
 
-    
-    if (strchr(command, '|')) {
-        return handle_pipeline(command);
+    const Builtin *builtin = find_builtin(args[0], strlen(args[0]));
+    if (builtin) {
+        int status = builtin->handler(argc, args, stdout);
+        fflush(stdout);
+        exit(status);
     }
 
-   
-    char *ampersand = strrchr(command, '&');
-    if (ampersand && *(ampersand + 1) == '\0') {
-        background = 1;
-        *ampersand = '\0'; 
-        while (*(ampersand - 1) == ' ') {
-            *(--ampersand) = '\0'; 
-        }
-    } else {
-        background = 0;
+    const char *path = path_cache_lookup(args[0]);
+    if (path) {
+        execve(path, args, get_environment());
     }
+    fprintf(stderr, "Command not found: %s\n", args[0]);
+    exit(127);
+}
+
 
+/**
+ * @brief Indique si une commande doit s'exécuter dans une copie du shell.
+ * 
+ * Les fonctions et les commandes internes n'ont pas d'exécutable : lancées en
+ * arrière-plan ou dans un pipeline (hors thread), elles ont besoin d'un fork pour
+ * disposer du code du shell.
+ */
+static bool needs_shell_process(const char *name) {
+    return find_builtin(name, strlen(name)) != NULL || find_function(name) != NULL;
+}
+
+
+/**
+ * @brief Lance une commande dans un fork du shell, en câblant ses descripteurs.
+ */
+static pid_t fork_command(Arena *arena, int argc, char **args, const Redirection *redirections,
+                          int in_fd, int out_fd, int close_fd, const Job *job) {
     pid_t pid = fork();
+    if (pid != 0) {
+        if (pid == -1) {
+            perror("fork failed");
+        }
+        return pid;
+    }
 
-    if (pid == 0) {
-        
-        handle_redirection(command);
+    trace_drop_in_child();
+    job_setup_child(job);
+    signal(SIGPIPE, SIG_DFL);
+    if (in_fd != STDIN_FILENO) {
+        dup2(in_fd, STDIN_FILENO);
+        close(in_fd);
+    }
+    if (out_fd != STDOUT_FILENO) {
+        dup2(out_fd, STDOUT_FILENO);
+        close(out_fd);
+    }
+    if (close_fd != -1) {
+        close(close_fd);
+    }
+    if (apply_redirections(arena, redirections) == -1) {
+        exit(1);
+    }
+    if (argc == 0) {
+        exit(0);
+    }
+    exec_program(argc, args);
+    return -1;
+}
 
-        char *args[100];
-        int i = 0;
 
-        char *token = strtok(command, " ");
-        while (token != NULL && i < 99) {
-            int has_wildcard = (strchr(token, '*') != NULL || strchr(token, '?') != NULL || strchr(token, '[') != NULL);
-            int is_escaped_token = 0;
+/**
+ * @brief Lance une commande dans un nouveau processus, sans l'attendre.
+ * 
+ * Les programmes externes sont lancés avec posix_spawn, qui évite de copier les
+ * tables de pages du shell (la glibc utilise clone(CLONE_VM | CLONE_VFORK)) :
+ * les branchements de pipes et les redirections sont décrits par des actions de
+ * fichier appliquées dans l'enfant avant l'exec. Seules les commandes internes
+ * et les commandes sans arguments passent encore par fork.
+ * 
+ * @param arena Arène de la ligne en cours.
+ * @param argc Nombre d'arguments.
+ * @param args Arguments étendus, terminés par `NULL`.
+ * @param redirections Redirections de la commande.
+ * @param in_fd Descripteur à utiliser comme entrée standard (STDIN_FILENO si aucun).
+ * @param out_fd Descripteur à utiliser comme sortie standard (STDOUT_FILENO si aucun).
+ * @param close_fd Descripteur à fermer dans l'enfant (extrémité de pipe inutile), ou -1.
+ * @param job Job auquel ajouter le processus (groupe de processus et terminal).
+ * @return pid_t PID du processus lancé, ou -1 si la commande n'a pas pu être lancée.
+ */
+pid_t launch_command(Arena *arena, int argc, char **args, const Redirection *redirections,
+                     int in_fd, int out_fd, int close_fd, Job *job) {
+    pid_t pid = -1;
 
-            remove_quotes(token);
+    if (argc == 0 || needs_shell_process(args[0])) {
+        fflush(stdout);
+        long long span = trace_begin();
+        pid = fork_command(arena, argc, args, redirections, in_fd, out_fd, close_fd, job);
+        trace_end(span, "process", "fork", argc > 0 ? args[0] : NULL);
+        if (pid > 0 && job_add_process(job, pid, argc > 0 ? args[0] : "") == -1) {
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            pid = -1;
+        }
+        return pid;
+    }
 
-            
-            for (int j = 0; token[j] != '\0'; j++) {
-                if (is_escaped(token, j)) {
-                    is_escaped_token = 1;
-                    break;
-                }
-            }
+    const char *path = path_cache_lookup(args[0]);
+    if (!path) {
+        fprintf(stderr, "Command not found: %s\n", args[0]);
+        return -1;
+    }
 
-            
-            if (has_wildcard && !is_escaped_token) {
-                int num_matches = 0;
-                char **matches = expand_wildcard(token, &num_matches);
-                if (matches) {
-                    for (int j = 0; j < num_matches && i < 99; j++) {
-                        args[i++] = matches[j];
-                    }
-                    free(matches);
-                }
-            } else {
-                args[i++] = token;
-            }
-            token = strtok(NULL, " ");
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+
+    int ok = 1;
+    // Le terminal est donné au groupe du job dans l'enfant, avant que l'entrée soit redirigée
+    int terminal = job_terminal(job);
+    if (terminal != -1) {
+        ok = posix_spawn_file_actions_addtcsetpgrp_np(&actions, terminal) == 0;
+    }
+    if (in_fd != STDIN_FILENO) {
+        ok = ok && posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO) == 0
+                && posix_spawn_file_actions_addclose(&actions, in_fd) == 0;
+    }
+    if (out_fd != STDOUT_FILENO) {
+        ok = ok && posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO) == 0
+                && posix_spawn_file_actions_addclose(&actions, out_fd) == 0;
+    }
+    if (close_fd != -1) {
+        ok = ok && posix_spawn_file_actions_addclose(&actions, close_fd) == 0;
+    }
+    ok = ok && add_redirection_actions(arena, &actions, redirections) == 0;
+
+    // Le shell ignore SIGPIPE et les signaux de contrôle des jobs, et bloque SIGCHLD/SIGINT
+    // (boucle d'événements) ; l'enfant doit retrouver le comportement par défaut et un masque vide
+    posix_spawnattr_t attr;
+    sigset_t default_signals, empty_mask;
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    posix_spawnattr_init(&attr);
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGPIPE);
+    sigaddset(&default_signals, SIGTSTP);
+    sigaddset(&default_signals, SIGTTIN);
+    sigaddset(&default_signals, SIGTTOU);
+    sigemptyset(&empty_mask);
+    posix_spawnattr_setsigdefault(&attr, &default_signals);
+    posix_spawnattr_setsigmask(&attr, &empty_mask);
+
+    pid_t pgid = job_next_pgid(job);
+    if (pgid != -1) {
+        posix_spawnattr_setpgroup(&attr, pgid);
+        flags |= POSIX_SPAWN_SETPGROUP;
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    if (!ok) {
+        fprintf(stderr, "%s: could not set up redirections\n", args[0]);
+    } else {
+        long long span = trace_begin();
+        int err = posix_spawn(&pid, path, &actions, &attr, args, get_environment());
+        trace_end(span, "process", "spawn", args[0]);
+        if (err == E2BIG) {
+            fprintf(stderr, "%s: %s (%d arguments, limit %zu bytes); use 'chunk %s ...' to run it in batches\n",
+                    args[0], strerror(err), argc, chunk_argument_budget(), args[0]);
+            pid = -1;
+        } else if (err != 0) {
+            fprintf(stderr, "%s: %s\n", args[0], strerror(err));
+            pid = -1;
+        }
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (pid > 0 && job_add_process(job, pid, argc > 0 ? args[0] : "") == -1) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        pid = -1;
+    }
+    return pid;
+}
+
+
+/**
+ * @brief Exécute une commande avec ou sans arguments.
+ * 
+ * Les fonctions et les commandes internes (y compris `myls` et `myps`) sont exécutées
+ * dans le shell, sans fork, leurs redirections étant appliquées puis annulées autour
+ * de l'appel ; les autres sont lancées dans un processus enfant, au premier plan ou
+ * en arrière-plan. Une fonction masque la commande interne du même nom.
+ * 
+ * @param arena Arène de la ligne en cours.
+ * @param cmd La commande simple à exécuter (mots et redirections).
+ * @param text Texte source de la commande, utilisé pour la liste des jobs.
+ * @param background 1 pour lancer la commande en arrière-plan.
+ * @return int Le code de retour de la commande après son exécution.
+ * 
+ */
+int execute_command(Arena *arena, const SimpleCommand *cmd, const char *text, int background) {
+    int argc = 0;
+    char **args = expand_arguments(arena, cmd, &argc);
+    if (!args) {
+        return 1;
+    }
+
+    if (argc > 0 && !background) {
+        Function *function = find_function(args[0]);
+        if (function) {
+            return call_function(arena, function, argc, args, cmd->redirections);
         }
-        args[i] = NULL;
 
-        
-        if (strcmp(args[0], "myls") == 0) {
-            myls_run(i, args);
-            exit(0);
-        } else {
-            if (execvp(args[0], args) == -1) {
-                fprintf(stderr, "Command not found: %s\n", args[0]);
-                exit(127);
-            }
+        const Builtin *builtin = find_builtin(args[0], strlen(args[0]));
+        if (builtin) {
+            StageUsage usage;
+            long long span = trace_begin();
+            stage_usage_begin(&usage, args[0]);
+            int status = run_builtin(builtin, argc, args, arena, cmd->redirections);
+            stage_usage_end(&usage, status);
+            trace_end(span, "builtin", args[0], text);
+            accounting_add(&usage);
+            return status;
         }
-    } else if (pid > 0) {
-        if (background) {
-            add_job(pid, command); 
-            printf("[%d] %d\n", job_count, pid);
-        } else {
-            int status;
-            if (waitpid(pid, &status, 0) == -1) {
-                perror("waitpid failed");
-                return 127;
-            }
-            if (WIFEXITED(status)) {
-                return WEXITSTATUS(status);
-            }
+    }
+
+    Job *job = job_create(text, !background);
+    if (!job) {
+        return 1;
+    }
+
+    pid_t pid = launch_command(arena, argc, args, cmd->redirections, STDIN_FILENO, STDOUT_FILENO, -1, job);
+    if (pid == -1) {
+        remove_job(job);
+        return 127;
+    }
+
+    if (background) {
+        put_job_in_background(job);
+        return 0;
+    }
+
+    JobProcess result;
+    long long span = trace_begin();
+    int status = wait_for_job(job, &result);
+    trace_end(span, "process", "wait", text);
+    if (result.state == PROCESS_DONE) {
+        accounting_add_process(&result);
+    }
+    return status;
+}
+
+
+/**
+ * @brief Lance une liste (`&&`, `||`, `;`) en arrière-plan dans un sous-shell.
+ * 
+ * Le sous-shell forme un job à lui seul ; le contrôle des jobs y est désactivé
+ * pour que ses commandes restent dans son groupe de processus.
+ * 
+ * @param arena Arène de la ligne en cours.
+ * @param node Liste à exécuter.
+ * @return int 0 si le sous-shell a été lancé, 127 sinon.
+ */
+static int run_background_list(Arena *arena, const Node *node) {
+    Job *job = job_create(node->text ? node->text : "(list)", 0);
+    if (!job) {
+        return 1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        trace_drop_in_child();
+        job_setup_child(job);
+        job_control_disable();
+        exit(execute_node(arena, node));
+    }
+    if (pid == -1 || job_add_process(job, pid, "mysh") == -1) {
+        if (pid == -1) {
+            perror("fork failed");
         }
-    } else {
-        perror("fork failed");
+        remove_job(job);
         return 127;
     }
+    put_job_in_background(job);
     return 0;
 }
 
 
+/**
+ * @brief Exécute au premier plan une commande simple ou un pipeline.
+ * 
+ * Le code de retour et le nom de la commande sont mémorisés pour `status`.
+ * 
+ * @param arena Arène de la ligne en cours.
+ * @param node Nœud NODE_COMMAND ou NODE_PIPELINE.
+ * @return int Le code de retour de la commande.
+ */
+int execute_simple_node(Arena *arena, const Node *node) {
+    foreground_running = 1;
+    accounting_begin(node->text);
+    if (node->type == NODE_COMMAND) {
+        last_status = execute_command(arena, &node->command, node->text, 0);
+    } else {
+        last_status = handle_pipeline(arena, node->pipeline.stages, node->pipeline.num_stages,
+                                      node->text, 0);
+    }
+    accounting_end();
+    foreground_running = 0;
+
+    strncpy(last_command_name, node->text, MAX_COMMAND_LENGTH - 1);
+    if (node->timed) {
+        fprintf(stderr, "%s : ", node->text);
+        print_usage(stderr, &accounting_last()->total);
+    }
+    return last_status;
+}
+
 
 /**
- * @brief Remplace les variables dans une commande par leurs valeurs correspondantes.
+ * @brief Lance un nœud NODE_BACKGROUND.
  * 
- * Cette fonction analyse une commande donnée pour identifier les variables représentées par `$<nom>`.
- * Elle remplace chaque variable trouvée par sa valeur associée, si elle est définie. Si une variable
- * n'est pas définie, un message d'erreur est affiché.
+ * Une liste lancée en arrière-plan qui n'est pas une simple commande ou un
+ * pipeline est exécutée dans un sous-shell.
  * 
- * @param command La commande contenant potentiellement des variables à remplacer. 
- *        La commande d'origine est modifiée en place pour refléter les substitutions.
+ * @param arena Arène de la ligne en cours.
+ * @param node Nœud NODE_BACKGROUND.
+ * @return int 0 si le job a été lancé.
  */
-void substitute_variables(char *command) {
-    char buffer[1024];
-    char *src = command, *dest = buffer;
-
-    while (*src) {
-        if (*src == '$') {
-            src++;
-            char var_name[64] = {0};
-            char *var_start = var_name;
-
-            while (*src && isalnum(*src) && (var_start - var_name) < (int)sizeof(var_name) - 1) {
-                *var_start++ = *src++;
-            }
-            *var_start = '\0';
-
-            char *value = get_variable_value(var_name);
-            if (value) {
-                size_t value_len = strlen(value);
-                size_t remaining_space = sizeof(buffer) - (dest - buffer) - 1;
-                if (value_len > remaining_space) {
-                    fprintf(stderr, "Variable substitution exceeds buffer size: $%s\n", var_name);
-                    return;
-                }
-                strncpy(dest, value, remaining_space);
-                dest += value_len;
-            } else {
-                fprintf(stderr, "Variable not defined: $%s\n", var_name);
-            }
-        } else {
-            if ((dest - buffer) >= (int)sizeof(buffer) - 1) {
-                fprintf(stderr, "Buffer overflow detected during substitution.\n");
-                return;
-            }
-            *dest++ = *src++;
-        }
+int execute_background_node(Arena *arena, const Node *node) {
+    const Node *child = node->child;
+    if (child->type == NODE_COMMAND) {
+        last_status = execute_command(arena, &child->command, child->text, 1);
+    } else if (child->type == NODE_PIPELINE) {
+        last_status = handle_pipeline(arena, child->pipeline.stages, child->pipeline.num_stages,
+                                      child->text, 1);
+    } else {
+        last_status = run_background_list(arena, child);
     }
-    *dest = '\0';
+    return last_status;
+}
 
-    strncpy(command, buffer, sizeof(buffer) - 1);
-    command[sizeof(buffer) - 1] = '\0';
+
+/**
+ * @brief Exécute un arbre syntaxique.
+ * 
+ * L'arbre est compilé puis exécuté par l'interpréteur : les listes `&&` et `||`,
+ * les conditions et les boucles deviennent des sauts, et les corps de boucle ne
+ * sont ni réanalysés ni recopiés à chaque itération.
+ * 
+ * @param arena Arène de la ligne en cours.
+ * @param node Racine de l'arbre.
+ * @return int Le code de retour de la dernière commande exécutée.
+ */
+int execute_node(Arena *arena, const Node *node) {
+    Program *program = compile_program(arena, node);
+    if (!program) {
+        return last_status = 1;
+    }
+    return run_program(arena, program);
 }
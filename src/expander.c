@@ -0,0 +1,420 @@
+#include "../include/expander.h"
+#include "../include/parser.h"
+#include "../include/variable.h"
+#include "../include/arithmetic.h"
+#include "../include/process_manager.h"
+#include "../include/interpreter.h"
+#include "../include/mysh.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+
+/**
+ * @brief Sortie de l'expansion, dans un tampon de l'arène.
+ *
+ * L'expansion se fait en une seule passe : un `$((i++))` ne doit être évalué
+ * qu'une fois. Le tampon est réalloué dans l'arène s'il devient trop petit ;
+ * l'ancien est libéré avec le reste de la ligne.
+ */
+typedef struct Output {
+    Arena *arena;   ///< Arène de la ligne en cours.
+    char *buffer;   ///< Destination.
+    size_t len;     ///< Octets produits.
+    size_t cap;     ///< Capacité du tampon.
+    bool error;     ///< Expansion invalide ou mémoire épuisée (le message est déjà affiché).
+    bool glob;      ///< Motif pour expand_wildcard : les jokers protégés sont précédés d'un `\`.
+    bool quoted;    ///< Le texte émis est protégé (guillemets ou `\`).
+    struct Output *literal; ///< Motif : reçoit aussi le mot sans échappement (sinon `NULL`).
+} Output;
+
+
+/**
+ * @brief Ajoute des octets à la sortie, tels quels.
+ */
+static void emit_raw(Output *out, const char *data, size_t len) {
+    if (out->len + len + 1 > out->cap) {
+        size_t cap = out->cap * 2;
+        while (cap < out->len + len + 1) {
+            cap *= 2;
+        }
+        char *buffer = arena_alloc(out->arena, cap);
+        if (!buffer) {
+            out->error = true;
+            return;
+        }
+        memcpy(buffer, out->buffer, out->len);
+        out->buffer = buffer;
+        out->cap = cap;
+    }
+    memcpy(out->buffer + out->len, data, len);
+    out->len += len;
+}
+
+
+/**
+ * @brief Ajoute des octets à la sortie ; dans un motif, les caractères protégés
+ * qui ont un sens pour les jokers (`*`, `?`, `[`, `]`, `\`) sont échappés.
+ */
+static void emit(Output *out, const char *data, size_t len) {
+    if (out->literal) {
+        emit_raw(out->literal, data, len);
+    }
+    if (!out->glob || !out->quoted) {
+        emit_raw(out, data, len);
+        return;
+    }
+    const char *start = data;
+    for (const char *c = data; c < data + len; c++) {
+        if (memchr("*?[]\\", *c, 5)) {
+            emit_raw(out, start, c - start);
+            emit_raw(out, "\\", 1);
+            start = c;
+        }
+    }
+    emit_raw(out, start, data + len - start);
+}
+
+
+/**
+ * @brief Ajoute un entier en décimal à la sortie.
+ */
+static void emit_number(Output *out, long long value) {
+    char number[24];
+    int len = snprintf(number, sizeof(number), "%lld", value);
+    emit(out, number, len);
+}
+
+
+/**
+ * @brief Indique si un caractère peut faire partie d'un nom de variable.
+ */
+static bool is_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+
+/**
+ * @brief Indique si un caractère désigne un paramètre spécial (`$?`, `$$`, `$!`, `$#`, `$@`, `$*`).
+ */
+static bool is_special_parameter(char c) {
+    return c == '?' || c == '$' || c == '!' || c == '#' || c == '@' || c == '*';
+}
+
+
+/**
+ * @brief Valeur d'un paramètre spécial, écrite dans `number` si c'est un nombre.
+ *
+ * @return const char* La valeur (vide pour `$!` si aucun job n'a été lancé en arrière-plan).
+ */
+static const char *special_parameter(char name, char number[24], size_t *value_len) {
+    long long value;
+    switch (name) {
+        case '?':
+            value = last_status > 0 ? last_status : 0;
+            break;
+        case '$':
+            value = shell_pid;
+            break;
+        case '#':
+            value = positional_count();
+            break;
+        case '@':
+        case '*':
+            return positional_joined(value_len);
+        default:
+            if (last_background_pid <= 0) {
+                *value_len = 0;
+                return number;
+            }
+            value = last_background_pid;
+            break;
+    }
+    *value_len = snprintf(number, 24, "%lld", value);
+    return number;
+}
+
+
+/**
+ * @brief Valeur d'un paramètre (variable, paramètre positionnel ou spécial).
+ *
+ * @return const char* La valeur, ou `NULL` si la variable n'est pas définie.
+ */
+static const char *parameter_value(const char *name, size_t name_len, char number[24], size_t *value_len) {
+    if (name_len == 1 && is_special_parameter(name[0])) {
+        return special_parameter(name[0], number, value_len);
+    }
+    if (isdigit((unsigned char)name[0])) {
+        size_t index = 0;
+        for (size_t i = 0; i < name_len && index < 1000000; i++) {
+            index = index * 10 + (name[i] - '0');
+        }
+        return positional_parameter(index, value_len);
+    }
+    return get_variable_value_n(name, name_len, value_len);
+}
+
+
+static void expand_text(const char *text, const char *end, Output *out);
+
+
+/**
+ * @brief Étend un `$((...))` : les paramètres de l'expression sont étendus, puis
+ * elle est évaluée et remplacée par sa valeur.
+ *
+ * @return const char* Position qui suit le `))`.
+ */
+static const char *expand_arithmetic(const char *dollar, const char *end, Output *out) {
+    const char *expr = dollar + 3;
+    const char *close = find_arithmetic_end(expr);
+    if (!close || close + 2 > end) {
+        fprintf(stderr, "mysh: %.*s: bad substitution\n", (int)(end - dollar), dollar);
+        out->error = true;
+        return end;
+    }
+
+    // L'expression étendue est écrite provisoirement à la fin de la sortie, sans échappement
+    size_t start = out->len;
+    bool glob = out->glob;
+    Output *literal = out->literal;
+    out->glob = false;
+    out->literal = NULL;
+    expand_text(expr, close, out);
+    out->glob = glob;
+    out->literal = literal;
+    long long value;
+    if (!out->error && arith_evaluate(out->buffer + start, out->len - start, &value) == -1) {
+        out->error = true;
+    }
+    out->len = start;
+    if (!out->error) {
+        emit_number(out, value);
+    }
+    return close + 2;
+}
+
+
+/**
+ * @brief Étend le paramètre qui commence au `$` donné.
+ *
+ * @return const char* Position qui suit le paramètre dans le mot.
+ */
+static const char *expand_parameter(const char *dollar, const char *end, Output *out) {
+    char number[24];
+    size_t value_len;
+    const char *value;
+
+    // `$1` ne prend qu'un chiffre : `${10}` pour les suivants
+    if (dollar + 1 < end && (is_special_parameter(dollar[1]) || isdigit((unsigned char)dollar[1]))) {
+        value = parameter_value(dollar + 1, 1, number, &value_len);
+        emit(out, value, value_len);
+        return dollar + 2;
+    }
+
+    if (dollar + 1 < end && is_name_char(dollar[1])) {
+        const char *name = dollar + 1;
+        const char *name_end = name;
+        while (name_end < end && is_name_char(*name_end)) {
+            name_end++;
+        }
+        value = parameter_value(name, name_end - name, number, &value_len);
+        if (value) {
+            emit(out, value, value_len);
+        } else {
+            fprintf(stderr, "Variable not defined: $%.*s\n", (int)(name_end - name), name);
+        }
+        return name_end;
+    }
+
+    if (dollar + 2 < end && dollar[1] == '(' && dollar[2] == '(') {
+        return expand_arithmetic(dollar, end, out);
+    }
+
+    if (dollar + 1 >= end || dollar[1] != '{') {
+        // Un `$` qui n'introduit aucun paramètre reste tel quel
+        emit(out, "$", 1);
+        return dollar + 1;
+    }
+
+    const char *body = dollar + 2;
+    const char *close = find_closing_brace(body);
+    if (!close || close >= end) {
+        fprintf(stderr, "mysh: %.*s: bad substitution\n", (int)(end - dollar), dollar);
+        out->error = true;
+        return end;
+    }
+
+    bool length = body[0] == '#' && body + 1 < close;
+    const char *name = length ? body + 1 : body;
+    const char *name_end = name;
+    if (is_special_parameter(*name_end)) {
+        name_end++;
+    } else if (isdigit((unsigned char)*name_end)) {
+        while (name_end < close && isdigit((unsigned char)*name_end)) {
+            name_end++;
+        }
+    } else {
+        while (name_end < close && is_name_char(*name_end)) {
+            name_end++;
+        }
+    }
+
+    bool has_default = !length && close - name_end >= 2 && name_end[0] == ':' && name_end[1] == '-';
+    if (name_end == name || (name_end != close && !has_default)) {
+        fprintf(stderr, "mysh: %.*s: bad substitution\n", (int)(close + 1 - dollar), dollar);
+        out->error = true;
+        return close + 1;
+    }
+
+    value = parameter_value(name, name_end - name, number, &value_len);
+    if (length) {
+        emit_number(out, value ? (long long)value_len : 0);
+    } else if (has_default && (!value || value_len == 0)) {
+        expand_text(name_end + 2, close, out);
+    } else if (value) {
+        emit(out, value, value_len);
+    } else {
+        fprintf(stderr, "Variable not defined: $%.*s\n", (int)(name_end - name), name);
+    }
+    return close + 1;
+}
+
+
+/**
+ * @brief Étend un texte (un mot ou la valeur par défaut d'un `${nom:-...}`) et retire ses guillemets.
+ */
+static void expand_text(const char *text, const char *end, Output *out) {
+    char quote = 0;
+    const char *s = text;
+    // Valeur par défaut d'un `${nom:-...}` entre guillemets doubles : déjà protégée
+    bool inherited = out->quoted;
+
+    while (s < end && !out->error) {
+        out->quoted = inherited || quote != 0;
+        if (quote == '\'') {
+            const char *close = memchr(s, '\'', end - s);
+            const char *stop = close ? close : end;
+            emit(out, s, stop - s);
+            s = close ? close + 1 : end;
+            quote = 0;
+        } else if (*s == '$') {
+            s = expand_parameter(s, end, out);
+        } else if (quote == '"' && *s == '"') {
+            quote = 0;
+            s++;
+        } else if (quote == '"' && *s == '\\' && s + 1 < end && (s[1] == '"' || s[1] == '\\' || s[1] == '$')) {
+            emit(out, s + 1, 1);
+            s += 2;
+        } else if (!quote && (*s == '\'' || *s == '"')) {
+            quote = *s++;
+        } else if (!quote && *s == '\\' && s + 1 < end) {
+            out->quoted = true;
+            emit(out, s + 1, 1);
+            s += 2;
+        } else {
+            // Copie d'un seul tenant jusqu'au prochain caractère spécial
+            const char *run = s + 1;
+            while (run < end && *run != '$' && *run != '\'' && *run != '"' && *run != '\\') {
+                run++;
+            }
+            emit(out, s, run - s);
+            s = run;
+        }
+    }
+    out->quoted = inherited;
+}
+
+
+/**
+ * @brief Étend un mot en une passe ; si `literal` est donné, le résultat est un
+ * motif et `*literal` reçoit le mot final.
+ */
+static char *expand(Arena *arena, const char *word, char **literal) {
+    if (literal) {
+        *literal = (char *)word;
+    }
+    if (!strchr(word, '$')) {
+        if (!strpbrk(word, "'\"\\")) {
+            return (char *)word;
+        }
+        if (!literal) {
+            char *copy = arena_strndup(arena, word, strlen(word));
+            if (copy) {
+                remove_quotes(copy);
+            }
+            return copy;
+        }
+    }
+
+    long long span = trace_begin();
+    size_t len = strlen(word);
+    Output plain = { arena, NULL, 0, len + 64, false, false, false, NULL };
+    Output out = { arena, NULL, 0, 2 * len + 64, false, literal != NULL, false, literal ? &plain : NULL };
+    out.buffer = arena_alloc(arena, out.cap);
+    if (literal && !(plain.buffer = arena_alloc(arena, plain.cap))) {
+        return NULL;
+    }
+    if (!out.buffer) {
+        return NULL;
+    }
+    expand_text(word, word + len, &out);
+    if (out.error || plain.error) {
+        return NULL;
+    }
+    out.buffer[out.len] = '\0';
+    if (literal) {
+        plain.buffer[plain.len] = '\0';
+        *literal = plain.buffer;
+    }
+    trace_end(span, "expand", "substitute", word);
+    return out.buffer;
+}
+
+
+char *expand_word(Arena *arena, const char *word) {
+    return expand(arena, word, NULL);
+}
+
+
+char *expand_pattern(Arena *arena, const char *word, char **literal) {
+    return expand(arena, word, literal);
+}
+
+
+bool has_unquoted_wildcard(const char *word) {
+    char quote = 0;
+    for (const char *c = word; *c; c++) {
+        if (quote) {
+            if (*c == quote) {
+                quote = 0;
+            }
+        } else if (*c == '"' || *c == '\'') {
+            quote = *c;
+        } else if (*c == '\\' && c[1] != '\0') {
+            c++;
+        } else if (*c == '$' && c[1] == '(' && c[2] == '(') {
+            const char *close = find_arithmetic_end(c + 3);
+            if (!close) {
+                return false;
+            }
+            c = close + 1;
+        } else if (*c == '$' && c[1] == '{') {
+            const char *close = find_closing_brace(c + 2);
+            if (!close) {
+                return false;
+            }
+            c = close;
+        } else if (*c == '$' && is_special_parameter(c[1])) {
+            c++;
+        } else if (*c == '*' || *c == '?' || *c == '[') {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool is_unquoted_word(const char *word) {
+    return !strpbrk(word, "'\"\\");
+}
@@ -0,0 +1,804 @@
+#include "../include/interpreter.h"
+#include "../include/executor.h"
+#include "../include/expander.h"
+#include "../include/redirection.h"
+#include "../include/variable.h"
+#include "../include/event_loop.h"
+#include "../include/mysh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define FUNCTION_TABLE_SIZE 64
+#define MAX_CALL_DEPTH 1000
+
+
+typedef enum {
+    OP_COMMAND,          ///< Commande simple ou pipeline au premier plan (`node`).
+    OP_BACKGROUND,       ///< Commande, pipeline ou liste en arrière-plan (`node`).
+    OP_DEFINE,           ///< Définition de fonction (`node`).
+    OP_JUMP,             ///< Saut inconditionnel vers `operand`.
+    OP_JUMP_IF_FAILURE,  ///< Saut si le dernier code de retour est non nul.
+    OP_JUMP_IF_SUCCESS,  ///< Saut si le dernier code de retour est nul.
+    OP_FOR_BEGIN,        ///< Étend les mots d'un `for` (`node`) ; saut vers `operand` en cas d'échec.
+    OP_FOR_NEXT,         ///< Affecte l'élément suivant, ou termine la boucle et saute vers `operand`.
+    OP_POP_ITERATORS,    ///< Abandonne les `operand` boucles `for` les plus internes (`break`).
+    OP_SET_STATUS,       ///< Fixe le code de retour à `operand`.
+    OP_SLOT_CLEAR,       ///< Met à zéro le code mémorisé dans la case `operand`.
+    OP_SLOT_SAVE,        ///< Mémorise le code de retour dans la case `operand`.
+    OP_SLOT_LOAD,        ///< Restaure le code de retour mémorisé dans la case `operand`.
+    OP_RETURN,           ///< `return [n]` (`node`) : fin de la fonction.
+    OP_ERROR             ///< Affiche `message` et fixe le code de retour à 1.
+} Opcode;
+
+/**
+ * @brief Instruction de l'interpréteur.
+ */
+typedef struct {
+    Opcode op;
+    int operand;          ///< Cible d'un saut, nombre de boucles, code ou case selon l'opération.
+    const Node *node;     ///< Nœud exécuté (feuilles, `for`, définitions, `return`).
+    const char *message;  ///< Message d'OP_ERROR.
+} Instruction;
+
+struct Program {
+    Instruction *code;
+    int length;
+    int capacity;
+    int num_iterators;  ///< Profondeur maximale des boucles `for` imbriquées.
+    int num_slots;      ///< Profondeur maximale des boucles imbriquées.
+};
+
+/**
+ * @brief Boucle en cours de compilation, cible des `break` et `continue`.
+ */
+typedef struct Loop {
+    int continue_target;  ///< Instruction qui commence l'itération suivante.
+    int break_chain;      ///< Sauts de `break` à corriger, chaînés par leur `operand` (-1 en fin).
+    int base_depth;       ///< Boucles `for` ouvertes autour de la boucle.
+    int body_depth;       ///< Boucles `for` ouvertes dans le corps (la boucle comprise).
+    struct Loop *outer;
+} Loop;
+
+typedef struct {
+    Arena *arena;
+    Program *program;
+    Loop *loop;          ///< Boucle la plus interne, `NULL` hors boucle.
+    int iterator_depth;  ///< Boucles `for` ouvertes au point de compilation.
+    int slot_depth;      ///< Boucles ouvertes au point de compilation.
+    bool in_function;    ///< `return` est permis.
+    bool error;
+} Compiler;
+
+/**
+ * @brief Itérateur d'une boucle `for` en cours d'exécution.
+ */
+typedef struct {
+    char **items;     ///< Mots étendus.
+    int count;
+    int next;         ///< Prochain élément à affecter.
+    ArenaMark mark;   ///< Position de l'arène avant l'expansion des mots.
+} Iterator;
+
+struct Function {
+    char *name;
+    Arena arena;         ///< Copie du corps et programme compilé.
+    Program *program;
+    int active;          ///< Appels en cours.
+    bool removed;        ///< Redéfinie pendant un appel : libérée à la fin du dernier appel.
+    struct Function *next;
+};
+
+/**
+ * @brief Paramètres positionnels d'un appel de fonction.
+ */
+typedef struct Frame {
+    int argc;
+    char **args;         ///< `args[0]` est le nom de la fonction.
+    char *joined;        ///< `$@` et `$*`.
+    size_t joined_len;
+    struct Frame *previous;
+} Frame;
+
+static Function *functions[FUNCTION_TABLE_SIZE];
+static Frame *current_frame = NULL;
+static int call_depth = 0;
+
+static int define_function(const Node *node);
+
+
+/**
+ * @brief Ajoute une instruction au programme.
+ *
+ * @return int Indice de l'instruction, ou -1 si la mémoire est épuisée.
+ */
+static int emit(Compiler *c, Opcode op, int operand, const Node *node) {
+    Program *program = c->program;
+    if (program->length == program->capacity) {
+        int capacity = program->capacity ? program->capacity * 2 : 16;
+        Instruction *code = arena_alloc(c->arena, capacity * sizeof(Instruction));
+        if (!code) {
+            c->error = true;
+            return -1;
+        }
+        if (program->code) {
+            memcpy(code, program->code, program->length * sizeof(Instruction));
+        }
+        program->code = code;
+        program->capacity = capacity;
+    }
+    Instruction *in = &program->code[program->length];
+    in->op = op;
+    in->operand = operand;
+    in->node = node;
+    in->message = NULL;
+    return program->length++;
+}
+
+
+/**
+ * @brief Fait pointer un saut déjà émis vers l'instruction suivante.
+ */
+static void patch(Compiler *c, int jump) {
+    if (jump >= 0) {
+        c->program->code[jump].operand = c->program->length;
+    }
+}
+
+
+/**
+ * @brief Émet une erreur détectée à la compilation, affichée à l'exécution.
+ */
+static void emit_error(Compiler *c, const char *format, const char *name, const char *arg) {
+    char message[256];
+    snprintf(message, sizeof(message), format, name, arg);
+    int index = emit(c, OP_ERROR, 0, NULL);
+    if (index >= 0) {
+        c->program->code[index].message = arena_strndup(c->arena, message, strlen(message));
+    }
+}
+
+
+/**
+ * @brief Compile `break [n]` et `continue [n]`.
+ *
+ * Les boucles `for` quittées sont abandonnées, puis un saut mène à la fin
+ * (ou à l'itération suivante) de la n-ième boucle englobante.
+ */
+static void compile_loop_control(Compiler *c, const Node *node, bool is_break) {
+    const char *name = node->command.argv[0];
+    long count = 1;
+
+    if (node->command.argc == 2) {
+        char *end;
+        count = strtol(node->command.argv[1], &end, 10);
+        if (*end != '\0' || count <= 0) {
+            emit_error(c, "mysh: %s: %s: loop count out of range", name, node->command.argv[1]);
+            return;
+        }
+    }
+    if (!c->loop) {
+        emit_error(c, "mysh: %s: only meaningful in a `for', `while', or `until' loop%s", name, "");
+        return;
+    }
+
+    Loop *target = c->loop;
+    while (--count > 0 && target->outer) {
+        target = target->outer;
+    }
+
+    int pops = c->iterator_depth - (is_break ? target->base_depth : target->body_depth);
+    if (pops > 0) {
+        emit(c, OP_POP_ITERATORS, pops, NULL);
+    }
+    if (is_break) {
+        emit(c, OP_SET_STATUS, 0, NULL);
+        int jump = emit(c, OP_JUMP, target->break_chain, NULL);
+        if (jump >= 0) {
+            target->break_chain = jump;
+        }
+    } else {
+        emit(c, OP_JUMP, target->continue_target, NULL);
+    }
+}
+
+
+/**
+ * @brief Compile une commande simple : `break`, `continue` et `return` sont
+ * traités par l'interpréteur, les autres commandes sont des feuilles.
+ */
+static void compile_command(Compiler *c, const Node *node) {
+    const SimpleCommand *cmd = &node->command;
+
+    if (cmd->argc >= 1 && cmd->argc <= 2 && !cmd->redirections) {
+        const char *name = cmd->argv[0];
+        if (strcmp(name, "break") == 0 || strcmp(name, "continue") == 0) {
+            compile_loop_control(c, node, name[0] == 'b');
+            return;
+        }
+        if (strcmp(name, "return") == 0) {
+            if (c->in_function) {
+                emit(c, OP_RETURN, 0, node);
+            } else {
+                emit_error(c, "mysh: %s: can only `return' from a function%s", name, "");
+            }
+            return;
+        }
+    }
+    emit(c, OP_COMMAND, 0, node);
+}
+
+
+static void compile_node(Compiler *c, const Node *node);
+
+
+/**
+ * @brief Compile une boucle `while`/`until` ou `for`.
+ *
+ * while :  SLOT_CLEAR s ; L: condition ; JUMP_IF_* fin ; corps ; SLOT_SAVE s ; JUMP L ; fin: SLOT_LOAD s
+ * for :    SLOT_CLEAR s ; FOR_BEGIN ; L: FOR_NEXT fin ; corps ; SLOT_SAVE s ; JUMP L ; fin: SLOT_LOAD s
+ *
+ * La case mémorise le code de retour de la dernière itération : la condition
+ * qui arrête un `while` ne doit pas devenir le code de retour de la boucle.
+ */
+static void compile_loop(Compiler *c, const Node *node) {
+    int slot = c->slot_depth++;
+    if (c->slot_depth > c->program->num_slots) {
+        c->program->num_slots = c->slot_depth;
+    }
+    Loop loop = { .break_chain = -1, .base_depth = c->iterator_depth, .outer = c->loop };
+    int exit_jump, begin = -1;
+
+    emit(c, OP_SLOT_CLEAR, slot, NULL);
+    if (node->type == NODE_FOR) {
+        begin = emit(c, OP_FOR_BEGIN, 0, node);
+        c->iterator_depth++;
+        if (c->iterator_depth > c->program->num_iterators) {
+            c->program->num_iterators = c->iterator_depth;
+        }
+        loop.continue_target = c->program->length;
+        exit_jump = emit(c, OP_FOR_NEXT, 0, node);
+    } else {
+        loop.continue_target = c->program->length;
+        compile_node(c, node->loop.condition);
+        exit_jump = emit(c, node->loop.until ? OP_JUMP_IF_SUCCESS : OP_JUMP_IF_FAILURE, 0, NULL);
+    }
+    loop.body_depth = c->iterator_depth;
+
+    c->loop = &loop;
+    compile_node(c, node->type == NODE_FOR ? node->for_loop.body : node->loop.body);
+    c->loop = loop.outer;
+
+    emit(c, OP_SLOT_SAVE, slot, NULL);
+    emit(c, OP_JUMP, loop.continue_target, NULL);
+    patch(c, exit_jump);
+    emit(c, OP_SLOT_LOAD, slot, NULL);
+
+    if (node->type == NODE_FOR) {
+        c->iterator_depth--;
+    }
+    c->slot_depth--;
+
+    // Les `break` et l'échec de l'expansion des mots mènent après la boucle
+    patch(c, begin);
+    while (loop.break_chain >= 0) {
+        int next = c->program->code[loop.break_chain].operand;
+        patch(c, loop.break_chain);
+        loop.break_chain = next;
+    }
+}
+
+
+static void compile_node(Compiler *c, const Node *node) {
+    int jump, end;
+
+    if (c->error) {
+        return;
+    }
+    switch (node->type) {
+        case NODE_COMMAND:
+            compile_command(c, node);
+            break;
+
+        case NODE_PIPELINE:
+            emit(c, OP_COMMAND, 0, node);
+            break;
+
+        case NODE_BACKGROUND:
+            emit(c, OP_BACKGROUND, 0, node);
+            break;
+
+        case NODE_FUNCTION:
+            emit(c, OP_DEFINE, 0, node);
+            break;
+
+        case NODE_AND:
+        case NODE_OR:
+            compile_node(c, node->binary.left);
+            jump = emit(c, node->type == NODE_AND ? OP_JUMP_IF_FAILURE : OP_JUMP_IF_SUCCESS, 0, NULL);
+            compile_node(c, node->binary.right);
+            patch(c, jump);
+            break;
+
+        case NODE_SEQUENCE:
+            compile_node(c, node->binary.left);
+            compile_node(c, node->binary.right);
+            break;
+
+        case NODE_GROUP:
+            compile_node(c, node->child);
+            break;
+
+        case NODE_IF:
+            compile_node(c, node->if_clause.condition);
+            jump = emit(c, OP_JUMP_IF_FAILURE, 0, NULL);
+            compile_node(c, node->if_clause.then_part);
+            end = emit(c, OP_JUMP, 0, NULL);
+            patch(c, jump);
+            if (node->if_clause.else_part) {
+                compile_node(c, node->if_clause.else_part);
+            } else {
+                // Aucune branche exécutée : le code de retour est 0
+                emit(c, OP_SET_STATUS, 0, NULL);
+            }
+            patch(c, end);
+            break;
+
+        case NODE_WHILE:
+        case NODE_FOR:
+            compile_loop(c, node);
+            break;
+    }
+}
+
+
+/**
+ * @brief Compile un arbre, en autorisant ou non `return`.
+ */
+static Program *compile(Arena *arena, const Node *root, bool in_function) {
+    Program *program = arena_alloc(arena, sizeof(Program));
+    if (!program) {
+        return NULL;
+    }
+    memset(program, 0, sizeof(Program));
+
+    Compiler c = { .arena = arena, .program = program, .in_function = in_function };
+    compile_node(&c, root);
+    return c.error ? NULL : program;
+}
+
+
+Program *compile_program(Arena *arena, const Node *root) {
+    return compile(arena, root, false);
+}
+
+
+/**
+ * @brief Code de retour de `return [n]` : n, ou le code de la dernière commande.
+ */
+static int return_status(Arena *arena, const Node *node) {
+    if (node->command.argc < 2) {
+        return last_status > 0 ? last_status : 0;
+    }
+    const char *arg = expand_word(arena, node->command.argv[1]);
+    if (!arg) {
+        return 1;
+    }
+    char *end;
+    long value = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0') {
+        fprintf(stderr, "mysh: return: %s: numeric argument required\n", arg);
+        return 2;
+    }
+    return (int)(value & 0xff);
+}
+
+
+/**
+ * @brief Prépare l'itérateur d'une boucle `for` : mots étendus (jokers compris)
+ * ou paramètres positionnels.
+ *
+ * @return int 0 si réussi, -1 si l'expansion a échoué.
+ */
+static int begin_iterator(Arena *arena, const Node *node, Iterator *it) {
+    it->mark = arena_mark(arena);
+    it->next = 0;
+
+    if (!node->for_loop.words) {
+        it->items = current_frame ? current_frame->args + 1 : NULL;
+        it->count = current_frame ? current_frame->argc - 1 : 0;
+        return 0;
+    }
+
+    SimpleCommand words = { node->for_loop.num_words, node->for_loop.words, NULL };
+    it->items = expand_arguments(arena, &words, &it->count);
+    if (!it->items) {
+        arena_release(arena, it->mark);
+        return -1;
+    }
+    return 0;
+}
+
+
+int run_program(Arena *arena, const Program *program) {
+    Iterator *iterators = NULL;
+    int *slots = NULL;
+    int depth = 0;
+    int pc = 0;
+
+    if (program->num_iterators > 0 || program->num_slots > 0) {
+        iterators = arena_alloc(arena, program->num_iterators * sizeof(Iterator) + 1);
+        slots = arena_alloc(arena, program->num_slots * sizeof(int) + 1);
+        if (!iterators || !slots) {
+            return last_status = 1;
+        }
+    }
+
+    while (pc < program->length) {
+        const Instruction *in = &program->code[pc++];
+        ArenaMark mark;
+
+        switch (in->op) {
+            case OP_COMMAND:
+            case OP_BACKGROUND:
+                // Les arguments étendus ne survivent pas à la commande
+                mark = arena_mark(arena);
+                if (in->op == OP_COMMAND) {
+                    execute_simple_node(arena, in->node);
+                } else {
+                    execute_background_node(arena, in->node);
+                }
+                arena_release(arena, mark);
+                // Une commande tuée par Ctrl+C arrête aussi les boucles qui l'entourent
+                if (interactive && last_status == 128 + SIGINT) {
+                    pc = program->length;
+                }
+                break;
+
+            case OP_DEFINE:
+                last_status = define_function(in->node);
+                break;
+
+            case OP_JUMP:
+                if (in->operand < pc && event_loop_interrupted()) {
+                    last_status = 128 + SIGINT;
+                    pc = program->length;
+                } else {
+                    pc = in->operand;
+                }
+                break;
+
+            case OP_JUMP_IF_FAILURE:
+                if (last_status != 0) {
+                    pc = in->operand;
+                }
+                break;
+
+            case OP_JUMP_IF_SUCCESS:
+                if (last_status == 0) {
+                    pc = in->operand;
+                }
+                break;
+
+            case OP_FOR_BEGIN:
+                if (begin_iterator(arena, in->node, &iterators[depth]) == -1) {
+                    last_status = 1;
+                    pc = in->operand;
+                } else {
+                    depth++;
+                }
+                break;
+
+            case OP_FOR_NEXT: {
+                Iterator *it = &iterators[depth - 1];
+                if (it->next == it->count) {
+                    arena_release(arena, it->mark);
+                    depth--;
+                    pc = in->operand;
+                } else {
+                    set_local_variable(in->node->for_loop.variable, it->items[it->next++]);
+                }
+                break;
+            }
+
+            case OP_POP_ITERATORS:
+                depth -= in->operand;
+                arena_release(arena, iterators[depth].mark);
+                break;
+
+            case OP_SET_STATUS:
+                last_status = in->operand;
+                break;
+
+            case OP_SLOT_CLEAR:
+                slots[in->operand] = 0;
+                break;
+
+            case OP_SLOT_SAVE:
+                slots[in->operand] = last_status;
+                break;
+
+            case OP_SLOT_LOAD:
+                last_status = slots[in->operand];
+                break;
+
+            case OP_RETURN:
+                last_status = return_status(arena, in->node);
+                pc = program->length;
+                break;
+
+            case OP_ERROR:
+                fprintf(stderr, "%s\n", in->message);
+                last_status = 1;
+                break;
+        }
+    }
+
+    // `return` ou Ctrl+C au milieu de boucles `for`
+    if (depth > 0) {
+        arena_release(arena, iterators[0].mark);
+    }
+    return last_status;
+}
+
+
+/**
+ * @brief Copie une commande simple dans l'arène d'une fonction.
+ */
+static bool copy_command(Arena *arena, SimpleCommand *dst, const SimpleCommand *src) {
+    dst->argc = src->argc;
+    dst->argv = arena_alloc(arena, (src->argc + 1) * sizeof(char *));
+    if (!dst->argv) {
+        return false;
+    }
+    for (int i = 0; i < src->argc; i++) {
+        if (!(dst->argv[i] = arena_strndup(arena, src->argv[i], strlen(src->argv[i])))) {
+            return false;
+        }
+    }
+    dst->argv[src->argc] = NULL;
+
+    Redirection **tail = &dst->redirections;
+    for (const Redirection *r = src->redirections; r; r = r->next) {
+        Redirection *copy = arena_alloc(arena, sizeof(Redirection));
+        if (!copy || !(copy->target = arena_strndup(arena, r->target, strlen(r->target)))) {
+            return false;
+        }
+        copy->type = r->type;
+        copy->next = NULL;
+        *tail = copy;
+        tail = &copy->next;
+    }
+    *tail = NULL;
+    return true;
+}
+
+
+/**
+ * @brief Copie un arbre dans l'arène d'une fonction : le corps d'une fonction
+ * survit à la ligne qui l'a définie.
+ */
+static Node *copy_node(Arena *arena, const Node *node) {
+    if (!node) {
+        return NULL;
+    }
+    Node *copy = arena_alloc(arena, sizeof(Node));
+    if (!copy) {
+        return NULL;
+    }
+    *copy = *node;
+    if (node->text && !(copy->text = arena_strndup(arena, node->text, strlen(node->text)))) {
+        return NULL;
+    }
+
+    bool ok = true;
+    switch (node->type) {
+        case NODE_COMMAND:
+            ok = copy_command(arena, &copy->command, &node->command);
+            break;
+        case NODE_PIPELINE:
+            copy->pipeline.stages = arena_alloc(arena, node->pipeline.num_stages * sizeof(SimpleCommand));
+            ok = copy->pipeline.stages != NULL;
+            for (int i = 0; ok && i < node->pipeline.num_stages; i++) {
+                ok = copy_command(arena, &copy->pipeline.stages[i], &node->pipeline.stages[i]);
+            }
+            break;
+        case NODE_AND:
+        case NODE_OR:
+        case NODE_SEQUENCE:
+            ok = (copy->binary.left = copy_node(arena, node->binary.left)) &&
+                 (copy->binary.right = copy_node(arena, node->binary.right));
+            break;
+        case NODE_BACKGROUND:
+        case NODE_GROUP:
+            ok = (copy->child = copy_node(arena, node->child)) != NULL;
+            break;
+        case NODE_IF:
+            ok = (copy->if_clause.condition = copy_node(arena, node->if_clause.condition)) &&
+                 (copy->if_clause.then_part = copy_node(arena, node->if_clause.then_part)) &&
+                 (!node->if_clause.else_part ||
+                  (copy->if_clause.else_part = copy_node(arena, node->if_clause.else_part)));
+            break;
+        case NODE_WHILE:
+            ok = (copy->loop.condition = copy_node(arena, node->loop.condition)) &&
+                 (copy->loop.body = copy_node(arena, node->loop.body));
+            break;
+        case NODE_FOR:
+            ok = (copy->for_loop.variable = arena_strndup(arena, node->for_loop.variable,
+                                                          strlen(node->for_loop.variable))) &&
+                 (copy->for_loop.body = copy_node(arena, node->for_loop.body));
+            if (ok && node->for_loop.words) {
+                SimpleCommand words = { node->for_loop.num_words, node->for_loop.words, NULL }, dst;
+                ok = copy_command(arena, &dst, &words);
+                copy->for_loop.words = dst.argv;
+            }
+            break;
+        case NODE_FUNCTION:
+            ok = (copy->function.name = arena_strndup(arena, node->function.name,
+                                                      strlen(node->function.name))) &&
+                 (copy->function.body = copy_node(arena, node->function.body));
+            break;
+    }
+    return ok ? copy : NULL;
+}
+
+
+static unsigned int hash_name(const char *name) {
+    unsigned int hash = 2166136261u;
+    for (; *name; name++) {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+static void free_function(Function *function) {
+    arena_destroy(&function->arena);
+    free(function);
+}
+
+
+Function *find_function(const char *name) {
+    for (Function *f = functions[hash_name(name) & (FUNCTION_TABLE_SIZE - 1)]; f; f = f->next) {
+        if (strcmp(f->name, name) == 0) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Enregistre une fonction, en remplaçant celle qui porte le même nom.
+ *
+ * Le corps est copié puis compilé une fois pour toutes dans une arène propre à la
+ * fonction. Une fonction redéfinie pendant qu'elle s'exécute n'est libérée qu'à la
+ * fin de son dernier appel.
+ *
+ * @param node Nœud NODE_FUNCTION.
+ * @return int 0 si réussi, 1 sinon.
+ */
+static int define_function(const Node *node) {
+    Function *function = malloc(sizeof(Function));
+    if (!function) {
+        perror("malloc failed");
+        return 1;
+    }
+    arena_init(&function->arena);
+    function->active = 0;
+    function->removed = false;
+
+    const char *name = node->function.name;
+    Node *body = copy_node(&function->arena, node->function.body);
+    function->name = arena_strndup(&function->arena, name, strlen(name));
+    function->program = body ? compile(&function->arena, body, true) : NULL;
+    if (!function->name || !function->program) {
+        free_function(function);
+        return 1;
+    }
+
+    Function **link = &functions[hash_name(name) & (FUNCTION_TABLE_SIZE - 1)];
+    while (*link && strcmp((*link)->name, name) != 0) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        Function *old = *link;
+        function->next = old->next;
+        if (old->active > 0) {
+            old->removed = true;
+        } else {
+            free_function(old);
+        }
+    } else {
+        function->next = NULL;
+    }
+    *link = function;
+    return 0;
+}
+
+
+int call_function(Arena *arena, Function *function, int argc, char **args, const Redirection *redirections) {
+    if (call_depth >= MAX_CALL_DEPTH) {
+        fprintf(stderr, "mysh: %s: maximum function nesting level exceeded (%d)\n", args[0], MAX_CALL_DEPTH);
+        return 1;
+    }
+
+    Frame frame = { argc, args, NULL, 0, current_frame };
+    size_t size = 1;
+    for (int i = 1; i < argc; i++) {
+        size += strlen(args[i]) + 1;
+    }
+    frame.joined = arena_alloc(arena, size);
+    if (!frame.joined) {
+        return 1;
+    }
+    for (int i = 1; i < argc; i++) {
+        size_t len = strlen(args[i]);
+        if (i > 1) {
+            frame.joined[frame.joined_len++] = ' ';
+        }
+        memcpy(frame.joined + frame.joined_len, args[i], len);
+        frame.joined_len += len;
+    }
+    frame.joined[frame.joined_len] = '\0';
+
+    int saved_in = -1, saved_out = -1, saved_err = -1;
+    int status = 1;
+    if (redirections) {
+        fflush(stdout);
+        fflush(stderr);
+        saved_in = save_fd(STDIN_FILENO);
+        saved_out = save_fd(STDOUT_FILENO);
+        saved_err = save_fd(STDERR_FILENO);
+    }
+
+    if (!redirections || apply_redirections(arena, redirections) == 0) {
+        function->active++;
+        call_depth++;
+        current_frame = &frame;
+        status = run_program(arena, function->program);
+        current_frame = frame.previous;
+        call_depth--;
+        if (--function->active == 0 && function->removed) {
+            free_function(function);
+        }
+    }
+
+    if (redirections) {
+        fflush(stdout);
+        fflush(stderr);
+        restore_fd(saved_in, STDIN_FILENO);
+        restore_fd(saved_out, STDOUT_FILENO);
+        restore_fd(saved_err, STDERR_FILENO);
+        clearerr(stdout);
+    }
+    return status;
+}
+
+
+const char *positional_parameter(size_t index, size_t *len) {
+    const char *value;
+    if (index == 0) {
+        value = current_frame ? current_frame->args[0] : "mysh";
+    } else if (current_frame && index < (size_t)current_frame->argc) {
+        value = current_frame->args[index];
+    } else {
+        value = "";
+    }
+    *len = strlen(value);
+    return value;
+}
+
+
+size_t positional_count() {
+    return current_frame ? current_frame->argc - 1 : 0;
+}
+
+
+const char *positional_joined(size_t *len) {
+    *len = current_frame ? current_frame->joined_len : 0;
+    return current_frame ? current_frame->joined : "";
+}
@@ -0,0 +1,487 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "../include/mydu.h"
+#include "../include/work_pool.h"
+
+
+#define MYDU_DEFAULT_THREADS 8            ///< Threads par défaut (au plus un par processeur).
+#define MYDU_MAX_THREADS 64
+#define MYDU_SET_SHARDS 64                ///< Parties indépendantes (un verrou chacune) de l'ensemble des inodes.
+
+/**
+ * @brief Identité d'un fichier.
+ */
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+} DuInode;
+
+/**
+ * @brief Partie de l'ensemble des inodes déjà comptés : table à adressage ouvert.
+ *
+ * L'inode 0, qui ne désigne aucun fichier, marque les cases vides.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    DuInode *slots;
+    size_t count;
+    size_t cap;
+} DuShard;
+
+/**
+ * @brief Répertoire de l'arborescence mesurée.
+ */
+typedef struct DuNode {
+    char *path;
+    int depth;
+    uint64_t blocks;            ///< Blocs de 512 octets du répertoire et de ses fichiers.
+    char *errors;               ///< Messages pour stderr, ou `NULL`.
+    struct DuNode **children;   ///< Sous-répertoires, dans l'ordre de lecture.
+    size_t num_children;
+    size_t children_cap;
+    size_t next_child;          ///< Prochain enfant à parcourir lors de l'affichage.
+} DuNode;
+
+/**
+ * @brief Options de `mydu`.
+ */
+typedef struct {
+    int max_depth;              ///< `-d N` : profondeur maximale affichée (-1 : pas de limite).
+    bool one_file_system;       ///< `-x` : rester sur le système de fichiers de la racine.
+    int jobs;                   ///< `-j N` : threads du parcours.
+} MyduOptions;
+
+/**
+ * @brief État d'une exécution de `mydu`.
+ */
+typedef struct {
+    MyduOptions options;
+    WorkPool *pool;
+    dev_t root_dev;             ///< Système de fichiers de la racine en cours (`-x`).
+    DuShard shards[MYDU_SET_SHARDS];
+    atomic_bool failed;         ///< Un fichier ou répertoire n'a pas pu être lu.
+} Du;
+
+
+static uint64_t hash_inode(dev_t dev, ino_t ino) {
+    return ((uint64_t)ino * 0x9E3779B97F4A7C15ULL) ^ (uint64_t)dev;
+}
+
+
+/**
+ * @brief Ajoute un inode à l'ensemble des inodes comptés.
+ *
+ * @return bool `true` s'il n'y était pas encore (ou si la mémoire manque : mieux
+ * vaut compter deux fois un lien physique que l'oublier).
+ */
+static bool insert_inode(Du *du, dev_t dev, ino_t ino) {
+    uint64_t hash = hash_inode(dev, ino);
+    DuShard *shard = &du->shards[hash >> 58];
+    bool inserted = true;
+
+    pthread_mutex_lock(&shard->lock);
+    if ((shard->count + 1) * 10 > shard->cap * 7) {
+        size_t cap = shard->cap ? shard->cap * 2 : 256;
+        DuInode *slots = calloc(cap, sizeof(DuInode));
+        if (!slots) {
+            pthread_mutex_unlock(&shard->lock);
+            return true;
+        }
+        for (size_t i = 0; i < shard->cap; i++) {
+            if (shard->slots[i].ino != 0) {
+                size_t j = hash_inode(shard->slots[i].dev, shard->slots[i].ino) & (cap - 1);
+                while (slots[j].ino != 0) {
+                    j = (j + 1) & (cap - 1);
+                }
+                slots[j] = shard->slots[i];
+            }
+        }
+        free(shard->slots);
+        shard->slots = slots;
+        shard->cap = cap;
+    }
+
+    size_t i = hash & (shard->cap - 1);
+    while (shard->slots[i].ino != 0) {
+        if (shard->slots[i].ino == ino && shard->slots[i].dev == dev) {
+            inserted = false;
+            break;
+        }
+        i = (i + 1) & (shard->cap - 1);
+    }
+    if (inserted) {
+        shard->slots[i] = (DuInode){ dev, ino };
+        shard->count++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return inserted;
+}
+
+
+static DuNode *create_node(const char *parent_path, const char *name, int depth, uint64_t blocks) {
+    size_t parent_len = parent_path ? strlen(parent_path) : 0;
+    bool slash = parent_len > 0 && parent_path[parent_len - 1] != '/';
+    DuNode *node = calloc(1, sizeof(DuNode) + parent_len + slash + strlen(name) + 1);
+    if (!node) {
+        return NULL;
+    }
+    node->path = (char *)(node + 1);
+    sprintf(node->path, "%s%s%s", parent_path ? parent_path : "", slash ? "/" : "", name);
+    node->depth = depth;
+    node->blocks = blocks;
+    return node;
+}
+
+
+static void free_node(DuNode *node) {
+    free(node->errors);
+    free(node->children);
+    free(node);
+}
+
+
+/**
+ * @brief Ajoute un message aux erreurs d'un nœud, affichées avec son résultat.
+ */
+__attribute__((format(printf, 3, 4)))
+static void node_error(Du *du, DuNode *node, const char *format, ...) {
+    char *message;
+    va_list args;
+    va_start(args, format);
+    int len = vasprintf(&message, format, args);
+    va_end(args);
+    atomic_store(&du->failed, true);
+    if (len < 0) {
+        return;
+    }
+
+    size_t old_len = node->errors ? strlen(node->errors) : 0;
+    char *errors = realloc(node->errors, old_len + len + 1);
+    if (errors) {
+        memcpy(errors + old_len, message, len + 1);
+        node->errors = errors;
+    }
+    free(message);
+}
+
+
+static bool add_child(DuNode *node, DuNode *child) {
+    if (node->num_children == node->children_cap) {
+        size_t cap = node->children_cap ? node->children_cap * 2 : 8;
+        DuNode **children = realloc(node->children, cap * sizeof(DuNode *));
+        if (!children) {
+            return false;
+        }
+        node->children = children;
+        node->children_cap = cap;
+    }
+    node->children[node->num_children++] = child;
+    return true;
+}
+
+
+/**
+ * @brief Tâche du groupe de threads : additionne les blocs des fichiers d'un
+ * répertoire et met ses sous-répertoires en file.
+ *
+ * Chaque entrée est examinée une fois (fstatat relatif au répertoire ouvert, sans
+ * suivre les liens symboliques). Un fichier à plusieurs liens physiques n'est
+ * compté qu'à sa première rencontre ; un répertoire déjà vu (montage lié, boucle)
+ * ou, avec `-x`, situé sur un autre système de fichiers n'est pas parcouru.
+ */
+static void du_process(WorkPool *pool, int worker, void *item, void *context) {
+    Du *du = context;
+    DuNode *node = item;
+
+    int fd = openat(AT_FDCWD, node->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    DIR *dir = fd != -1 ? fdopendir(fd) : NULL;
+    if (!dir) {
+        node_error(du, node, "mydu: cannot read directory '%s': %s\n", node->path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+            node_error(du, node, "mydu: cannot access '%s/%s': %s\n", node->path, name, strerror(errno));
+            continue;
+        }
+
+        if (!S_ISDIR(st.st_mode)) {
+            if (st.st_nlink < 2 || insert_inode(du, st.st_dev, st.st_ino)) {
+                node->blocks += st.st_blocks;
+            }
+            continue;
+        }
+        if ((du->options.one_file_system && st.st_dev != du->root_dev) ||
+            !insert_inode(du, st.st_dev, st.st_ino)) {
+            continue;
+        }
+        DuNode *child = create_node(node->path, name, node->depth + 1, st.st_blocks);
+        if (!child || !add_child(node, child)) {
+            free(child);
+            node_error(du, node, "mydu: %s: out of memory\n", node->path);
+            break;
+        }
+    }
+    closedir(dir);
+
+    // Le premier sous-répertoire est lu en premier, comme dans un parcours séquentiel
+    for (size_t i = node->num_children; i-- > 0; ) {
+        if (!work_pool_push(pool, worker, node->children[i])) {
+            du_process(pool, worker, node->children[i], context);
+        }
+    }
+}
+
+
+/**
+ * @brief Affiche les totaux d'une arborescence lue, sous-répertoires avant leur
+ * parent, et libère ses nœuds.
+ */
+static void print_tree(Du *du, DuNode *root, FILE *out) {
+    size_t count = 0, cap = 64;
+    DuNode **stack = malloc(cap * sizeof(DuNode *));
+    if (!stack) {
+        perror("malloc failed");
+        return;
+    }
+    stack[count++] = root;
+
+    while (count > 0) {
+        DuNode *node = stack[count - 1];
+        if (node->next_child == 0 && node->errors) {
+            fflush(out);
+            fputs(node->errors, stderr);
+        }
+        if (node->next_child < node->num_children) {
+            if (count == cap) {
+                DuNode **grown = realloc(stack, cap * 2 * sizeof(DuNode *));
+                if (!grown) {
+                    // Les sous-répertoires restants ne sont ni affichés ni comptés
+                    perror("realloc failed");
+                    node->next_child = node->num_children;
+                    continue;
+                }
+                stack = grown;
+                cap *= 2;
+            }
+            stack[count++] = node->children[node->next_child++];
+            continue;
+        }
+
+        count--;
+        if (du->options.max_depth < 0 || node->depth <= du->options.max_depth) {
+            fprintf(out, "%llu\t%s\n", (unsigned long long)(node->blocks + 1) / 2, node->path);
+        }
+        if (count > 0) {
+            stack[count - 1]->blocks += node->blocks;
+        }
+        free_node(node);
+    }
+    free(stack);
+}
+
+
+/**
+ * @brief Mesure une arborescence et affiche ses totaux.
+ */
+static void measure_path(Du *du, const char *path, FILE *out) {
+    struct stat st;
+    if (lstat(path, &st) == -1) {
+        fflush(out);
+        fprintf(stderr, "mydu: cannot access '%s': %s\n", path, strerror(errno));
+        atomic_store(&du->failed, true);
+        return;
+    }
+    if (!insert_inode(du, st.st_dev, st.st_ino)) {
+        // Déjà compté par un argument précédent
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        fprintf(out, "%llu\t%s\n", (unsigned long long)(st.st_blocks + 1) / 2, path);
+        return;
+    }
+
+    DuNode *root = create_node(NULL, path, 0, st.st_blocks);
+    du->pool = root ? work_pool_create(du->options.jobs, du_process, du) : NULL;
+    if (!du->pool) {
+        perror("malloc failed");
+        free(root);
+        atomic_store(&du->failed, true);
+        return;
+    }
+    du->root_dev = st.st_dev;
+    if (work_pool_push(du->pool, 0, root)) {
+        work_pool_start(du->pool);
+        work_pool_wait(du->pool);
+    } else {
+        du_process(du->pool, 0, root, du);
+    }
+    work_pool_destroy(du->pool);
+    du->pool = NULL;
+    print_tree(du, root, out);
+}
+
+
+static int mydu_usage() {
+    fprintf(stderr, "Usage: mydu [-s] [-x] [-d depth] [-j threads] [paths...]\n");
+    return 2;
+}
+
+
+/**
+ * @brief Lit la valeur entière d'une option, comprise entre `min` et `max`.
+ */
+static int parse_number(const char *value, long min, long max, int *result) {
+    char *end;
+    long number = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || number < min || number > max) {
+        return -1;
+    }
+    *result = number;
+    return 0;
+}
+
+
+/**
+ * @brief Analyse les options de `mydu`.
+ *
+ * Les options reconnues sont :
+ * - `-s` : N'afficher que le total de chaque argument (`-d 0`).
+ * - `-d N`, `--max-depth=N` : N'afficher que les répertoires à N niveaux au plus
+ *   sous l'argument (tous restent comptés).
+ * - `-x`, `--one-file-system` : Ignorer les répertoires d'autres systèmes de fichiers.
+ * - `-j N` : Nombre de threads (par défaut un par processeur, au plus MYDU_DEFAULT_THREADS).
+ *
+ * @return int Index du premier chemin, ou -1 si les options sont invalides.
+ */
+static int parse_options(int argc, char *argv[], MyduOptions *options) {
+    options->max_depth = -1;
+    options->one_file_system = false;
+    options->jobs = 0;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        }
+        if (strcmp(arg, "--one-file-system") == 0) {
+            options->one_file_system = true;
+            continue;
+        }
+        if (strncmp(arg, "--max-depth", 11) == 0) {
+            const char *value = arg[11] == '=' ? arg + 12 : (arg[11] == '\0' && i + 1 < argc ? argv[++i] : "");
+            if (parse_number(value, 0, INT32_MAX, &options->max_depth) == -1) {
+                fprintf(stderr, "mydu: invalid maximum depth '%s'\n", value);
+                return -1;
+            }
+            continue;
+        }
+        if (arg[1] == '-') {
+            fprintf(stderr, "mydu: unknown option: %s\n", arg);
+            return -1;
+        }
+
+        for (int j = 1; arg[j] != '\0'; j++) {
+            if (arg[j] == 's') {
+                options->max_depth = 0;
+            } else if (arg[j] == 'x') {
+                options->one_file_system = true;
+            } else if (arg[j] == 'd' || arg[j] == 'j') {
+                // `-d1` ou `-d 1`
+                const char *value = arg[j + 1] ? &arg[j + 1] : (i + 1 < argc ? argv[++i] : "");
+                int status = arg[j] == 'd' ? parse_number(value, 0, INT32_MAX, &options->max_depth)
+                                           : parse_number(value, 1, MYDU_MAX_THREADS, &options->jobs);
+                if (status == -1) {
+                    fprintf(stderr, "mydu: invalid value for -%c: '%s'\n", arg[j], value);
+                    return -1;
+                }
+                break;
+            } else {
+                fprintf(stderr, "mydu: unknown option: -%c\n", arg[j]);
+                return -1;
+            }
+        }
+    }
+
+    if (options->jobs == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        options->jobs = cpus > MYDU_DEFAULT_THREADS ? MYDU_DEFAULT_THREADS : (cpus > 0 ? cpus : 1);
+    }
+    return i;
+}
+
+
+/**
+ * @brief Point d'entrée de la commande `mydu`.
+ *
+ * Chaque répertoire est lu par un groupe de threads à vol de tâches (work_pool.h),
+ * qui additionnent les blocs (st_blocks) de ses fichiers ; les totaux des
+ * sous-arbres sont ensuite cumulés et affichés par le thread appelant, dans
+ * l'ordre de lecture, sous-répertoires avant leur parent. Les liens physiques
+ * (même périphérique et inode) ne sont comptés qu'une fois pour toute la commande ;
+ * lorsque plusieurs threads les rencontrent, le répertoire auquel ils sont
+ * attribués peut varier, pas le total.
+ *
+ * @param argc Le nombre d'arguments passés à `mydu`.
+ * @param argv Le tableau des arguments passés à `mydu`.
+ * @param out Flux de sortie.
+ * @return int 0 si tout a pu être lu, 1 sinon, 2 pour une option invalide.
+ */
+int mydu_run(int argc, char *argv[], FILE *out) {
+    MyduOptions options;
+    int first = parse_options(argc, argv, &options);
+    if (first == -1) {
+        return mydu_usage();
+    }
+
+    Du *du = calloc(1, sizeof(Du));
+    if (!du) {
+        perror("calloc failed");
+        return 1;
+    }
+    du->options = options;
+    atomic_init(&du->failed, false);
+    for (int i = 0; i < MYDU_SET_SHARDS; i++) {
+        pthread_mutex_init(&du->shards[i].lock, NULL);
+    }
+
+    if (first == argc) {
+        measure_path(du, ".", out);
+    }
+    for (int i = first; i < argc; i++) {
+        measure_path(du, argv[i], out);
+    }
+    fflush(out);
+
+    int status = atomic_load(&du->failed) ? 1 : 0;
+    for (int i = 0; i < MYDU_SET_SHARDS; i++) {
+        free(du->shards[i].slots);
+        pthread_mutex_destroy(&du->shards[i].lock);
+    }
+    free(du);
+    return status;
+}
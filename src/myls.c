@@ -1,211 +1,1282 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <pwd.h>
 #include <grp.h>
 #include <time.h>
 #include <sys/xattr.h>
+#include <sys/syscall.h>
+#include "../include/myls.h"
+#include "../include/work_pool.h"
+
+
+#define MYLS_DIRENT_BUFFER (128 * 1024)   ///< Taille d'un lot de getdents64 (mode `-f`).
+#define MYLS_NAME_CACHE_SIZE 64           ///< Cases des caches uid → nom et gid → nom.
+#define MYLS_OUTPUT_BUFFER (64 * 1024)    ///< Sortie accumulée avant chaque écriture.
+#define MYLS_DEFAULT_THREADS 8            ///< Threads de `-R` par défaut (au plus un par processeur).
+#define MYLS_MAX_THREADS 64
+#define MYLS_INSERTION_SORT 16            ///< Taille sous laquelle le tri des noms passe au tri par insertion.
+#define MYLS_MAX_READY 1024               ///< Listings de `-R` lus mais pas encore affichés, au plus.
+
+/**
+ * @brief Entrée d'un répertoire, avec les informations de son unique fstatat.
+ */
+typedef struct {
+    const char *name;
+    size_t name_offset;     ///< Position du nom dans le tampon de noms pendant la lecture.
+    struct stat st;
+    bool valid;             ///< fstatat a réussi.
+} LsEntry;
+
+/**
+ * @brief Clé de tri d'une entrée, rangée dans un tableau compact pour que le tri
+ * ne parcoure pas les LsEntry.
+ */
+typedef struct {
+    uint64_t key;           ///< Clé du passage en cours : 8 octets du nom, date ou taille.
+    const char *name;
+    uint32_t index;         ///< Position de l'entrée dans le vecteur avant le tri.
+} LsSortKey;
+
+/**
+ * @brief Entrées d'un répertoire : tableau et noms extensibles, gardés d'un
+ * répertoire à l'autre pour ne pas réallouer à chaque lecture.
+ */
+typedef struct {
+    LsEntry *entries;
+    size_t count;
+    size_t cap;
+    LsSortKey *keys;        ///< Clés de tri (`cap` éléments).
+    LsSortKey *scratch;     ///< Tampon du tri par base (`cap` éléments).
+    char *names;            ///< Noms terminés par '\0', à la suite.
+    size_t names_len;
+    size_t names_cap;
+} LsVector;
+
+/**
+ * @brief Entrée renvoyée par getdents64.
+ */
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/**
+ * @brief Ordre des entrées d'un répertoire.
+ */
+typedef enum {
+    MYLS_SORT_NAME,         ///< Par défaut : ordre des octets des noms.
+    MYLS_SORT_TIME,         ///< `-t` : plus récent d'abord.
+    MYLS_SORT_SIZE          ///< `-S` : plus gros d'abord.
+} MylsSort;
+
+/**
+ * @brief Options de `myls`.
+ */
+typedef struct {
+    bool show_all;          ///< `-a` : fichiers cachés.
+    bool recursive;         ///< `-R` : sous-répertoires.
+    bool stream;            ///< `-f` : affichage pendant la lecture, sans tri.
+    MylsSort sort;
+    bool reverse;           ///< `-r` : ordre inverse.
+    int jobs;               ///< `-j N` : threads du parcours récursif.
+} MylsOptions;
+
+/**
+ * @brief Case d'un cache d'identifiants (utilisateurs ou groupes) vers leurs noms.
+ */
+typedef struct {
+    unsigned int id;
+    bool used;
+    char name[33];
+} NameCacheSlot;
+
+/**
+ * @brief Caches uid → nom et gid → nom (un par thread).
+ */
+typedef struct {
+    NameCacheSlot users[MYLS_NAME_CACHE_SIZE];
+    NameCacheSlot groups[MYLS_NAME_CACHE_SIZE];
+} NameCache;
+
+/**
+ * @brief Texte produit par `myls` : tampon de taille fixe vidé dans un flux, ou
+ * tampon extensible gardé en mémoire (listing préparé par un thread).
+ */
+typedef struct {
+    FILE *out;              ///< Flux de sortie, ou `NULL` pour garder le texte en mémoire.
+    char *data;
+    size_t len;
+    size_t cap;
+    bool failed;            ///< L'écriture a échoué (pipe fermé, mémoire épuisée...).
+} LsOutput;
+
+/**
+ * @brief Identité d'un répertoire, pour détecter les boucles (montages liés).
+ */
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+} DevIno;
+
+/**
+ * @brief État d'une exécution de `myls` : options, caches de noms et sortie.
+ */
+typedef struct {
+    MylsOptions options;
+    LsOutput output;
+    NameCache names;
+    LsVector *levels;       ///< Un vecteur par profondeur de la récursion.
+    DevIno *ancestors;      ///< Répertoire en cours de lecture à chaque profondeur.
+    int num_levels;
+} Myls;
+
+
+/**
+ * @brief Écrit la sortie accumulée dans son flux (sans effet pour une sortie en mémoire).
+ */
+static void flush_output(LsOutput *output) {
+    if (!output->out) {
+        return;
+    }
+    if (output->len > 0 && !output->failed &&
+        fwrite(output->data, 1, output->len, output->out) != output->len) {
+        output->failed = true;
+    }
+    output->len = 0;
+}
+
+
+/**
+ * @brief Agrandit une sortie en mémoire pour qu'elle puisse recevoir `len` octets de plus.
+ */
+static bool reserve_output(LsOutput *output, size_t len) {
+    if (output->len + len < output->cap) {
+        return true;
+    }
+    size_t cap = output->cap ? output->cap : 1024;
+    while (output->len + len >= cap) {
+        cap *= 2;
+    }
+    char *data = realloc(output->data, cap);
+    if (!data) {
+        output->failed = true;
+        return false;
+    }
+    output->data = data;
+    output->cap = cap;
+    return true;
+}
+
+
+/**
+ * @brief Ajoute du texte formaté à la sortie ; un flux est écrit quand son tampon est plein.
+ */
+__attribute__((format(printf, 2, 3)))
+static void output(LsOutput *output, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = output->cap - output->len;
+    int len = vsnprintf(output->data ? output->data + output->len : NULL, room, format, args);
+    va_end(args);
+
+    if (len < 0 || output->failed) {
+        return;
+    }
+    if ((size_t)len < room) {
+        output->len += len;
+        return;
+    }
+
+    va_start(args, format);
+    if (!output->out) {
+        if (reserve_output(output, len)) {
+            output->len += vsnprintf(output->data + output->len, output->cap - output->len, format, args);
+        }
+    } else {
+        flush_output(output);
+        if ((size_t)len < output->cap) {
+            output->len = vsnprintf(output->data, output->cap, format, args);
+        } else if (!output->failed && vfprintf(output->out, format, args) < 0) {
+            output->failed = true;
+        }
+    }
+    va_end(args);
+}
+
+
+/**
+ * @brief Ajoute un texte déjà formaté à une sortie vers un flux.
+ */
+static void output_bytes(LsOutput *output, const char *data, size_t len) {
+    if (output->failed || len == 0) {
+        return;
+    }
+    if (output->len + len > output->cap) {
+        flush_output(output);
+    }
+    if (len >= output->cap) {
+        output->failed = fwrite(data, 1, len, output->out) != len;
+        return;
+    }
+    memcpy(output->data + output->len, data, len);
+    output->len += len;
+}
+
+
+/**
+ * @brief Nom d'un utilisateur, mémorisé ; l'identifiant lui-même s'il n'a pas de nom.
+ */
+static const char *user_name(NameCache *names, uid_t uid) {
+    NameCacheSlot *slot = &names->users[uid % MYLS_NAME_CACHE_SIZE];
+    if (!slot->used || slot->id != uid) {
+        struct passwd pw, *result = NULL;
+        char buffer[4096];
+        if (getpwuid_r(uid, &pw, buffer, sizeof(buffer), &result) == 0 && result) {
+            snprintf(slot->name, sizeof(slot->name), "%s", pw.pw_name);
+        } else {
+            snprintf(slot->name, sizeof(slot->name), "%u", (unsigned int)uid);
+        }
+        slot->id = uid;
+        slot->used = true;
+    }
+    return slot->name;
+}
 
 
 /**
- * @brief Vérifie la présence d'attributs étendus sur un fichier ou répertoire.
- * 
- * @param path Le chemin du fichier ou répertoire.
+ * @brief Nom d'un groupe, mémorisé ; l'identifiant lui-même s'il n'a pas de nom.
+ */
+static const char *group_name(NameCache *names, gid_t gid) {
+    NameCacheSlot *slot = &names->groups[gid % MYLS_NAME_CACHE_SIZE];
+    if (!slot->used || slot->id != gid) {
+        struct group gr, *result = NULL;
+        char buffer[4096];
+        if (getgrgid_r(gid, &gr, buffer, sizeof(buffer), &result) == 0 && result) {
+            snprintf(slot->name, sizeof(slot->name), "%s", gr.gr_name);
+        } else {
+            snprintf(slot->name, sizeof(slot->name), "%u", (unsigned int)gid);
+        }
+        slot->id = gid;
+        slot->used = true;
+    }
+    return slot->name;
+}
+
+
+/**
+ * @brief Vérifie la présence d'attributs étendus sur une entrée d'un répertoire ouvert.
+ *
+ * Le nom est résolu depuis le descripteur du répertoire, sans reparcourir son
+ * chemin ; un lien symbolique est examiné lui-même, pas sa cible.
+ *
+ * @param dir_fd Descripteur du répertoire.
+ * @param name Le nom de l'entrée.
  * @return char '@' si des attributs étendus sont présents, sinon ' '.
  */
-char get_extended_attributes(const char *path) {
-    #ifdef __APPLE__
-        ssize_t attr_count = listxattr(path, NULL, 0, XATTR_NOFOLLOW);
-    #else
-        ssize_t attr_count = listxattr(path, NULL, 0);
-    #endif
-        return (attr_count > 0) ? '@' : ' ';
+static char get_extended_attributes(int dir_fd, const char *name) {
+#ifdef __APPLE__
+    int fd = openat(dir_fd, name, O_RDONLY | O_SYMLINK | O_EVTONLY);
+    ssize_t attr_count = fd == -1 ? -1 : flistxattr(fd, NULL, 0, XATTR_NOFOLLOW);
+    if (fd != -1) {
+        close(fd);
+    }
+#else
+    // flistxattr refuse les descripteurs O_PATH : /proc/self/fd mène au répertoire sans reparcourir son chemin
+    char proc_path[32 + NAME_MAX];
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d/%s", dir_fd, name);
+    ssize_t attr_count = llistxattr(proc_path, NULL, 0);
+#endif
+    return (attr_count > 0) ? '@' : ' ';
 }
 
 /**
  * @brief Affiche le nom d'un fichier ou répertoire avec une couleur appropriée.
- * 
+ *
  * Utilise des codes couleur pour différencier les types : bleu pour les répertoires,
  * cyan pour les liens symboliques et vert pour les fichiers exécutables.
- * 
+ *
+ * @param out Sortie de `myls`.
  * @param name Le nom du fichier ou répertoire.
  * @param mode Le mode (permissions et type) du fichier ou répertoire.
  */
-void print_colored(const char *name, mode_t mode) {
+static void print_colored(LsOutput *out, const char *name, mode_t mode) {
     if (S_ISDIR(mode)) {
-        printf("\033[34m%s\033[0m", name); 
+        output(out, "\033[34m%s\033[0m", name);
     } else if (S_ISLNK(mode)) {
-        printf("\033[36m%s\033[0m", name); 
+        output(out, "\033[36m%s\033[0m", name);
     } else if (mode & S_IXUSR) {
-        printf("\033[32m%s\033[0m", name); 
+        output(out, "\033[32m%s\033[0m", name);
     } else {
-        printf("%s", name);
+        output(out, "%s", name);
     }
 }
 
 
+/**
+ * @brief Affiche la ligne détaillée d'une entrée.
+ */
+static void print_entry(LsOutput *out, NameCache *names, int dir_fd, const LsEntry *entry) {
+    const struct stat *st = &entry->st;
+
+    char date[20];
+    struct tm timeinfo;
+    localtime_r(&st->st_mtime, &timeinfo);
+    strftime(date, sizeof(date), "%b %d %H:%M", &timeinfo);
+
+    output(out, "%c%c%c%c%c%c%c%c%c%c%c %3lu %-8s %-8s %8lld %s ",
+           S_ISDIR(st->st_mode) ? 'd' : (S_ISLNK(st->st_mode) ? 'l' : '-'),
+           st->st_mode & S_IRUSR ? 'r' : '-',
+           st->st_mode & S_IWUSR ? 'w' : '-',
+           st->st_mode & S_IXUSR ? 'x' : '-',
+           st->st_mode & S_IRGRP ? 'r' : '-',
+           st->st_mode & S_IWGRP ? 'w' : '-',
+           st->st_mode & S_IXGRP ? 'x' : '-',
+           st->st_mode & S_IROTH ? 'r' : '-',
+           st->st_mode & S_IWOTH ? 'w' : '-',
+           st->st_mode & S_IXOTH ? 'x' : '-',
+           get_extended_attributes(dir_fd, entry->name),
+           (unsigned long)st->st_nlink,
+           user_name(names, st->st_uid),
+           group_name(names, st->st_gid),
+           (long long)st->st_size,
+           date);
+
+    print_colored(out, entry->name, st->st_mode);
+
+    if (S_ISLNK(st->st_mode)) {
+        char link_target[1024];
+        ssize_t len = readlinkat(dir_fd, entry->name, link_target, sizeof(link_target) - 1);
+        if (len != -1) {
+            link_target[len] = '\0';
+            output(out, " -> %s", link_target);
+        }
+    }
+
+    output(out, "\n");
+}
+
 
 /**
- * @brief Liste les fichiers d'un répertoire avec leurs détails, optionnellement de manière récursive.
- * 
- * Cette fonction affiche les fichiers avec leurs permissions, propriétaires, tailles, dates de modification, etc.
- * Les options permettent d'inclure les fichiers cachés ou de parcourir récursivement les sous-répertoires.
- * 
- * @param dir_path Le chemin du répertoire à lister.
- * @param show_all Inclure ou non les fichiers cachés (ceux commençant par '.').
- * @param recursive Parcourir ou non les sous-répertoires récursivement.
- */
-void list_directory(const char *dir_path, bool show_all, bool recursive) {
-    DIR *dir = opendir(dir_path);
-    if (!dir) {
-        perror("opendir");
+ * @brief Ajoute une entrée au vecteur et l'examine avec fstatat.
+ *
+ * @return int 0 si réussi, -1 si la mémoire est épuisée.
+ */
+static int add_entry(LsVector *vector, int dir_fd, const char *name) {
+    size_t len = strlen(name);
+    if (vector->count == vector->cap) {
+        size_t cap = vector->cap ? vector->cap * 2 : 256;
+        LsEntry *entries = realloc(vector->entries, cap * sizeof(LsEntry));
+        if (!entries) {
+            return -1;
+        }
+        vector->entries = entries;
+        LsSortKey *keys = realloc(vector->keys, cap * sizeof(LsSortKey));
+        if (!keys) {
+            return -1;
+        }
+        vector->keys = keys;
+        LsSortKey *scratch = realloc(vector->scratch, cap * sizeof(LsSortKey));
+        if (!scratch) {
+            return -1;
+        }
+        vector->scratch = scratch;
+        vector->cap = cap;
+    }
+    if (vector->names_len + len + 1 > vector->names_cap) {
+        size_t cap = vector->names_cap ? vector->names_cap * 2 : 4096;
+        while (vector->names_len + len + 1 > cap) {
+            cap *= 2;
+        }
+        char *names = realloc(vector->names, cap);
+        if (!names) {
+            return -1;
+        }
+        vector->names = names;
+        vector->names_cap = cap;
+    }
+
+    LsEntry *entry = &vector->entries[vector->count++];
+    entry->name_offset = vector->names_len;
+    memcpy(vector->names + vector->names_len, name, len + 1);
+    vector->names_len += len + 1;
+    entry->valid = fstatat(dir_fd, name, &entry->st, AT_SYMLINK_NOFOLLOW) == 0;
+    return 0;
+}
+
+
+/**
+ * @brief Huit octets d'un nom à partir de `depth`, en big-endian et complétés par
+ * des zéros : comparer deux blocs revient à comparer ces octets des deux noms.
+ */
+static uint64_t name_chunk(const char *name, size_t depth) {
+    const unsigned char *bytes = (const unsigned char *)name + depth;
+    uint64_t chunk = 0;
+    int i = 0;
+    while (i < 8 && bytes[i]) {
+        chunk = chunk << 8 | bytes[i++];
+    }
+    return i == 0 ? 0 : chunk << (8 * (8 - i));
+}
+
+
+/**
+ * @brief Tri des noms par quicksort multiclé (Bentley-Sedgewick), huit octets à la fois.
+ *
+ * Tous les noms de `keys` ont les mêmes `depth` premiers octets. La partition
+ * compare les blocs rangés dans les clés, sans suivre les pointeurs de noms ;
+ * le groupe des blocs égaux à celui du pivot passe aux huit octets suivants,
+ * sauf si le nom se termine dans ce bloc (noms identiques).
+ *
+ * @param filled Les clés contiennent déjà les blocs de `depth`.
+ */
+static void sort_names(LsSortKey *keys, size_t n, size_t depth, bool filled) {
+    if (n <= MYLS_INSERTION_SORT) {
+        for (size_t i = 1; i < n; i++) {
+            LsSortKey key = keys[i];
+            size_t j = i;
+            while (j > 0 && strcmp(keys[j - 1].name + depth, key.name + depth) > 0) {
+                keys[j] = keys[j - 1];
+                j--;
+            }
+            keys[j] = key;
+        }
         return;
     }
+    if (!filled) {
+        for (size_t i = 0; i < n; i++) {
+            keys[i].key = name_chunk(keys[i].name, depth);
+        }
+    }
+
+    uint64_t a = keys[0].key, b = keys[n / 2].key, c = keys[n - 1].key;
+    uint64_t pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+
+    // Partition en trois : [0, lt) < pivot, [lt, gt) == pivot, [gt, n) > pivot
+    size_t lt = 0, i = 0, gt = n;
+    while (i < gt) {
+        LsSortKey key = keys[i];
+        if (key.key < pivot) {
+            keys[i++] = keys[lt];
+            keys[lt++] = key;
+        } else if (key.key > pivot) {
+            keys[i] = keys[--gt];
+            keys[gt] = key;
+        } else {
+            i++;
+        }
+    }
 
+    sort_names(keys, lt, depth, true);
+    if ((pivot & 0xFF) != 0) {
+        sort_names(keys + lt, gt - lt, depth + 8, false);
+    }
+    sort_names(keys + gt, n - gt, depth, true);
+}
+
+
+/**
+ * @brief Tri par base (LSD, octet par octet) des `bytes` octets de poids faible des clés.
+ *
+ * Le tri est stable : les clés égales gardent leur ordre. Les octets identiques
+ * pour toutes les clés ne coûtent qu'un comptage.
+ *
+ * @return LsSortKey* Celui des deux tableaux qui contient le résultat.
+ */
+static LsSortKey *radix_sort(LsSortKey *keys, LsSortKey *scratch, size_t n, int bytes) {
+    for (int shift = 0; shift < 8 * bytes; shift += 8) {
+        size_t counts[256] = { 0 };
+        for (size_t i = 0; i < n; i++) {
+            counts[(keys[i].key >> shift) & 0xFF]++;
+        }
+        if (counts[(keys[0].key >> shift) & 0xFF] == n) {
+            continue;
+        }
+        size_t position = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t count = counts[b];
+            counts[b] = position;
+            position += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            scratch[counts[(keys[i].key >> shift) & 0xFF]++] = keys[i];
+        }
+        LsSortKey *sorted = scratch;
+        scratch = keys;
+        keys = sorted;
+    }
+    return keys;
+}
+
+
+/**
+ * @brief Trie les entrées lues selon les options.
+ *
+ * Les entrées sont d'abord rangées par nom, puis, pour `-t` et `-S`, par un tri
+ * par base stable sur la date ou la taille prises dans le résultat de fstatat :
+ * les ex æquo restent dans l'ordre des noms. `-r` renverse l'ordre final. Les
+ * entrées sont enfin permutées en place en suivant les cycles de la permutation.
+ */
+static void sort_entries(LsVector *vector, const MylsOptions *options) {
+    size_t n = vector->count;
+    if (n < 2) {
+        return;
+    }
+    LsEntry *entries = vector->entries;
+    LsSortKey *keys = vector->keys;
+    LsSortKey *scratch = vector->scratch;
+
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = (LsSortKey){ 0, entries[i].name, (uint32_t)i };
+    }
+    sort_names(keys, n, 0, false);
+
+    // Clés complémentées : l'ordre croissant du tri par base donne le plus récent ou le plus gros d'abord
+    if (options->sort == MYLS_SORT_TIME) {
+        for (size_t i = 0; i < n; i++) {
+            const LsEntry *entry = &entries[keys[i].index];
+            keys[i].key = entry->valid ? UINT32_MAX - (uint32_t)entry->st.st_mtim.tv_nsec : 0;
+        }
+        keys = radix_sort(keys, scratch, n, 4);
+        scratch = keys == vector->keys ? vector->scratch : vector->keys;
+        for (size_t i = 0; i < n; i++) {
+            const LsEntry *entry = &entries[keys[i].index];
+            keys[i].key = entry->valid ? ~((uint64_t)entry->st.st_mtim.tv_sec ^ (UINT64_C(1) << 63)) : 0;
+        }
+        keys = radix_sort(keys, scratch, n, 8);
+    } else if (options->sort == MYLS_SORT_SIZE) {
+        for (size_t i = 0; i < n; i++) {
+            const LsEntry *entry = &entries[keys[i].index];
+            keys[i].key = entry->valid ? ~(uint64_t)entry->st.st_size : 0;
+        }
+        keys = radix_sort(keys, scratch, n, 8);
+    }
+
+    if (options->reverse) {
+        for (size_t i = 0, j = n - 1; i < j; i++, j--) {
+            LsSortKey key = keys[i];
+            keys[i] = keys[j];
+            keys[j] = key;
+        }
+    }
+
+    // keys[i].index est l'entrée à placer en i
+    for (size_t i = 0; i < n; i++) {
+        if (keys[i].index == i) {
+            continue;
+        }
+        LsEntry entry = entries[i];
+        size_t j = i;
+        while (keys[j].index != i) {
+            size_t k = keys[j].index;
+            entries[j] = entries[k];
+            keys[j].index = j;
+            j = k;
+        }
+        entries[j] = entry;
+        keys[j].index = j;
+    }
+}
+
+
+/**
+ * @brief Libère la mémoire d'un vecteur d'entrées.
+ */
+static void free_vector(LsVector *vector) {
+    free(vector->entries);
+    free(vector->keys);
+    free(vector->scratch);
+    free(vector->names);
+}
+
+
+/**
+ * @brief Lit et trie les entrées d'un répertoire ouvert ; le vecteur est vidé au préalable.
+ *
+ * @return int 0 si réussi, -1 si la mémoire a manqué (les entrées lues restent utilisables).
+ */
+static int read_entries(LsVector *vector, DIR *dir, const MylsOptions *options) {
+    int status = 0;
     struct dirent *entry;
-    struct stat stat_buf;
-    char *files[1024];
-    int file_count = 0;
 
-    
+    vector->count = 0;
+    vector->names_len = 0;
     while ((entry = readdir(dir)) != NULL) {
-        if (!show_all && entry->d_name[0] == '.') {
+        if (!options->show_all && entry->d_name[0] == '.') {
             continue;
         }
-        files[file_count] = strdup(entry->d_name);
-        file_count++;
+        if (add_entry(vector, dirfd(dir), entry->d_name) == -1) {
+            status = -1;
+            break;
+        }
     }
 
-    
-    qsort(files, file_count, sizeof(char *), (int (*)(const void *, const void *))strcmp);
+    for (size_t i = 0; i < vector->count; i++) {
+        vector->entries[i].name = vector->names + vector->entries[i].name_offset;
+    }
+    sort_entries(vector, options);
+    return status;
+}
 
-    
-    int total_blocks = 0;
-    for (int i = 0; i < file_count; i++) {
-        char full_path[1024];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, files[i]);
 
-        if (lstat(full_path, &stat_buf) == -1) {
-            continue;
+/**
+ * @brief Affiche l'en-tête, le total des blocs et une ligne par entrée d'un répertoire lu.
+ */
+static void format_listing(LsOutput *out, NameCache *names, int dir_fd, const char *dir_path,
+                           const LsVector *vector) {
+    long long total_blocks = 0;
+    for (size_t i = 0; i < vector->count; i++) {
+        if (vector->entries[i].valid) {
+            total_blocks += vector->entries[i].st.st_blocks;
+        }
+    }
+
+    output(out, "\n%s:\n", dir_path);
+    output(out, "total %lld\n", total_blocks / 2);
+
+    for (size_t i = 0; i < vector->count && !out->failed; i++) {
+        if (vector->entries[i].valid) {
+            print_entry(out, names, dir_fd, &vector->entries[i]);
         }
+    }
+}
+
+
+/**
+ * @brief Indique si une entrée lue est un sous-répertoire à parcourir avec `-R`.
+ *
+ * Les liens symboliques ne sont pas suivis ; "." et ".." sont ignorés.
+ */
+static bool is_subdirectory(const LsEntry *entry) {
+    return entry->valid && S_ISDIR(entry->st.st_mode) &&
+           strcmp(entry->name, ".") != 0 && strcmp(entry->name, "..") != 0;
+}
 
-        total_blocks += stat_buf.st_blocks;
+
+/**
+ * @brief Indique si un répertoire est l'un de ses propres ancêtres (boucle de montages liés).
+ */
+static bool is_loop(const DevIno *ancestors, int depth, const struct stat *st) {
+    for (int i = 0; i < depth; i++) {
+        if (ancestors[i].dev == st->st_dev && ancestors[i].ino == st->st_ino) {
+            return true;
+        }
     }
+    return false;
+}
+
 
-    printf("\n%s:\n", dir_path);
-    printf("total %d\n", total_blocks / 2);
+/**
+ * @brief Ouvre un répertoire relativement à son parent ; affiche l'erreur en cas d'échec.
+ */
+static int open_directory(Myls *ls, int parent_fd, const char *name) {
+    int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        flush_output(&ls->output);
+        perror("opendir");
+    }
+    return fd;
+}
 
-    
-    for (int i = 0; i < file_count; i++) {
-        char full_path[1024];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, files[i]);
 
-        if (lstat(full_path, &stat_buf) == -1) {
-            continue;
+/**
+ * @brief Vecteur de la profondeur `depth` (sa mémoire est conservée d'un répertoire à l'autre).
+ */
+static LsVector *level_vector(Myls *ls, int depth) {
+    if (depth >= ls->num_levels) {
+        LsVector *levels = realloc(ls->levels, (depth + 1) * sizeof(LsVector));
+        if (!levels) {
+            return NULL;
+        }
+        ls->levels = levels;
+        DevIno *ancestors = realloc(ls->ancestors, (depth + 1) * sizeof(DevIno));
+        if (!ancestors) {
+            return NULL;
         }
+        ls->ancestors = ancestors;
+        memset(levels + ls->num_levels, 0, (depth + 1 - ls->num_levels) * sizeof(LsVector));
+        ls->num_levels = depth + 1;
+    }
+    return &ls->levels[depth];
+}
+
+
+/**
+ * @brief Liste les fichiers d'un répertoire avec leurs détails, optionnellement de manière récursive.
+ *
+ * Cette fonction affiche les fichiers avec leurs permissions, propriétaires, tailles, dates de modification, etc.
+ * Chaque entrée n'est examinée qu'une fois (fstatat relatif au répertoire ouvert) ;
+ * le total, les lignes et la récursion réutilisent ce résultat. Les entrées sont
+ * rangées dans le vecteur de leur profondeur, qui grandit au besoin.
+ *
+ * @param ls État de `myls` (options, caches, sortie).
+ * @param parent_fd Répertoire d'où ouvrir `name` (AT_FDCWD pour un chemin).
+ * @param name Nom du répertoire relativement à `parent_fd`.
+ * @param dir_path Le chemin du répertoire, tel qu'affiché.
+ * @param depth Profondeur de la récursion.
+ */
+static void list_directory(Myls *ls, int parent_fd, const char *name, const char *dir_path, int depth) {
+    int fd = open_directory(ls, parent_fd, name);
+    if (fd == -1) {
+        return;
+    }
+    DIR *dir = fdopendir(fd);
+    LsVector *vector = dir ? level_vector(ls, depth) : NULL;
+    if (!vector) {
+        perror(dir ? "realloc failed" : "fdopendir failed");
+        if (dir) {
+            closedir(dir);
+        } else {
+            close(fd);
+        }
+        return;
+    }
+
+    struct stat st = { 0 };
+    if (fstat(fd, &st) == 0 && is_loop(ls->ancestors, depth, &st)) {
+        flush_output(&ls->output);
+        fprintf(stderr, "myls: %s: not listing already-listed directory\n", dir_path);
+        closedir(dir);
+        return;
+    }
+    ls->ancestors[depth] = (DevIno){ st.st_dev, st.st_ino };
+
+    if (read_entries(vector, dir, &ls->options) == -1) {
+        flush_output(&ls->output);
+        fprintf(stderr, "myls: %s: out of memory, listing truncated\n", dir_path);
+    }
+    format_listing(&ls->output, &ls->names, fd, dir_path, vector);
 
-        char date[20];
-        struct tm *timeinfo = localtime(&stat_buf.st_mtime);
-        strftime(date, sizeof(date), "%b %d %H:%M", timeinfo);
-
-        char ext_attr = get_extended_attributes(full_path);
-        printf("%c%c%c%c%c%c%c%c%c%c%c %3lu %-8s %-8s %8lld %s ",
-               S_ISDIR(stat_buf.st_mode) ? 'd' : (S_ISLNK(stat_buf.st_mode) ? 'l' : '-'),
-               stat_buf.st_mode & S_IRUSR ? 'r' : '-',
-               stat_buf.st_mode & S_IWUSR ? 'w' : '-',
-               stat_buf.st_mode & S_IXUSR ? 'x' : '-',
-               stat_buf.st_mode & S_IRGRP ? 'r' : '-',
-               stat_buf.st_mode & S_IWGRP ? 'w' : '-',
-               stat_buf.st_mode & S_IXGRP ? 'x' : '-',
-               stat_buf.st_mode & S_IROTH ? 'r' : '-',
-               stat_buf.st_mode & S_IWOTH ? 'w' : '-',
-               stat_buf.st_mode & S_IXOTH ? 'x' : '-',
-               ext_attr,
-               stat_buf.st_nlink,
-               getpwuid(stat_buf.st_uid)->pw_name,
-               getgrgid(stat_buf.st_gid)->gr_name,
-               (long long)stat_buf.st_size,
-               date);
-
-        print_colored(files[i], stat_buf.st_mode);
-
-        if (S_ISLNK(stat_buf.st_mode)) {
-            char link_target[1024];
-            ssize_t len = readlink(full_path, link_target, sizeof(link_target) - 1);
-            if (len != -1) {
-                link_target[len] = '\0';
-                printf(" -> %s", link_target);
+    if (ls->options.recursive) {
+        size_t count = vector->count;
+        for (size_t i = 0; i < count && !ls->output.failed; i++) {
+            // Les vecteurs peuvent avoir été déplacés par la récursion
+            const LsEntry *child = &ls->levels[depth].entries[i];
+            if (!is_subdirectory(child)) {
+                continue;
             }
+            char full_path[PATH_MAX];
+            snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, child->name);
+            list_directory(ls, fd, child->name, full_path, depth + 1);
         }
+    }
+
+    closedir(dir);
+}
+
 
-        printf("\n");
+/**
+ * @brief Répertoire à lister par le parcours parallèle.
+ *
+ * Les nœuds forment l'arbre des répertoires : le texte d'un nœud est affiché
+ * après celui de son parent et des sous-arbres de ses frères précédents.
+ */
+typedef struct LsNode {
+    char *path;
+    int depth;
+    DevIno *ancestors;          ///< Répertoires au-dessus de celui-ci (`depth` éléments).
+    LsOutput output;            ///< Listing, gardé en mémoire jusqu'à son affichage.
+    char *error;                ///< Message pour stderr, affiché avant le listing.
+    struct LsNode **children;   ///< Sous-répertoires, dans l'ordre du tri.
+    size_t num_children;
+    bool claimed;               ///< Pris par un thread pour être lu (protégé par le verrou du parcours).
+    bool queued;                ///< Encore dans la file d'un thread (protégé par le verrou du parcours).
+    bool released;              ///< Affiché pendant qu'il était en file : le thread qui le sort le libère.
+    bool done;                  ///< Lu (protégé par le verrou du parcours).
+} LsNode;
+
+/**
+ * @brief État propre à un thread du parcours : ses caches et son vecteur d'entrées.
+ */
+typedef struct {
+    NameCache names;
+    LsVector vector;
+} LsWorker;
+
+/**
+ * @brief Parcours parallèle d'une arborescence.
+ */
+typedef struct {
+    const MylsOptions *options;
+    WorkPool *pool;
+    LsWorker *workers;          ///< Un par thread, plus celui du thread qui affiche.
+    pthread_mutex_t lock;
+    pthread_cond_t done_cond;   ///< Signalé quand un nœud est lu.
+    pthread_cond_t space_cond;  ///< Signalé quand un listing est affiché ou que le nœud attendu change.
+    size_t ready;               ///< Nœuds lus mais pas encore affichés (protégé par `lock`).
+    LsNode *waiting;            ///< Nœud que le thread qui affiche attend (protégé par `lock`).
+    atomic_bool cancelled;      ///< La sortie a échoué : plus rien n'est lu.
+} LsTree;
+
+
+static LsNode *create_node(const char *parent_path, const char *name, int depth,
+                           const DevIno *ancestors) {
+    size_t path_len = parent_path ? strlen(parent_path) + 1 + strlen(name) : strlen(name);
+    LsNode *node = calloc(1, sizeof(LsNode) + depth * sizeof(DevIno) + path_len + 1);
+    if (!node) {
+        return NULL;
+    }
+    node->depth = depth;
+    node->ancestors = (DevIno *)(node + 1);
+    node->path = (char *)(node->ancestors + depth);
+    if (depth > 0) {
+        memcpy(node->ancestors, ancestors, depth * sizeof(DevIno));
+    }
+    if (parent_path) {
+        sprintf(node->path, "%s/%s", parent_path, name);
+    } else {
+        strcpy(node->path, name);
+    }
+    return node;
+}
+
+
+static void free_node(LsNode *node) {
+    free(node->output.data);
+    free(node->error);
+    free(node->children);
+    free(node);
+}
+
+
+/**
+ * @brief Mémorise le message d'erreur d'un nœud, affiché avec son listing.
+ */
+__attribute__((format(printf, 2, 3)))
+static void node_error(LsNode *node, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (vasprintf(&node->error, format, args) == -1) {
+        node->error = NULL;
+    }
+    va_end(args);
+}
+
+
+/**
+ * @brief Marque un nœud comme lu et prévient le thread qui affiche.
+ */
+static void finish_node(LsTree *tree, LsNode *node) {
+    pthread_mutex_lock(&tree->lock);
+    node->done = true;
+    tree->ready++;
+    pthread_cond_broadcast(&tree->done_cond);
+    pthread_mutex_unlock(&tree->lock);
+}
+
+
+/**
+ * @brief Libère un nœud affiché ; s'il est encore en file, le thread qui l'en sortira s'en charge.
+ */
+static void release_node(LsTree *tree, LsNode *node) {
+    pthread_mutex_lock(&tree->lock);
+    bool queued = node->queued;
+    node->released = queued;
+    pthread_mutex_unlock(&tree->lock);
+    if (!queued) {
+        free_node(node);
     }
+}
+
+
+/**
+ * @brief Arrête le parcours et réveille les threads qui attendent de la place.
+ */
+static void cancel_tree(LsTree *tree) {
+    pthread_mutex_lock(&tree->lock);
+    atomic_store(&tree->cancelled, true);
+    pthread_cond_broadcast(&tree->space_cond);
+    pthread_mutex_unlock(&tree->lock);
+}
 
-    
-    if (recursive) {
-        for (int i = 0; i < file_count; i++) {
-            char full_path[1024];
-            snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, files[i]);
 
-            if (lstat(full_path, &stat_buf) == -1) {
+/**
+ * @brief Lit un répertoire, prépare son listing et met ses sous-répertoires en file.
+ */
+static void read_node(LsTree *tree, int index, LsNode *node) {
+    LsWorker *worker = &tree->workers[index];
+    if (atomic_load(&tree->cancelled)) {
+        return;
+    }
+
+    int fd = openat(AT_FDCWD, node->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = fd != -1 ? fdopendir(fd) : NULL;
+    if (!dir) {
+        node_error(node, "opendir: %s\n", strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    struct stat st = { 0 };
+    if (fstat(fd, &st) == 0 && is_loop(node->ancestors, node->depth, &st)) {
+        node_error(node, "myls: %s: not listing already-listed directory\n", node->path);
+        closedir(dir);
+        return;
+    }
+
+    LsVector *vector = &worker->vector;
+    if (read_entries(vector, dir, tree->options) == -1) {
+        node_error(node, "myls: %s: out of memory, listing truncated\n", node->path);
+    }
+    format_listing(&node->output, &worker->names, fd, node->path, vector);
+
+    size_t num_children = 0;
+    for (size_t i = 0; i < vector->count; i++) {
+        num_children += is_subdirectory(&vector->entries[i]);
+    }
+    node->children = num_children ? malloc(num_children * sizeof(LsNode *)) : NULL;
+    DevIno *ancestors = num_children ? malloc((node->depth + 1) * sizeof(DevIno)) : NULL;
+    if (node->children && ancestors) {
+        memcpy(ancestors, node->ancestors, node->depth * sizeof(DevIno));
+        ancestors[node->depth] = (DevIno){ st.st_dev, st.st_ino };
+        for (size_t i = 0; i < vector->count; i++) {
+            if (!is_subdirectory(&vector->entries[i])) {
                 continue;
             }
+            LsNode *child = create_node(node->path, vector->entries[i].name, node->depth + 1, ancestors);
+            if (!child) {
+                break;
+            }
+            child->queued = true;
+            node->children[node->num_children++] = child;
+        }
+    }
+    free(ancestors);
+    closedir(dir);
 
-            if (S_ISDIR(stat_buf.st_mode)) {
-                // Ignorer "." et ".." dans la récursion
-                if (strcmp(files[i], ".") == 0 || strcmp(files[i], "..") == 0) {
-                    continue;
-                }
+    // Le premier sous-répertoire, affiché en premier, est aussi lu en premier ; ceux
+    // du thread qui affiche vont dans la file du premier thread
+    int queue = index < tree->options->jobs ? index : 0;
+    for (size_t i = node->num_children; i-- > 0; ) {
+        if (!work_pool_push(tree->pool, queue, node->children[i])) {
+            pthread_mutex_lock(&tree->lock);
+            node->children[i]->queued = false;
+            pthread_mutex_unlock(&tree->lock);
+            finish_node(tree, node->children[i]);
+        }
+    }
+}
+
+
+/**
+ * @brief Tâche du groupe de threads : lit un nœud.
+ *
+ * Tant que MYLS_MAX_READY listings attendent d'être affichés, le thread attend,
+ * sauf pour le nœud que le thread qui affiche attend lui-même : la mémoire reste
+ * bornée même si un sous-arbre du début est lent à lire.
+ */
+static void ls_process(WorkPool *pool, int worker, void *item, void *context) {
+    LsTree *tree = context;
+    LsNode *node = item;
+
+    pthread_mutex_lock(&tree->lock);
+    node->queued = false;
+    if (node->released) {
+        pthread_mutex_unlock(&tree->lock);
+        free_node(node);
+        return;
+    }
+    // Déjà pris par le thread qui affiche
+    bool claimed = node->claimed;
+    node->claimed = true;
+    while (!claimed && tree->ready >= MYLS_MAX_READY && tree->waiting != node &&
+           !atomic_load(&tree->cancelled)) {
+        pthread_cond_wait(&tree->space_cond, &tree->lock);
+    }
+    pthread_mutex_unlock(&tree->lock);
+
+    if (!claimed) {
+        read_node(tree, worker, node);
+        finish_node(tree, node);
+    }
+}
+
+
+/**
+ * @brief Affiche les nœuds dans l'ordre du parcours séquentiel, au fur et à mesure qu'ils sont lus.
+ */
+static void emit_tree(Myls *ls, LsTree *tree, LsNode *root) {
+    size_t count = 0, cap = 64;
+    LsNode **stack = malloc(cap * sizeof(LsNode *));
+    if (!stack) {
+        perror("malloc failed");
+        cancel_tree(tree);
+        return;
+    }
+    stack[count++] = root;
+
+    while (count > 0) {
+        LsNode *node = stack[--count];
+        pthread_mutex_lock(&tree->lock);
+        tree->waiting = node;
+        pthread_cond_broadcast(&tree->space_cond);
+        while (!node->done) {
+            if (!node->claimed) {
+                // Encore en file : le lire ici plutôt que d'attendre qu'un thread le prenne
+                node->claimed = true;
+                pthread_mutex_unlock(&tree->lock);
+                read_node(tree, ls->options.jobs, node);
+                finish_node(tree, node);
+                pthread_mutex_lock(&tree->lock);
+                continue;
+            }
+            pthread_cond_wait(&tree->done_cond, &tree->lock);
+        }
+        tree->ready--;
+        pthread_cond_signal(&tree->space_cond);
+        pthread_mutex_unlock(&tree->lock);
 
-                list_directory(full_path, show_all, recursive);
+        if (node->error || (node->output.failed && !ls->output.failed)) {
+            flush_output(&ls->output);
+            fputs(node->error ? node->error : "myls: out of memory\n", stderr);
+        }
+        output_bytes(&ls->output, node->output.data, node->output.len);
+        if (ls->output.failed && !atomic_load(&tree->cancelled)) {
+            cancel_tree(tree);
+        }
+
+        if (count + node->num_children > cap) {
+            size_t grown_cap = cap;
+            while (count + node->num_children > grown_cap) {
+                grown_cap *= 2;
             }
+            LsNode **grown = realloc(stack, grown_cap * sizeof(LsNode *));
+            if (!grown) {
+                perror("realloc failed");
+                cancel_tree(tree);
+                release_node(tree, node);
+                continue;
+            }
+            stack = grown;
+            cap = grown_cap;
+        }
+        for (size_t i = node->num_children; i-- > 0; ) {
+            stack[count++] = node->children[i];
         }
+        release_node(tree, node);
     }
+    free(stack);
+}
+
+
+/**
+ * @brief Liste une arborescence (`-R`) avec plusieurs threads.
+ *
+ * Chaque thread lit des répertoires (readdir, fstatat, tri et mise en forme) et
+ * met leurs sous-répertoires dans sa propre file ; un thread sans travail en
+ * vole dans la file d'un autre. Les listings sont gardés en mémoire et affichés
+ * par le thread appelant dans l'ordre du parcours séquentiel, donc identiques
+ * quel que soit le nombre de threads ; au-delà de MYLS_MAX_READY listings en
+ * attente, les threads s'arrêtent et le thread appelant lit lui-même le
+ * répertoire qu'il attend. Un répertoire qui est aussi l'un de ses
+ * ancêtres (même périphérique et inode) n'est pas relu.
+ *
+ * @param ls État de `myls`.
+ * @param path Racine du parcours.
+ * @return int 0 si le parcours a eu lieu, -1 s'il faut le faire sans threads.
+ */
+static int list_tree_parallel(Myls *ls, const char *path) {
+    LsTree tree = { .options = &ls->options };
+    atomic_init(&tree.cancelled, false);
 
-    
-    for (int i = 0; i < file_count; i++) {
-        free(files[i]);
+    LsNode *root = create_node(NULL, path, 0, NULL);
+    tree.workers = calloc(ls->options.jobs + 1, sizeof(LsWorker));
+    tree.pool = work_pool_create(ls->options.jobs, ls_process, &tree);
+    if (!root || !tree.workers || !tree.pool) {
+        free(root);
+        free(tree.workers);
+        if (tree.pool) {
+            work_pool_destroy(tree.pool);
+        }
+        return -1;
     }
+    pthread_mutex_init(&tree.lock, NULL);
+    pthread_cond_init(&tree.done_cond, NULL);
+    pthread_cond_init(&tree.space_cond, NULL);
 
-    closedir(dir); 
+    int started = 0;
+    root->queued = true;
+    if (work_pool_push(tree.pool, 0, root)) {
+        started = work_pool_start(tree.pool);
+    }
+    if (started > 0) {
+        emit_tree(ls, &tree, root);
+        work_pool_wait(tree.pool);
+    } else {
+        free(root);
+    }
+
+    for (int i = 0; i <= ls->options.jobs; i++) {
+        free_vector(&tree.workers[i].vector);
+    }
+    free(tree.workers);
+    work_pool_destroy(tree.pool);
+    pthread_cond_destroy(&tree.space_cond);
+    pthread_cond_destroy(&tree.done_cond);
+    pthread_mutex_destroy(&tree.lock);
+    return started > 0 ? 0 : -1;
+}
+
+
+/**
+ * @brief Liste un répertoire sans trier ses entrées (`-f`), en mémoire bornée.
+ *
+ * Les entrées sont lues par lots avec getdents64 et affichées aussitôt, quel que
+ * soit leur nombre ; le total des blocs n'est donc pas affiché. Avec `-R`, le
+ * répertoire est relu une seconde fois pour descendre dans ses sous-répertoires,
+ * plutôt que de mémoriser leurs noms.
+ *
+ * @param ls État de `myls` (options, caches, sortie).
+ * @param parent_fd Répertoire d'où ouvrir `name` (AT_FDCWD pour un chemin).
+ * @param name Nom du répertoire relativement à `parent_fd`.
+ * @param dir_path Le chemin du répertoire, tel qu'affiché.
+ */
+static void stream_directory(Myls *ls, int parent_fd, const char *name, const char *dir_path) {
+    int fd = open_directory(ls, parent_fd, name);
+    if (fd == -1) {
+        return;
+    }
+    char *buffer = malloc(MYLS_DIRENT_BUFFER);
+    if (!buffer) {
+        perror("malloc failed");
+        close(fd);
+        return;
+    }
+
+    output(&ls->output, "\n%s:\n", dir_path);
+    long n;
+    while (!ls->output.failed && (n = syscall(SYS_getdents64, fd, buffer, MYLS_DIRENT_BUFFER)) > 0) {
+        for (long offset = 0; offset < n && !ls->output.failed; ) {
+            const struct linux_dirent64 *dirent = (const struct linux_dirent64 *)(buffer + offset);
+            offset += dirent->d_reclen;
+
+            LsEntry entry = { .name = dirent->d_name };
+            entry.valid = fstatat(fd, entry.name, &entry.st, AT_SYMLINK_NOFOLLOW) == 0;
+            if (entry.valid) {
+                print_entry(&ls->output, &ls->names, fd, &entry);
+            }
+        }
+    }
+
+    if (ls->options.recursive && !ls->output.failed && lseek(fd, 0, SEEK_SET) == 0) {
+        while (!ls->output.failed && (n = syscall(SYS_getdents64, fd, buffer, MYLS_DIRENT_BUFFER)) > 0) {
+            for (long offset = 0; offset < n && !ls->output.failed; ) {
+                const struct linux_dirent64 *dirent = (const struct linux_dirent64 *)(buffer + offset);
+                offset += dirent->d_reclen;
+
+                const char *child = dirent->d_name;
+                if (strcmp(child, ".") == 0 || strcmp(child, "..") == 0) {
+                    continue;
+                }
+                struct stat st;
+                if (dirent->d_type != DT_DIR &&
+                    (dirent->d_type != DT_UNKNOWN || fstatat(fd, child, &st, AT_SYMLINK_NOFOLLOW) == -1 ||
+                     !S_ISDIR(st.st_mode))) {
+                    continue;
+                }
+                char full_path[PATH_MAX];
+                snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, child);
+                stream_directory(ls, fd, child, full_path);
+            }
+        }
+    }
+
+    free(buffer);
+    close(fd);
+}
+
+
+/**
+ * @brief Liste un répertoire selon les options.
+ */
+static void list_path(Myls *ls, const char *path) {
+    if (ls->options.stream) {
+        stream_directory(ls, AT_FDCWD, path, path);
+    } else if (!ls->options.recursive || ls->options.jobs < 2 || list_tree_parallel(ls, path) == -1) {
+        list_directory(ls, AT_FDCWD, path, path, 0);
+    }
 }
 
 
 /**
  * @brief Analyse les options de ligne de commande pour déterminer les paramètres d'exécution.
- * 
+ *
  * Les options reconnues incluent :
  * - `-a` : Afficher les fichiers cachés.
  * - `-R` : Parcourir les répertoires récursivement.
- * 
+ * - `-f` : Afficher les entrées pendant la lecture, sans les trier (implique `-a`).
+ * - `-t` : Trier par date de modification, la plus récente d'abord.
+ * - `-S` : Trier par taille, la plus grande d'abord.
+ * - `-r` : Inverser l'ordre du tri.
+ * - `-j N` : Nombre de threads du parcours récursif (1 : séquentiel ; par défaut un
+ *   par processeur, au plus MYLS_DEFAULT_THREADS).
+ *
  * @param argc Le nombre d'arguments de la ligne de commande.
  * @param argv Le tableau des arguments de la ligne de commande.
- * @param show_all Indicateur pour afficher ou non les fichiers cachés.
- * @param recursive Indicateur pour activer ou non la récursion.
+ * @param options Reçoit les options.
  * @param dir_index Index du premier argument correspondant à un chemin de répertoire.
+ * @return int 0 si les options sont valides, -1 sinon.
  */
-void parse_options(int argc, char *argv[], bool *show_all, bool *recursive, int *dir_index) {
-    *show_all = false;
-    *recursive = false;
-    *dir_index = argc; 
+static int parse_options(int argc, char *argv[], MylsOptions *options, int *dir_index) {
+    memset(options, 0, sizeof(MylsOptions));
+    *dir_index = argc;
 
     for (int i = 1; i < argc; i++) {
         if (argv[i][0] == '-') {
             for (int j = 1; argv[i][j] != '\0'; j++) {
                 switch (argv[i][j]) {
                     case 'a':
-                        *show_all = true;
+                        options->show_all = true;
                         break;
                     case 'R':
-                        *recursive = true;
+                        options->recursive = true;
+                        break;
+                    case 'f':
+                        options->stream = true;
+                        options->show_all = true;
                         break;
+                    case 't':
+                        options->sort = MYLS_SORT_TIME;
+                        break;
+                    case 'S':
+                        options->sort = MYLS_SORT_SIZE;
+                        break;
+                    case 'r':
+                        options->reverse = true;
+                        break;
+                    case 'j': {
+                        // `-j4` ou `-j 4`
+                        char *value = argv[i][j + 1] ? &argv[i][j + 1] : (i + 1 < argc ? argv[++i] : "");
+                        char *end;
+                        long jobs = strtol(value, &end, 10);
+                        if (end == value || *end != '\0' || jobs < 1 || jobs > MYLS_MAX_THREADS) {
+                            fprintf(stderr, "Invalid thread count for -j: '%s'\n", value);
+                            return -1;
+                        }
+                        options->jobs = jobs;
+                        j = end - argv[i] - 1;
+                        break;
+                    }
                     default:
                         fprintf(stderr, "Unknown option: -%c\n", argv[i][j]);
-                        exit(EXIT_FAILURE);
+                        return -1;
                 }
             }
         } else {
@@ -213,41 +1284,71 @@ void parse_options(int argc, char *argv[], bool *show_all, bool *recursive, int
             break;
         }
     }
+
+    if (options->jobs == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        options->jobs = cpus > MYLS_DEFAULT_THREADS ? MYLS_DEFAULT_THREADS : (cpus > 0 ? cpus : 1);
+    }
+    return 0;
 }
 
 /**
  * @brief Point d'entrée principal pour l'exécution de la commande `myls`.
- * 
- * Cette fonction gère les arguments de la commande `myls`, analyse les options, 
+ *
+ * Cette fonction gère les arguments de la commande `myls`, analyse les options,
  * et liste les répertoires spécifiés ou le répertoire courant par défaut.
- * 
+ * Elle s'exécute dans le processus du shell (ou dans un thread lorsqu'elle fait
+ * partie d'un pipeline) et n'écrit que dans le flux fourni.
+ *
  * @param argc Le nombre d'arguments passés à `myls`.
  * @param argv Le tableau des arguments passés à `myls`.
+ * @param out Flux de sortie.
  * @return int Code de retour : 0 si l'exécution s'est déroulée correctement.
  */
-int myls_run(int argc, char *argv[]) {
-    bool show_all, recursive;
+int myls_run(int argc, char *argv[], FILE *out) {
+    MylsOptions options;
     int dir_index;
-    parse_options(argc, argv, &show_all, &recursive, &dir_index);
+    if (parse_options(argc, argv, &options, &dir_index) == -1) {
+        return 2;
+    }
+
+    Myls *ls = calloc(1, sizeof(Myls));
+    char *buffer = malloc(MYLS_OUTPUT_BUFFER);
+    if (!ls || !buffer) {
+        perror("malloc failed");
+        free(ls);
+        free(buffer);
+        return 1;
+    }
+    ls->output = (LsOutput){ .out = out, .data = buffer, .cap = MYLS_OUTPUT_BUFFER };
+    ls->options = options;
 
     if (dir_index == argc) {
-        list_directory(".", show_all, recursive); 
+        list_path(ls, ".");
     } else {
         for (int i = dir_index; i < argc; i++) {
             char *dir = argv[i];
+            char full_path[PATH_MAX];
 
             if (dir[0] == '~') {
                 char *home = getenv("HOME");
                 if (home) {
-                    char full_path[1024];
                     snprintf(full_path, sizeof(full_path), "%s%s", home, dir + 1);
                     dir = full_path;
                 }
             }
 
-            printf("\nListing directory: %s\n", dir);
-            list_directory(dir, show_all, recursive);
+            output(&ls->output, "\nListing directory: %s\n", dir);
+            list_path(ls, dir);
         }
     }
+    flush_output(&ls->output);
+    for (int i = 0; i < ls->num_levels; i++) {
+        free_vector(&ls->levels[i]);
+    }
+    free(ls->levels);
+    free(ls->ancestors);
+    free(ls->output.data);
+    free(ls);
     return 0;
 }
@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 #include <ctype.h>
 #include <time.h>
+#include "../include/myps.h"
 
 #define MAX_PATH 512
 #define MAX_CMD 256
@@ -55,11 +56,13 @@ float calculate_mem(unsigned long rss, unsigned long totalram) {
  * @brief Récupère le terminal (TTY) associé à un processus.
  * 
  * @param proc_path Chemin du répertoire du processus dans `/proc`.
+ * @param tty Buffer recevant le nom du terminal.
+ * @param tty_size Taille du buffer.
  * @return const char* Le nom du terminal associé ou "?" si aucun.
  */
-const char *get_tty(const char *proc_path) {
-    static char tty[16] = "?";
+const char *get_tty(const char *proc_path, char *tty, size_t tty_size) {
     char fd_path[MAX_PATH];
+    snprintf(tty, tty_size, "?");
     snprintf(fd_path, sizeof(fd_path), "%s/fd/0", proc_path);
 
     char link_path[MAX_PATH];
@@ -67,9 +70,9 @@ const char *get_tty(const char *proc_path) {
     if (len > 0) {
         link_path[len] = '\0';
         if (strstr(link_path, "/dev/pts")) {
-            snprintf(tty, sizeof(tty), "%s", strrchr(link_path, '/') + 1);
+            snprintf(tty, tty_size, "%s", strrchr(link_path, '/') + 1);
         } else if (strstr(link_path, "/dev/tty")) {
-            snprintf(tty, sizeof(tty), "%s", strrchr(link_path, '/') + 1);
+            snprintf(tty, tty_size, "%s", strrchr(link_path, '/') + 1);
         }
     }
     return tty;
@@ -86,9 +89,9 @@ const char *get_tty(const char *proc_path) {
  */
 void get_start_time(unsigned long start_time, long clk_tck, time_t boot_time, char *start_buffer, size_t buffer_size) {
     time_t process_start_time = boot_time + (start_time / clk_tck);
-    struct tm *local_time = localtime(&process_start_time);
-    if (local_time) {
-        strftime(start_buffer, buffer_size, "%H:%M", local_time);
+    struct tm local_time;
+    if (localtime_r(&process_start_time, &local_time)) {
+        strftime(start_buffer, buffer_size, "%H:%M", &local_time);
     } else {
         strncpy(start_buffer, "unknown", buffer_size);
     }
@@ -120,8 +123,9 @@ void get_cpu_time(unsigned long utime, unsigned long stime, long clk_tck, char *
  * @param pid L'identifiant (PID) du processus.
  * @param proc_path Chemin du répertoire du processus dans `/proc`.
  * @param sys_info Informations système (structure `sysinfo`).
+ * @param out Flux de sortie.
  */
-void get_process_info(const char *pid, const char *proc_path, struct sysinfo *sys_info) {
+void get_process_info(const char *pid, const char *proc_path, struct sysinfo *sys_info, FILE *out) {
     char stat_path[MAX_PATH], status_path[MAX_PATH], cmdline_path[MAX_PATH], comm_path[MAX_PATH];
     snprintf(stat_path, MAX_PATH, "%s/stat", proc_path);
     snprintf(status_path, MAX_PATH, "%s/status", proc_path);
@@ -175,12 +179,13 @@ void get_process_info(const char *pid, const char *proc_path, struct sysinfo *sy
     get_start_time(start_time, sysconf(_SC_CLK_TCK), boot_time, start_buffer, sizeof(start_buffer));
     get_cpu_time(utime, stime, sysconf(_SC_CLK_TCK), time_buffer, sizeof(time_buffer));
 
-    printf("%-10s %5s %5.1f %5.1f %8lu %7lu %-6s %c %-5s %-5s %s\n",
+    char tty[16];
+    fprintf(out, "%-10s %5s %5.1f %5.1f %8lu %7lu %-6s %c %-5s %-5s %s\n",
            get_username(uid), pid,
            calculate_cpu(utime, stime, start_time, sys_info->uptime, sysconf(_SC_CLK_TCK)),
            calculate_mem(rss * sysconf(_SC_PAGESIZE), sys_info->totalram),
            vsize / 1024, rss * sysconf(_SC_PAGESIZE) / 1024,
-           get_tty(proc_path), state, start_buffer, time_buffer, cmdline);
+           get_tty(proc_path, tty, sizeof(tty)), state, start_buffer, time_buffer, cmdline);
 }
 
 
@@ -190,8 +195,10 @@ void get_process_info(const char *pid, const char *proc_path, struct sysinfo *sy
  * Parcourt le répertoire `/proc`, récupère les informations de chaque processus et
  * les affiche sous forme tabulaire avec des détails tels que l'utilisateur, le PID,
  * l'utilisation CPU, l'utilisation mémoire, et la commande associée.
+ * 
+ * @param out Flux de sortie.
  */
-void myps() {
+void myps(FILE *out) {
     DIR *proc_dir = opendir("/proc");
     if (!proc_dir) {
         perror("opendir");
@@ -202,9 +209,9 @@ void myps() {
     struct sysinfo sys_info;
     sysinfo(&sys_info);
 
-    printf("USER       PID  %%CPU %%MEM      VSZ    RSS   TTY   STAT START TIME  COMMAND\n");
+    fprintf(out, "USER       PID  %%CPU %%MEM      VSZ    RSS   TTY   STAT START TIME  COMMAND\n");
 
-    while ((entry = readdir(proc_dir)) != NULL) {
+    while ((entry = readdir(proc_dir)) != NULL && !ferror(out)) {
         if (!isdigit(entry->d_name[0])) {
             continue;
         }
@@ -216,7 +223,7 @@ void myps() {
             continue;
         }
 
-        get_process_info(entry->d_name, proc_path, &sys_info);
+        get_process_info(entry->d_name, proc_path, &sys_info, out);
     }
 
     closedir(proc_dir);
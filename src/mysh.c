@@ -9,94 +9,27 @@
 #include "../include/variable.h"
 #include "../include/myps.h"
 #include "../include/process_manager.h"
+#include "../include/redirection.h"
+#include "../include/reader.h"
+#include "../include/event_loop.h"
+#include "../include/trace.h"
+#include "../include/arena.h"
+#include "../include/mysh.h"
+#include <fcntl.h>
 
 
 #define ROUGE(x) "\033[31m" x "\033[0m"
 #define VERT(x) "\033[32m" x "\033[0m"
 
-#define MAX_COMMAND_LENGTH 100
 #define MAX_PATH_LENGTH 1024
 
 volatile sig_atomic_t foreground_running = 0;
 char last_command_name[MAX_COMMAND_LENGTH] = "";
 int last_status = -1;
-pid_t last_pid = -1;
+pid_t shell_pid = 0;
 char current_directory[MAX_PATH_LENGTH];  
-char global_command_line[MAX_COMMAND_LENGTH];
-
-/**
- * @brief Gère le signal SIGCHLD et affiche les informations des processus terminés.
- */
-void handle_sigchld(int sig) {
-    int status;
-    pid_t pid;
-
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        for (int i = 0; i < job_count; i++) {
-            if (jobs[i].pid == pid) {
-                printf("[%d] %d terminé avec status=%d\n",
-                       jobs[i].job_id,
-                       pid,
-                       WIFEXITED(status) ? WEXITSTATUS(status) : -1);
-                remove_job(pid);
-                break;
-            }
-        }
-    }
-}
-
-/**
- * @brief Gère le signal SIGTSTP pour arrêter un processus en avant-plan.
- * 
- * Si un processus en avant-plan est en cours, il est stoppé et ajouté à la liste des jobs.
- * 
- * @param sig Signal reçu (toujours SIGTSTP).
- * 
- */
-void handle_sigtstp(int sig) {
-    if (foreground_running) {
-        printf("\nCommande stoppée: %s\n", last_command_name);
-        add_job(last_pid, last_command_name);
-        jobs[job_count - 1].running = 0;
-        kill(last_pid, SIGTSTP);
-        foreground_running = 0;
-    }
-}
-
-
-/**
- * @brief Gère le signal SIGINT (Ctrl+C) et propose de quitter le shell.
- * 
- * Si un processus en avant-plan est en cours, le signal est ignoré.
- * Sinon, l'utilisateur est invité à confirmer la sortie du shell.
- * 
- * @param sig Signal reçu (toujours SIGINT).
- */
-void handle_sigint(int sig){
-    if (foreground_running){
-        return;
-    }
-    printf("\nDo you want to quit mysh? (y/n): ");
-    fflush(stdout);
-
-    int response = getchar();
-    while (getchar() != '\n');
-
-    if (response == 'y' || response == 'Y') {
-        printf("Exiting mysh.\n");
-        exit(0);
-    }
-    else{
-        printf("Continuing mysh. \n");
-        if (getcwd(current_directory, sizeof(current_directory)) == NULL) {
-            perror("getcwd failed");
-            strcpy(current_directory, "?");
-        }
-        printf("mysh:%s ~> ", current_directory);
-        fflush(stdout);
-    }
-}
-
+Arena line_arena;
+int interactive = 0;
 
 /**
  * @brief Change le répertoire de travail actuel.
@@ -142,170 +75,193 @@ void print_status() {
 
 
 /**
- * @brief Boucle principale du shell interactif.
+ * @brief Analyse et exécute une ligne de commande.
  * 
- * Gère la lecture des commandes utilisateur, l'analyse, et leur exécution.
- * Supporte les commandes internes telles que `cd`, `exit`, `status`, `myjobs`, 
- * ainsi que la gestion des variables locales et d'environnement.
+ * La ligne est transformée en arbre syntaxique dans l'arène de ligne,
+ * puis l'arbre est exécuté ; les variables sont étendues mot par mot, au
+ * moment où chaque commande est lancée. L'arène est libérée d'un coup ensuite.
+ * 
+ * @param line Ligne à exécuter (plusieurs lignes pour une commande composée).
+ * @return ParseStatus PARSE_INCOMPLETE si une commande composée n'est pas terminée :
+ *         rien n'est exécuté et la suite doit être lue.
  */
-void run_shell() {
-    int num_commands;
+static ParseStatus execute_line(const char *line) {
+    ParseStatus status;
+
+    Node *root = parse_input(&line_arena, line, &status);
+    if (status == PARSE_ERROR) {
+        last_status = 2;
+    } else if (root) {
+        execute_node(&line_arena, root);
+    }
+    arena_reset(&line_arena);
+    return status;
+}
 
-    signal(SIGINT, handle_sigint);
-    //signal(SIGCHLD, handle_sigchld);
-    //signal(SIGTSTP, handle_sigtstp);
 
-    while (1) {
-        if (getcwd(current_directory, sizeof(current_directory)) == NULL) {
-            perror("getcwd failed");
-            strcpy(current_directory, "?"); 
-        }
-        printf("mysh:%s ~> ", current_directory);
-        fflush(stdout);
+/**
+ * @brief Ajoute une ligne à une commande composée en cours de saisie.
+ *
+ * @param pending Lignes déjà lues (`NULL` au début de la commande).
+ * @param line Ligne à ajouter.
+ * @return char* Les lignes jointes par '\n', ou `NULL` si la mémoire est épuisée.
+ */
+static char *append_pending(char *pending, const char *line) {
+    size_t len = pending ? strlen(pending) + 1 : 0;
+    char *joined = realloc(pending, len + strlen(line) + 1);
+    if (!joined) {
+        perror("realloc failed");
+        free(pending);
+        return NULL;
+    }
+    if (len > 0) {
+        joined[len - 1] = '\n';
+    }
+    strcpy(joined + len, line);
+    return joined;
+}
 
-        ssize_t n = read(STDIN_FILENO, global_command_line, MAX_COMMAND_LENGTH - 1);
-        if (n > 0) {
-            global_command_line[n] = '\0';
-            size_t length = strcspn(global_command_line, "\n");
-            global_command_line[length] = '\0';
-        } else if (n == -1) {
-            perror("read error");
-            continue;
-        }
 
-        if (strlen(global_command_line) == 0) {
-            continue;
-        }
+/**
+ * @brief Demande confirmation avant de quitter le shell après un Ctrl+C.
+ *
+ * @param reader Lecteur des commandes, utilisé pour lire la réponse.
+ * @return int 1 si l'utilisateur veut quitter, 0 sinon.
+ */
+static int confirm_quit(LineReader *reader) {
+    char *answer;
+    ssize_t len;
 
-        if (strspn(global_command_line, " ") == strlen(global_command_line)) {
-            continue;
-        }
+    printf("\nDo you want to quit mysh? (y/n): ");
+    fflush(stdout);
 
-        substitute_variables(global_command_line);
+    while ((len = reader_getline(reader, &answer)) == READER_INTERRUPTED) {
+        printf("\nDo you want to quit mysh? (y/n): ");
+        fflush(stdout);
+    }
+    if (len == READER_EOF || answer[0] == 'y' || answer[0] == 'Y') {
+        printf("Exiting mysh.\n");
+        return 1;
+    }
+    printf("Continuing mysh. \n");
+    return 0;
+}
 
-        if (strncmp(global_command_line, "cd", 2) == 0) {
-            char *directory = strtok(global_command_line + 3, " ");
-            last_status = change_directory(directory);
-            strncpy(last_command_name, "cd", MAX_COMMAND_LENGTH);
-            continue;
-        }
 
-        if (strcmp(global_command_line, "exit") == 0) {
-            printf("Exiting mysh.\n");
-            exit(0);
-        }
+/**
+ * @brief Boucle principale du shell.
+ * 
+ * Lit les commandes ligne par ligne sur le descripteur donné, avec un lecteur
+ * bufferisé sans limite de longueur de ligne. Le prompt n'est affiché que si
+ * l'entrée est un terminal, ce qui permet d'exécuter un script (`mysh script.sh`
+ * ou `mysh < fichier`). Les lignes vides et les commentaires (`#`) sont ignorés.
+ * Une commande composée (`if`, `while`, `for`, fonction) incomplète est complétée
+ * par les lignes suivantes, avec le prompt `> `, avant d'être exécutée d'un bloc.
+ * 
+ * L'attente de l'entrée passe par la boucle d'événements : les jobs terminés
+ * sont récupérés dès la fin du processus et signalés avant le prompt suivant.
+ * 
+ * @param input_fd Descripteur d'où proviennent les commandes.
+ */
+void run_shell(int input_fd) {
+    LineReader reader;
+    char *line;
+    char *pending = NULL;
+    ssize_t len;
 
-        if (strcmp(global_command_line, "status") == 0) {
-            print_status();
-            continue;
-        }
+    if (reader_init(&reader, input_fd) == -1) {
+        return;
+    }
+    arena_init(&line_arena);
 
-        if (strcmp(global_command_line, "myps") == 0) {
-            myps();
-            strncpy(last_command_name, "myps", MAX_COMMAND_LENGTH);
-            last_status = 0;
-            continue;
-        }
+    interactive = isatty(input_fd);
+    if (interactive) {
+        job_control_init(input_fd);
+    }
+    if (event_loop_init(interactive) == 0) {
+        reader.wait_input = event_loop_wait;
+    }
+    // Un myls qui écrit dans un pipe fermé doit recevoir EPIPE, pas tuer le shell
+    signal(SIGPIPE, SIG_IGN);
 
-        if (strcmp(global_command_line, "myjobs") == 0) {
-            list_jobs();
-            strncpy(last_command_name, "myjobs", MAX_COMMAND_LENGTH);
-            last_status = 0;
-            continue;
+    while (1) {
+        // Un script déjà en tampon ne passe pas par l'attente : récupérer ici aussi
+        if (job_count > 0) {
+            reap_children();
         }
-
-        if (strncmp(global_command_line, "myfg", 4) == 0) {
-            int job_id = atoi(global_command_line + 5);
-            bring_job_to_foreground(job_id);
-            strncpy(last_command_name, "myfg", MAX_COMMAND_LENGTH);
-            last_status = 0;
-            continue;
+        notify_jobs(interactive);
+
+        if (interactive && pending) {
+            printf("> ");
+            fflush(stdout);
+        } else if (interactive) {
+            if (getcwd(current_directory, sizeof(current_directory)) == NULL) {
+                perror("getcwd failed");
+                strcpy(current_directory, "?"); 
+            }
+            printf("mysh:%s ~> ", current_directory);
+            fflush(stdout);
         }
 
-        if (strncmp(global_command_line, "mybg", 4) == 0) {
-            int job_id = atoi(global_command_line + 5);
-            move_job_to_background(job_id);
-            strncpy(last_command_name, "mybg", MAX_COMMAND_LENGTH);
-            last_status = 0;
+        len = reader_getline(&reader, &line);
+        if (len == READER_INTERRUPTED && pending) {
+            // Ctrl+C abandonne la commande composée en cours de saisie
+            free(pending);
+            pending = NULL;
+            printf("\n");
             continue;
         }
-
-        if (strncmp(global_command_line, "set ", 4) == 0) {
-            char *name = strtok(global_command_line + 4, "=");
-            char *value = strtok(NULL, "");
-            if (name && value) {
-                set_local_variable(name, value);
-                strncpy(last_command_name, "set", MAX_COMMAND_LENGTH);
+        if (len == READER_INTERRUPTED) {
+            if (confirm_quit(&reader)) {
                 last_status = 0;
-            } else {
-                fprintf(stderr, "Usage: set name=value\n");
-                last_status = 1;
+                break;
             }
             continue;
         }
-
-        if (strncmp(global_command_line, "setenv ", 7) == 0) {
-            char *name = strtok(global_command_line + 7, "=");
-            char *value = strtok(NULL, "");
-            if (name && value) {
-                set_env_variable(name, value);
-                strncpy(last_command_name, "setenv", MAX_COMMAND_LENGTH);
-                last_status = 0;
-            } else {
-                fprintf(stderr, "Usage: setenv name=value\n");
-                last_status = 1;
+        if (len == READER_EOF) {
+            if (interactive) {
+                printf("\n");
             }
-            continue;
+            if (pending) {
+                fprintf(stderr, "mysh: syntax error: unexpected end of file\n");
+                last_status = 2;
+            }
+            break;
         }
 
-        if (strncmp(global_command_line, "unset ", 6) == 0) {
-            char *name = global_command_line + 6;
-            if (name[0] == '$') {
-                name++;
-            }
-            unset_local_variable(name);
-            strncpy(last_command_name, "unset", MAX_COMMAND_LENGTH);
-            last_status = 0;
+        size_t skip = strspn(line, " \t");
+        if (line[skip] == '\0' || line[skip] == '#') {
             continue;
         }
 
-        if (strncmp(global_command_line, "unsetenv ", 9) == 0) {
-            char *name = global_command_line + 9;
-            if (name[0] == '$') {
-                name++; 
-            }
-            unset_env_variable(name);
-            strncpy(last_command_name, "unsetenv", MAX_COMMAND_LENGTH);
-            last_status = 0;
+        if (pending && !(pending = append_pending(pending, line))) {
             continue;
         }
+        const char *text = pending ? pending : line;
 
-        //substitute_variables(global_command_line);
-
-        num_commands = 0;
-
-
-        ParsedCommand *commands = parse_input(global_command_line, &num_commands);
+        long long span = trace_begin();
+        ParseStatus status = execute_line(text);
+        trace_end(span, "shell", "line", text);
 
-        for (int i = 0; i < num_commands; i++) {
-            bool should_run = (i == 0) ||
-                              (commands[i - 1].condition == COND_SUCCESS && last_status == 0) ||
-                              (commands[i - 1].condition == COND_FAILURE && last_status != 0) ||
-                              (commands[i - 1].condition == COND_ALWAYS);
-
-            if (should_run) {
-                foreground_running = 1;
-                strncpy(last_command_name, commands[i].command, MAX_COMMAND_LENGTH);
-                last_status = execute_command(commands[i].command);
-                foreground_running = 0;
+        if (status == PARSE_INCOMPLETE) {
+            if (!pending) {
+                pending = append_pending(NULL, line);
             }
+            continue;
         }
+        free(pending);
+        pending = NULL;
 
-        for (int i = 0; i < num_commands; i++) {
-            free(commands[i].command);
-        }
-        free(commands);
+        // Un Ctrl+C destiné à la commande au premier plan ne concerne pas le shell
+        event_loop_discard_interrupts();
+
+        // Les sorties des commandes internes doivent précéder celles des commandes suivantes
+        fflush(stdout);
     }
+
+    free(pending);
+    reader_free(&reader);
+    arena_destroy(&line_arena);
 }
 
 
@@ -314,19 +270,48 @@ void run_shell() {
  * 
  * Initialise les ressources nécessaires telles que la mémoire partagée,
  * démarre la boucle principale du shell et nettoie les ressources à la fin.
+ * Si un chemin de script est donné en argument, les commandes sont lues
+ * depuis ce fichier au lieu de l'entrée standard. L'option `--trace FICHIER`
+ * enregistre une trace de l'exécution au format Chrome trace-event.
  * 
+ * @param argc Nombre d'arguments.
+ * @param argv Arguments : `[--trace FICHIER] [script]`.
  * @return int Code de retour du programme.
  */
-int main() {
+int main(int argc, char *argv[]) {
+    int input_fd = STDIN_FILENO;
+    int arg = 1;
+
+    shell_pid = getpid();
+
+    if (arg + 1 < argc && strcmp(argv[arg], "--trace") == 0) {
+        if (trace_start(argv[arg + 1]) == -1) {
+            return 1;
+        }
+        arg += 2;
+    }
+
+    if (arg < argc) {
+        input_fd = open(argv[arg], O_RDONLY | O_CLOEXEC);
+        if (input_fd == -1) {
+            perror(argv[arg]);
+            return 127;
+        }
+    }
 
     // Initialiser la mémoire partagée pour les variables d'environnement
     init_shared_memory();
 
     // Lancer le shell
-    run_shell();
+    run_shell(input_fd);
 
     // Libérer la mémoire partagée à la fin
     destroy_shared_memory();
+    trace_stop();
 
-    return 0;
+    if (input_fd != STDIN_FILENO) {
+        close(input_fd);
+    }
+
+    return last_status > 0 ? last_status : 0;
 }
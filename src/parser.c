@@ -1,4 +1,5 @@
 #include "../include/parser.h"
+#include "../include/trace.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -23,78 +24,841 @@ void trim_whitespace(char *str) {
 }
 
 
+typedef enum {
+    TOK_WORD,
+    TOK_AND_IF,        // &&
+    TOK_OR_IF,         // ||
+    TOK_SEMI,          // ;
+    TOK_NEWLINE,       // \n
+    TOK_PIPE,          // |
+    TOK_AMP,           // &
+    TOK_REDIRECTION,   // <, >, >>, 2>, 2>>, >&, >>&
+    TOK_EOF,
+    TOK_ERROR
+} TokenType;
+
+typedef struct {
+    TokenType type;
+    const char *start;        ///< Début du jeton dans la ligne.
+    size_t len;               ///< Longueur du jeton.
+    RedirectionType redir;    ///< Type de redirection pour TOK_REDIRECTION.
+} Token;
+
+typedef struct {
+    Arena *arena;
+    const char *pos;          ///< Position de lecture du lexer.
+    const char *prev_end;     ///< Fin du dernier jeton consommé.
+    Token current;            ///< Jeton courant (un seul jeton d'avance).
+    bool error;
+    bool incomplete;          ///< La fin de l'entrée est arrivée dans une commande composée.
+    int nesting;              ///< Profondeur des commandes composées en cours d'analyse.
+} Parser;
+
+
 /**
- * @brief Analyse une chaîne d'entrée en commandes distinctes avec leurs conditions.
- * 
- * Cette fonction découpe une chaîne d'entrée utilisateur en plusieurs commandes
- * basées sur les séparateurs `&&`, `||`, ou `;`, et attribue une condition d'exécution
- * pour chaque commande. Elle retourne un tableau de commandes analysées.
+ * @brief Indique si un caractère termine un mot non protégé.
+ */
+static bool is_metachar(char c) {
+    return c == '\0' || c == ' ' || c == '\t' || c == '\n' || c == ';' ||
+           c == '&' || c == '|' || c == '<' || c == '>';
+}
+
+
+const char *find_closing_brace(const char *s) {
+    int depth = 1;
+    while (*s) {
+        if (*s == '\\' && s[1] != '\0') {
+            s += 2;
+            continue;
+        }
+        if (*s == '\'' || *s == '"') {
+            char quote = *s++;
+            while (*s && *s != quote) {
+                if (quote == '"' && *s == '\\' && s[1] != '\0') {
+                    s++;
+                }
+                s++;
+            }
+            if (*s == '\0') {
+                return NULL;
+            }
+        } else if (*s == '$' && s[1] == '{') {
+            depth++;
+            s++;
+        } else if (*s == '}' && --depth == 0) {
+            return s;
+        }
+        s++;
+    }
+    return NULL;
+}
+
+
+const char *find_arithmetic_end(const char *s) {
+    int depth = 0;
+    for (; *s; s++) {
+        if (*s == '(') {
+            depth++;
+        } else if (*s == ')' && depth > 0) {
+            depth--;
+        } else if (*s == ')') {
+            return s[1] == ')' ? s : NULL;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Lit le jeton suivant de la ligne.
  * 
- * @param input Chaîne d'entrée utilisateur.
- * @param num_commands Pointeur pour stocker le nombre de commandes analysées.
- * @return ParsedCommand* Tableau de commandes analysées.
- */
-ParsedCommand *parse_input(char *input, int *num_commands) {
-    *num_commands = 0;
-    int capacity = 10;
-    ParsedCommand *commands = malloc(capacity * sizeof(ParsedCommand));
-    char *token;
-    char *sep;
-
-    while (*input != '\0') {
-        ParsedCommand cmd;
-
-        // Default condition
-        cmd.condition = COND_ALWAYS;
-
-        // Check for `&&`, `||`, or `;`
-        if ((sep = strstr(input, "&&")) != NULL) {
-            *sep = '\0';
-            cmd.condition = COND_SUCCESS;
-            token = input;
-            input = sep + 2;
-        } else if ((sep = strstr(input, "||")) != NULL) {
-            *sep = '\0';
-            cmd.condition = COND_FAILURE;
-            token = input;
-            input = sep + 2;
-        } else if ((sep = strchr(input, ';')) != NULL) {
-            *sep = '\0';
-            cmd.condition = COND_ALWAYS;
-            token = input;
-            input = sep + 1;
+ * Les guillemets simples et doubles ainsi que les barres obliques inverses
+ * protègent les opérateurs et les espaces ; ils sont conservés dans le mot
+ * et retirés plus tard, lors de l'expansion. Un `${...}` fait partie du mot
+ * jusqu'à son accolade fermante, espaces compris (`${x:-a b}`), de même qu'un
+ * `$((...))` jusqu'à ses parenthèses fermantes (`$((a < b))`).
+ */
+static void next_token(Parser *p) {
+    const char *s = p->pos;
+    Token *tok = &p->current;
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+
+    tok->start = s;
+    tok->len = 1;
+
+    switch (*s) {
+        case '\0':
+            tok->type = TOK_EOF;
+            tok->len = 0;
+            break;
+        case '\n':
+            tok->type = TOK_NEWLINE;
+            break;
+        case ';':
+            tok->type = TOK_SEMI;
+            break;
+        case '&':
+            if (s[1] == '&') {
+                tok->type = TOK_AND_IF;
+                tok->len = 2;
+            } else {
+                tok->type = TOK_AMP;
+            }
+            break;
+        case '|':
+            if (s[1] == '|') {
+                tok->type = TOK_OR_IF;
+                tok->len = 2;
+            } else {
+                tok->type = TOK_PIPE;
+            }
+            break;
+        case '<':
+            tok->type = TOK_REDIRECTION;
+            tok->redir = REDIR_INPUT;
+            break;
+        case '>':
+            tok->type = TOK_REDIRECTION;
+            if (s[1] == '>' && s[2] == '&') {
+                tok->redir = REDIR_OUTPUT_ERROR_APPEND;
+                tok->len = 3;
+            } else if (s[1] == '>') {
+                tok->redir = REDIR_APPEND;
+                tok->len = 2;
+            } else if (s[1] == '&') {
+                tok->redir = REDIR_OUTPUT_ERROR;
+                tok->len = 2;
+            } else {
+                tok->redir = REDIR_OUTPUT;
+            }
+            break;
+        default:
+            if (s[0] == '2' && s[1] == '>') {
+                tok->type = TOK_REDIRECTION;
+                tok->redir = (s[2] == '>') ? REDIR_ERROR_APPEND : REDIR_ERROR;
+                tok->len = (s[2] == '>') ? 3 : 2;
+                break;
+            }
+
+            tok->type = TOK_WORD;
+            const char *end = s;
+            while (!is_metachar(*end)) {
+                if (*end == '\\' && end[1] != '\0') {
+                    end += 2;
+                } else if (*end == '$' && end[1] == '(' && end[2] == '(') {
+                    const char *close = find_arithmetic_end(end + 3);
+                    if (!close) {
+                        fprintf(stderr, "mysh: syntax error: missing `))' in arithmetic expansion\n");
+                        tok->type = TOK_ERROR;
+                        break;
+                    }
+                    end = close + 2;
+                } else if (*end == '$' && end[1] == '{') {
+                    const char *close = find_closing_brace(end + 2);
+                    if (!close) {
+                        fprintf(stderr, "mysh: syntax error: missing `}' in parameter expansion\n");
+                        tok->type = TOK_ERROR;
+                        break;
+                    }
+                    end = close + 1;
+                } else if (*end == '\'' || *end == '"') {
+                    char quote = *end++;
+                    while (*end && *end != quote) {
+                        if (quote == '"' && *end == '\\' && end[1] != '\0') {
+                            end++;
+                        }
+                        end++;
+                    }
+                    if (*end == '\0') {
+                        fprintf(stderr, "mysh: syntax error: unterminated quote\n");
+                        tok->type = TOK_ERROR;
+                        break;
+                    }
+                    end++;
+                } else {
+                    end++;
+                }
+            }
+            tok->len = end - s;
+            break;
+    }
+
+    p->pos = s + tok->len;
+}
+
+
+/**
+ * @brief Consomme le jeton courant et lit le suivant.
+ */
+static void advance(Parser *p) {
+    p->prev_end = p->current.start + p->current.len;
+    next_token(p);
+}
+
+
+/**
+ * @brief Signale une erreur de syntaxe sur le jeton courant.
+ */
+static void syntax_error(Parser *p) {
+    // Une commande composée coupée par la fin de l'entrée continue à la ligne suivante
+    if (!p->error && p->current.type == TOK_EOF && p->nesting > 0) {
+        p->incomplete = true;
+    } else if (!p->error && p->current.type != TOK_ERROR) {
+        if (p->current.type == TOK_EOF || p->current.type == TOK_NEWLINE) {
+            fprintf(stderr, "mysh: syntax error near unexpected end of line\n");
         } else {
-            token = input;
-            input += strlen(input);
+            fprintf(stderr, "mysh: syntax error near unexpected token `%.*s'\n",
+                    (int)p->current.len, p->current.start);
+        }
+    }
+    p->error = true;
+}
+
+
+static Node *new_node(Parser *p, NodeType type) {
+    Node *node = arena_alloc(p->arena, sizeof(Node));
+    if (!node) {
+        p->error = true;
+        return NULL;
+    }
+    memset(node, 0, sizeof(Node));
+    node->type = type;
+    return node;
+}
+
+
+/**
+ * @brief Agrandit un tableau alloué dans l'arène (l'ancien espace est abandonné).
+ */
+static void *grow_array(Parser *p, void *array, int count, int *capacity, size_t elem_size) {
+    if (count < *capacity) {
+        return array;
+    }
+    int new_capacity = *capacity ? *capacity * 2 : 8;
+    void *new_array = arena_alloc(p->arena, new_capacity * elem_size);
+    if (!new_array) {
+        p->error = true;
+        return NULL;
+    }
+    if (array) {
+        memcpy(new_array, array, count * elem_size);
+    }
+    *capacity = new_capacity;
+    return new_array;
+}
+
+
+/**
+ * @brief command := (WORD | redirection WORD)+
+ */
+static bool parse_command(Parser *p, SimpleCommand *cmd) {
+    int capacity = 0;
+    Redirection **tail = &cmd->redirections;
+
+    cmd->argc = 0;
+    cmd->argv = NULL;
+    cmd->redirections = NULL;
+
+    while (!p->error) {
+        if (p->current.type == TOK_WORD) {
+            cmd->argv = grow_array(p, cmd->argv, cmd->argc + 1, &capacity, sizeof(char *));
+            if (!cmd->argv) {
+                return false;
+            }
+            cmd->argv[cmd->argc++] = arena_strndup(p->arena, p->current.start, p->current.len);
+            advance(p);
+        } else if (p->current.type == TOK_REDIRECTION) {
+            RedirectionType type = p->current.redir;
+            advance(p);
+            if (p->current.type != TOK_WORD) {
+                syntax_error(p);
+                return false;
+            }
+            Redirection *redir = arena_alloc(p->arena, sizeof(Redirection));
+            if (!redir) {
+                p->error = true;
+                return false;
+            }
+            redir->type = type;
+            redir->target = arena_strndup(p->arena, p->current.start, p->current.len);
+            redir->next = NULL;
+            *tail = redir;
+            tail = &redir->next;
+            advance(p);
+        } else {
+            break;
+        }
+    }
+
+    if (p->error) {
+        return false;
+    }
+    if (cmd->argc == 0 && cmd->redirections == NULL) {
+        syntax_error(p);
+        return false;
+    }
+    if (cmd->argv) {
+        cmd->argv[cmd->argc] = NULL;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Indique si le jeton courant est le mot réservé donné (non protégé).
+ */
+static bool is_keyword(const Parser *p, const char *word) {
+    size_t len = strlen(word);
+    return p->current.type == TOK_WORD && p->current.len == len && strncmp(p->current.start, word, len) == 0;
+}
+
+
+/**
+ * @brief Indique si le jeton courant termine la liste d'une commande composée.
+ */
+static bool at_list_terminator(const Parser *p) {
+    return is_keyword(p, "then") || is_keyword(p, "elif") || is_keyword(p, "else") ||
+           is_keyword(p, "fi") || is_keyword(p, "do") || is_keyword(p, "done") || is_keyword(p, "}");
+}
+
+
+/**
+ * @brief Consomme le mot réservé attendu, ou signale une erreur.
+ */
+static bool expect_keyword(Parser *p, const char *word) {
+    if (!is_keyword(p, word)) {
+        syntax_error(p);
+        return false;
+    }
+    advance(p);
+    return true;
+}
+
+
+static void skip_newlines(Parser *p) {
+    while (p->current.type == TOK_NEWLINE) {
+        advance(p);
+    }
+}
+
+
+/**
+ * @brief Indique si un texte est un nom de variable ou de fonction valide.
+ */
+static bool is_valid_name(const char *s, size_t len) {
+    if (len == 0 || !(isalpha((unsigned char)s[0]) || s[0] == '_')) {
+        return false;
+    }
+    for (size_t i = 1; i < len; i++) {
+        if (!(isalnum((unsigned char)s[i]) || s[i] == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static Node *parse_list(Parser *p);
+static Node *parse_compound(Parser *p);
+
+
+/**
+ * @brief Liste obligatoire d'une commande composée (corps, condition).
+ */
+static Node *parse_body(Parser *p) {
+    Node *body = parse_list(p);
+    if (!body && !p->error) {
+        syntax_error(p);
+    }
+    return body;
+}
+
+
+/**
+ * @brief if_tail := list 'then' list ('elif' if_tail | 'else' list 'fi' | 'fi')
+ */
+static Node *parse_if_tail(Parser *p) {
+    Node *node = new_node(p, NODE_IF);
+    if (!node || !(node->if_clause.condition = parse_body(p)) || !expect_keyword(p, "then") ||
+        !(node->if_clause.then_part = parse_body(p))) {
+        return NULL;
+    }
+
+    if (is_keyword(p, "elif")) {
+        const char *start = p->current.start;
+        advance(p);
+        node->if_clause.else_part = parse_if_tail(p);
+        if (!node->if_clause.else_part) {
+            return NULL;
+        }
+        node->if_clause.else_part->text = arena_strndup(p->arena, start, p->prev_end - start);
+        return node;
+    }
+    if (is_keyword(p, "else")) {
+        advance(p);
+        if (!(node->if_clause.else_part = parse_body(p))) {
+            return NULL;
+        }
+    }
+    return expect_keyword(p, "fi") ? node : NULL;
+}
+
+
+/**
+ * @brief while_clause := ('while' | 'until') list 'do' list 'done'
+ */
+static Node *parse_while(Parser *p) {
+    Node *node = new_node(p, NODE_WHILE);
+    if (!node) {
+        return NULL;
+    }
+    node->loop.until = is_keyword(p, "until");
+    advance(p);
+    if (!(node->loop.condition = parse_body(p)) || !expect_keyword(p, "do") ||
+        !(node->loop.body = parse_body(p)) || !expect_keyword(p, "done")) {
+        return NULL;
+    }
+    return node;
+}
+
+
+/**
+ * @brief for_clause := 'for' NAME [NEWLINE* 'in' WORD* (';' | NEWLINE)] [';'] NEWLINE* 'do' list 'done'
+ */
+static Node *parse_for(Parser *p) {
+    Node *node = new_node(p, NODE_FOR);
+    if (!node) {
+        return NULL;
+    }
+    advance(p);
+    if (p->current.type != TOK_WORD || !is_valid_name(p->current.start, p->current.len)) {
+        syntax_error(p);
+        return NULL;
+    }
+    node->for_loop.variable = arena_strndup(p->arena, p->current.start, p->current.len);
+    advance(p);
+    skip_newlines(p);
+
+    if (is_keyword(p, "in")) {
+        int capacity = 0;
+        advance(p);
+        while (p->current.type == TOK_WORD) {
+            node->for_loop.words = grow_array(p, node->for_loop.words, node->for_loop.num_words + 1,
+                                              &capacity, sizeof(char *));
+            if (!node->for_loop.words) {
+                return NULL;
+            }
+            node->for_loop.words[node->for_loop.num_words++] =
+                arena_strndup(p->arena, p->current.start, p->current.len);
+            advance(p);
+        }
+        if (!node->for_loop.words) {
+            // `for x in ; do` : liste vide, différente de l'absence de `in`
+            node->for_loop.words = grow_array(p, NULL, 0, &capacity, sizeof(char *));
+            if (!node->for_loop.words) {
+                return NULL;
+            }
+        }
+        if (p->current.type != TOK_SEMI && p->current.type != TOK_NEWLINE) {
+            syntax_error(p);
+            return NULL;
+        }
+        advance(p);
+    } else if (p->current.type == TOK_SEMI) {
+        advance(p);
+    }
+    skip_newlines(p);
+
+    if (!expect_keyword(p, "do") || !(node->for_loop.body = parse_body(p)) || !expect_keyword(p, "done")) {
+        return NULL;
+    }
+    return node;
+}
+
+
+/**
+ * @brief Reconnaît le début d'une définition de fonction : `nom()`, `nom ()` ou `function nom`.
+ *
+ * @param name_len Reçoit la longueur du nom, au début du jeton courant une fois reconnu.
+ */
+static bool at_function_definition(Parser *p, size_t *name_len) {
+    if (p->current.type != TOK_WORD) {
+        return false;
+    }
+    const char *word = p->current.start;
+    size_t len = p->current.len;
+
+    if (len > 2 && word[len - 2] == '(' && word[len - 1] == ')' && is_valid_name(word, len - 2)) {
+        *name_len = len - 2;
+        return true;
+    }
+    if (!is_valid_name(word, len)) {
+        return false;
+    }
+    // `nom ()` : le mot suivant est regardé dans le texte, sans relancer le lexer
+    const char *next = p->pos + strspn(p->pos, " \t");
+    *name_len = len;
+    return next[0] == '(' && next[1] == ')' && is_metachar(next[2]);
+}
+
+
+/**
+ * @brief function := ('function' NAME ['()'] | NAME '()') NEWLINE* compound
+ */
+static Node *parse_function(Parser *p, size_t name_len) {
+    Node *node = new_node(p, NODE_FUNCTION);
+    if (!node) {
+        return NULL;
+    }
+    if (is_keyword(p, "function")) {
+        advance(p);
+        if (p->current.type != TOK_WORD) {
+            syntax_error(p);
+            return NULL;
+        }
+        name_len = p->current.len;
+        if (name_len > 2 && strncmp(p->current.start + name_len - 2, "()", 2) == 0) {
+            name_len -= 2;
+        }
+        if (!is_valid_name(p->current.start, name_len)) {
+            syntax_error(p);
+            return NULL;
         }
+    }
+    node->function.name = arena_strndup(p->arena, p->current.start, name_len);
+    bool separate_parentheses = p->current.len == name_len;
+    advance(p);
+    if (separate_parentheses && is_keyword(p, "()")) {
+        advance(p);
+    }
+    skip_newlines(p);
 
-        trim_whitespace(token);
-        cmd.command = strdup(token);
+    if (!(is_keyword(p, "{") || is_keyword(p, "if") || is_keyword(p, "while") ||
+          is_keyword(p, "until") || is_keyword(p, "for"))) {
+        syntax_error(p);
+        return NULL;
+    }
+    node->function.body = parse_compound(p);
+    return node->function.body ? node : NULL;
+}
 
-        if (*num_commands >= capacity) {
-            capacity *= 2;
-            commands = realloc(commands, capacity * sizeof(ParsedCommand));
+
+/**
+ * @brief compound := if_clause | while_clause | for_clause | '{' list '}' | function
+ *
+ * @return Node* La commande composée, ou `NULL` si le jeton courant n'en commence pas
+ *         une (sans erreur) ou en cas d'erreur.
+ */
+static Node *parse_compound(Parser *p) {
+    const char *start = p->current.start;
+    size_t name_len = 0;
+    Node *node;
+
+    p->nesting++;
+    if (is_keyword(p, "if")) {
+        advance(p);
+        node = parse_if_tail(p);
+    } else if (is_keyword(p, "while") || is_keyword(p, "until")) {
+        node = parse_while(p);
+    } else if (is_keyword(p, "for")) {
+        node = parse_for(p);
+    } else if (is_keyword(p, "{")) {
+        node = new_node(p, NODE_GROUP);
+        advance(p);
+        if (node && (!(node->child = parse_body(p)) || !expect_keyword(p, "}"))) {
+            node = NULL;
         }
-        commands[(*num_commands)++] = cmd;
+    } else if (is_keyword(p, "function") || at_function_definition(p, &name_len)) {
+        node = parse_function(p, is_keyword(p, "function") ? 0 : name_len);
+    } else {
+        p->nesting--;
+        return NULL;
+    }
+    p->nesting--;
+
+    if (node) {
+        node->text = arena_strndup(p->arena, start, p->prev_end - start);
     }
-    
-    return commands;
+    return node;
+}
+
+
+/**
+ * @brief Indique si le jeton courant commence une commande composée.
+ */
+static bool at_compound(Parser *p) {
+    size_t name_len = 0;
+    return is_keyword(p, "if") || is_keyword(p, "while") || is_keyword(p, "until") ||
+           is_keyword(p, "for") || is_keyword(p, "{") || is_keyword(p, "function") ||
+           at_function_definition(p, &name_len);
+}
+
+
+/**
+ * @brief Consomme un préfixe `time` s'il est suivi d'une commande.
+ * 
+ * Un `time` seul, ou entre guillemets, reste un mot ordinaire. Une erreur du
+ * lexer sur le jeton suivant est laissée à parse_command, déjà signalée.
+ */
+static bool parse_time_prefix(Parser *p) {
+    if (p->current.type != TOK_WORD || p->current.len != 4 ||
+        strncmp(p->current.start, "time", 4) != 0) {
+        return false;
+    }
+
+    Parser saved = *p;
+    advance(p);
+    if (p->current.type == TOK_WORD || p->current.type == TOK_REDIRECTION ||
+        p->current.type == TOK_ERROR) {
+        return true;
+    }
+    *p = saved;
+    return false;
+}
+
+
+/**
+ * @brief pipeline := compound | ['time'] command ('|' command)*
+ *
+ * Une commande composée ne peut pas être une étape de pipeline ni recevoir de redirections.
+ */
+static Node *parse_pipeline(Parser *p) {
+    if (at_compound(p)) {
+        return parse_compound(p);
+    }
+
+    bool timed = parse_time_prefix(p);
+    const char *start = p->current.start;
+    SimpleCommand first;
+
+    if (!parse_command(p, &first)) {
+        return NULL;
+    }
+
+    Node *node;
+    if (p->current.type != TOK_PIPE) {
+        node = new_node(p, NODE_COMMAND);
+        if (!node) {
+            return NULL;
+        }
+        node->command = first;
+    } else {
+        node = new_node(p, NODE_PIPELINE);
+        if (!node) {
+            return NULL;
+        }
+        int capacity = 0;
+        SimpleCommand *stages = grow_array(p, NULL, 0, &capacity, sizeof(SimpleCommand));
+        int count = 0;
+        if (!stages) {
+            return NULL;
+        }
+        stages[count++] = first;
+
+        while (p->current.type == TOK_PIPE) {
+            advance(p);
+            while (p->current.type == TOK_NEWLINE) {
+                advance(p);
+            }
+            stages = grow_array(p, stages, count, &capacity, sizeof(SimpleCommand));
+            if (!stages || !parse_command(p, &stages[count])) {
+                return NULL;
+            }
+            count++;
+        }
+        node->pipeline.num_stages = count;
+        node->pipeline.stages = stages;
+    }
+
+    node->text = arena_strndup(p->arena, start, p->prev_end - start);
+    node->timed = timed;
+    return node;
+}
+
+
+/**
+ * @brief and_or := pipeline (('&&' | '||') pipeline)*
+ */
+static Node *parse_and_or(Parser *p) {
+    Node *left = parse_pipeline(p);
+
+    while (left && (p->current.type == TOK_AND_IF || p->current.type == TOK_OR_IF)) {
+        Node *node = new_node(p, p->current.type == TOK_AND_IF ? NODE_AND : NODE_OR);
+        advance(p);
+        while (p->current.type == TOK_NEWLINE) {
+            advance(p);
+        }
+        Node *right = parse_pipeline(p);
+        if (!node || !right) {
+            return NULL;
+        }
+        node->binary.left = left;
+        node->binary.right = right;
+        left = node;
+    }
+    return left;
+}
+
+
+/**
+ * @brief list := and_or ((';' | '&' | NEWLINE) and_or)* [';' | '&']
+ *
+ * La liste s'arrête aussi sur un mot réservé qui la termine (`then`, `fi`, `done`...).
+ */
+static Node *parse_list(Parser *p) {
+    Node *root = NULL;
+
+    while (!p->error) {
+        while (p->current.type == TOK_NEWLINE) {
+            advance(p);
+        }
+        if (p->current.type == TOK_EOF || at_list_terminator(p)) {
+            break;
+        }
+
+        Node *item = parse_and_or(p);
+        if (!item) {
+            return NULL;
+        }
+
+        if (p->current.type == TOK_AMP) {
+            Node *bg = new_node(p, NODE_BACKGROUND);
+            if (!bg) {
+                return NULL;
+            }
+            bg->child = item;
+            item = bg;
+            advance(p);
+        } else if (p->current.type == TOK_SEMI || p->current.type == TOK_NEWLINE) {
+            advance(p);
+        } else if (p->current.type != TOK_EOF && !at_list_terminator(p)) {
+            syntax_error(p);
+            return NULL;
+        }
+
+        if (!root) {
+            root = item;
+        } else {
+            Node *seq = new_node(p, NODE_SEQUENCE);
+            if (!seq) {
+                return NULL;
+            }
+            seq->binary.left = root;
+            seq->binary.right = item;
+            root = seq;
+        }
+    }
+    return root;
+}
+
+
+/**
+ * @brief Analyse une chaîne d'entrée en un arbre syntaxique.
+ * 
+ * Un lexer lit la ligne une seule fois, de gauche à droite, et fournit les jetons
+ * à un analyseur récursif descendant. Les opérateurs `;`, `&&`, `||`, `|` et `&`
+ * sont pris dans l'ordre où ils apparaissent, et les opérateurs entre guillemets
+ * restent dans les mots. L'arbre produit distingue séquences, listes `&&`/`||`,
+ * pipelines et commandes simples (arguments et redirections), ainsi que les
+ * commandes composées `if`, `while`/`until`, `for`, `{ ... }` et les définitions de
+ * fonctions. Aucune allocation n'est faite hors de l'arène.
+ * 
+ * @param arena Arène recevant l'arbre.
+ * @param input Chaîne d'entrée utilisateur (éventuellement sur plusieurs lignes).
+ * @param status Reçoit PARSE_INCOMPLETE si l'entrée s'arrête au milieu d'une
+ *        commande composée, PARSE_ERROR si elle est mal formée.
+ * @return Node* Racine de l'arbre, ou `NULL` si la ligne est vide ou invalide.
+ */
+Node *parse_input(Arena *arena, const char *input, ParseStatus *status) {
+    Parser p = { .arena = arena, .pos = input, .prev_end = input, .error = false };
+    long long span = trace_begin();
+
+    next_token(&p);
+    Node *root = parse_list(&p);
+    if (!p.error && p.current.type != TOK_EOF) {
+        // Un `fi`, `done` ou `}` sans commande composée ouverte
+        syntax_error(&p);
+    }
+    if (p.current.type == TOK_ERROR) {
+        p.error = true;
+    }
+
+    trace_end(span, "shell", "parse", input);
+    *status = p.incomplete ? PARSE_INCOMPLETE : p.error ? PARSE_ERROR : PARSE_OK;
+    return p.error ? NULL : root;
 }
 
 
 /**
  * @brief Supprime les guillemets simples ou doubles d'une chaîne.
  * 
- * Cette fonction modifie la chaîne donnée en place pour retirer tous les
- * guillemets simples (') ou doubles (") qu'elle contient.
+ * Cette fonction modifie la chaîne donnée en place pour retirer les
+ * guillemets simples (') ou doubles (") qui délimitent des parties du mot,
+ * ainsi que les barres obliques inverses qui protègent le caractère suivant.
  * 
  * @param str Chaîne de caractères à modifier.
  */
 void remove_quotes(char *str) {
     char *src = str, *dest = str;
+    char quote = 0;
 
     while (*src) {
-        if (*src != '"' && *src != '\'') {
+        if (quote) {
+            if (*src == quote) {
+                quote = 0;
+            } else if (quote == '"' && *src == '\\' && (src[1] == '"' || src[1] == '\\' || src[1] == '$')) {
+                *dest++ = *++src;
+            } else {
+                *dest++ = *src;
+            }
+        } else if (*src == '"' || *src == '\'') {
+            quote = *src;
+        } else if (*src == '\\' && src[1] != '\0') {
+            *dest++ = *++src;
+        } else {
             *dest++ = *src;
         }
         src++;
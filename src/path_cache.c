@@ -0,0 +1,198 @@
+#include "../include/path_cache.h"
+#include "../include/variable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define PATH_CACHE_INITIAL_BUCKETS 64
+
+
+typedef struct PathEntry {
+    char *name;
+    char *path;
+    unsigned int hits;
+    struct PathEntry *next;
+} PathEntry;
+
+static PathEntry **buckets = NULL;
+static size_t bucket_count = 0;
+static size_t entry_count = 0;
+static char *cached_path_var = NULL;
+
+
+/**
+ * @brief Fonction de hachage FNV-1a sur une chaîne.
+ */
+static unsigned long hash_string(const char *str) {
+    unsigned long hash = 2166136261UL;
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+
+/**
+ * @brief Double le nombre de seaux de la table et y replace les entrées.
+ */
+static void grow_table() {
+    size_t new_count = bucket_count ? bucket_count * 2 : PATH_CACHE_INITIAL_BUCKETS;
+    PathEntry **new_buckets = calloc(new_count, sizeof(PathEntry *));
+    if (!new_buckets) {
+        return;
+    }
+    for (size_t i = 0; i < bucket_count; i++) {
+        PathEntry *entry = buckets[i];
+        while (entry) {
+            PathEntry *next = entry->next;
+            size_t index = hash_string(entry->name) & (new_count - 1);
+            entry->next = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(buckets);
+    buckets = new_buckets;
+    bucket_count = new_count;
+}
+
+
+void path_cache_clear() {
+    for (size_t i = 0; i < bucket_count; i++) {
+        PathEntry *entry = buckets[i];
+        while (entry) {
+            PathEntry *next = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+            entry = next;
+        }
+        buckets[i] = NULL;
+    }
+    entry_count = 0;
+}
+
+
+/**
+ * @brief Vide le cache si $PATH a changé depuis le dernier remplissage.
+ */
+static void check_path_variable() {
+    const char *path_var = get_environment_value("PATH");
+    if (!path_var) {
+        path_var = "";
+    }
+    if (cached_path_var && strcmp(cached_path_var, path_var) == 0) {
+        return;
+    }
+    path_cache_clear();
+    free(cached_path_var);
+    cached_path_var = strdup(path_var);
+}
+
+
+/**
+ * @brief Parcourt les répertoires de $PATH à la recherche d'un exécutable.
+ * 
+ * @param name Nom de la commande.
+ * @return char* Chemin alloué de l'exécutable, ou `NULL` s'il est introuvable.
+ */
+static char *search_path(const char *name) {
+    const char *dir = cached_path_var;
+    size_t name_len = strlen(name);
+
+    while (dir && *dir) {
+        const char *end = strchr(dir, ':');
+        size_t dir_len = end ? (size_t)(end - dir) : strlen(dir);
+
+        // Un élément vide de $PATH désigne le répertoire courant
+        const char *prefix = dir_len ? dir : ".";
+        size_t prefix_len = dir_len ? dir_len : 1;
+
+        char *candidate = malloc(prefix_len + 1 + name_len + 1);
+        if (!candidate) {
+            return NULL;
+        }
+        memcpy(candidate, prefix, prefix_len);
+        candidate[prefix_len] = '/';
+        memcpy(candidate + prefix_len + 1, name, name_len + 1);
+
+        struct stat st;
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            return candidate;
+        }
+        free(candidate);
+
+        dir = end ? end + 1 : NULL;
+    }
+    return NULL;
+}
+
+
+const char *path_cache_lookup(const char *name) {
+    if (!name || *name == '\0') {
+        return NULL;
+    }
+    if (strchr(name, '/')) {
+        return name;
+    }
+
+    check_path_variable();
+    if (!buckets) {
+        grow_table();
+        if (!buckets) {
+            return NULL;
+        }
+    }
+
+    size_t index = hash_string(name) & (bucket_count - 1);
+    for (PathEntry *entry = buckets[index]; entry; entry = entry->next) {
+        if (strcmp(entry->name, name) == 0) {
+            entry->hits++;
+            return entry->path;
+        }
+    }
+
+    char *path = search_path(name);
+    if (!path) {
+        return NULL;
+    }
+
+    PathEntry *entry = malloc(sizeof(PathEntry));
+    char *name_copy = strdup(name);
+    if (!entry || !name_copy) {
+        free(entry);
+        free(name_copy);
+        free(path);
+        return NULL;
+    }
+    entry->name = name_copy;
+    entry->path = path;
+    entry->hits = 1;
+
+    if (entry_count + 1 > bucket_count * 2) {
+        grow_table();
+        index = hash_string(name) & (bucket_count - 1);
+    }
+    entry->next = buckets[index];
+    buckets[index] = entry;
+    entry_count++;
+
+    return entry->path;
+}
+
+
+void path_cache_list() {
+    if (entry_count == 0) {
+        printf("hash: hash table empty\n");
+        return;
+    }
+    printf("hits\tcommand\n");
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (PathEntry *entry = buckets[i]; entry; entry = entry->next) {
+            printf("%4u\t%s\n", entry->hits, entry->path);
+        }
+    }
+}
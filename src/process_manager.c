@@ -1,79 +1,647 @@
 #include "../include/process_manager.h"
+#include "../include/accounting.h"
+#include "../include/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <errno.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
-#define MAX_JOBS 100
+#define JOB_INDEX_INITIAL_BUCKETS 64
 
 
-Job jobs[MAX_JOBS];
+/**
+ * @brief Entrée de l'index par PID : processus `proc` du job `job`.
+ */
+typedef struct PidEntry {
+    pid_t pid;
+    Job *job;
+    int proc;
+    struct PidEntry *next;
+} PidEntry;
+
+static PidEntry **pid_buckets = NULL;
+static size_t pid_bucket_count = 0;
+static size_t pid_entry_count = 0;
+
+static Job **id_buckets = NULL;
+static size_t id_bucket_count = 0;
+
+static Job *first_job = NULL;
+static Job *last_job = NULL;
+static int next_job_id = 1;
 int job_count = 0;
+pid_t last_background_pid = 0;
+
+static int job_control = 0;
+static int terminal_fd = -1;
+static pid_t shell_pgid = 0;
+
+
+/**
+ * @brief Case de l'index par PID (hachage multiplicatif).
+ */
+static size_t pid_slot(pid_t pid, size_t count) {
+    return ((size_t)pid * 2654435761UL) & (count - 1);
+}
+
+
+/**
+ * @brief Double le nombre de seaux de l'index par PID et y replace les entrées.
+ */
+static int grow_pid_index() {
+    size_t new_count = pid_bucket_count ? pid_bucket_count * 2 : JOB_INDEX_INITIAL_BUCKETS;
+    PidEntry **new_buckets = calloc(new_count, sizeof(PidEntry *));
+    if (!new_buckets) {
+        return -1;
+    }
+    for (size_t i = 0; i < pid_bucket_count; i++) {
+        PidEntry *entry = pid_buckets[i];
+        while (entry) {
+            PidEntry *next = entry->next;
+            size_t index = pid_slot(entry->pid, new_count);
+            entry->next = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(pid_buckets);
+    pid_buckets = new_buckets;
+    pid_bucket_count = new_count;
+    return 0;
+}
+
+
+/**
+ * @brief Double le nombre de seaux de l'index par identifiant et y replace les jobs.
+ */
+static int grow_id_index() {
+    size_t new_count = id_bucket_count ? id_bucket_count * 2 : JOB_INDEX_INITIAL_BUCKETS;
+    Job **new_buckets = calloc(new_count, sizeof(Job *));
+    if (!new_buckets) {
+        return -1;
+    }
+    for (Job *job = first_job; job; job = job->next) {
+        size_t index = (size_t)job->job_id & (new_count - 1);
+        job->id_next = new_buckets[index];
+        new_buckets[index] = job;
+    }
+    free(id_buckets);
+    id_buckets = new_buckets;
+    id_bucket_count = new_count;
+    return 0;
+}
+
+
+/**
+ * @brief Cherche l'entrée d'un PID dans l'index.
+ */
+static PidEntry *find_pid(pid_t pid) {
+    if (!pid_bucket_count) {
+        return NULL;
+    }
+    for (PidEntry *entry = pid_buckets[pid_slot(pid, pid_bucket_count)]; entry; entry = entry->next) {
+        if (entry->pid == pid) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
 
-void add_job(pid_t pid, const char *command) {
-    if (job_count >= MAX_JOBS) {
+/**
+ * @brief Cherche un job enregistré par son identifiant (0 : le plus récent).
+ */
+static Job *find_job(int job_id) {
+    if (job_id == 0) {
+        return last_job;
+    }
+    if (!id_bucket_count) {
+        return NULL;
+    }
+    for (Job *job = id_buckets[(size_t)job_id & (id_bucket_count - 1)]; job; job = job->id_next) {
+        if (job->job_id == job_id) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Attribue un identifiant au job et l'ajoute à la table.
+ */
+static int register_job(Job *job) {
+    if ((size_t)job_count >= id_bucket_count && grow_id_index() == -1) {
         fprintf(stderr, "Job list is full.\n");
-        return;
+        return -1;
     }
-    
-    jobs[job_count].job_id = job_count + 1;
-    jobs[job_count].pid = pid;
-    strncpy(jobs[job_count].command, command, 255);
-    jobs[job_count].command[255] = '\0';
-    jobs[job_count].running = 1;
+    job->job_id = next_job_id++;
+
+    size_t index = (size_t)job->job_id & (id_bucket_count - 1);
+    job->id_next = id_buckets[index];
+    id_buckets[index] = job;
+
+    job->prev = last_job;
+    job->next = NULL;
+    if (last_job) {
+        last_job->next = job;
+    } else {
+        first_job = job;
+    }
+    last_job = job;
     job_count++;
-    printf("[%d] %d\n", jobs[job_count - 1].job_id, pid);
+    return 0;
 }
 
-void remove_job(pid_t pid) {
-    for (int i = 0; i < job_count; i++) {
-        if (jobs[i].pid == pid) {
-            for (int j = i; j < job_count - 1; j++) {
-                jobs[j] = jobs[j + 1];
+
+/**
+ * @brief Recalcule l'état global d'un job à partir de celui de ses processus.
+ */
+static void update_job_state(Job *job) {
+    int live = 0, stopped = 0;
+    for (int i = 0; i < job->num_procs; i++) {
+        if (job->procs[i].state == PROCESS_DONE) {
+            continue;
+        }
+        live++;
+        if (job->procs[i].state == PROCESS_STOPPED) {
+            stopped++;
+        }
+    }
+    job->running = (stopped == 0);
+    if (live == 0 && job->num_procs > 0) {
+        job->done = 1;
+        job->exit_status = job->procs[job->num_procs - 1].exit_status;
+    }
+}
+
+
+/**
+ * @brief Applique un statut renvoyé par wait4 à un processus d'un job.
+ */
+static void set_process_state(Job *job, int proc, int status, const struct rusage *usage) {
+    JobProcess *process = &job->procs[proc];
+
+    if (WIFSTOPPED(status)) {
+        process->state = PROCESS_STOPPED;
+        return;
+    }
+    if (WIFCONTINUED(status)) {
+        process->state = PROCESS_RUNNING;
+        return;
+    }
+
+    process->state = PROCESS_DONE;
+    process->exit_status = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+    clock_gettime(CLOCK_MONOTONIC, &process->finished);
+    if (usage) {
+        process->usage = *usage;
+    }
+    trace_process(process->pid, process->name, &process->started, &process->finished, process->exit_status);
+}
+
+
+/**
+ * @brief Envoie un signal à tous les processus encore vivants d'un job.
+ */
+static void signal_job(const Job *job, int sig) {
+    if (job->own_group) {
+        kill(-job->pgid, sig);
+        return;
+    }
+    for (int i = 0; i < job->num_procs; i++) {
+        if (job->procs[i].state != PROCESS_DONE) {
+            kill(job->procs[i].pid, sig);
+        }
+    }
+}
+
+
+/**
+ * @brief Relance les processus stoppés d'un job.
+ */
+static void continue_job(Job *job) {
+    for (int i = 0; i < job->num_procs; i++) {
+        if (job->procs[i].state == PROCESS_STOPPED) {
+            job->procs[i].state = PROCESS_RUNNING;
+        }
+    }
+    job->running = 1;
+    signal_job(job, SIGCONT);
+}
+
+
+/**
+ * @brief PID affiché pour un job : celui de son dernier processus, comme `[n] pid`.
+ */
+static pid_t job_display_pid(const Job *job) {
+    return job->num_procs ? job->procs[job->num_procs - 1].pid : 0;
+}
+
+
+int job_control_init(int fd) {
+    pid_t foreground;
+
+    shell_pgid = getpgrp();
+    // Lancé en arrière-plan : attendre d'être mis au premier plan avant de prendre le terminal
+    while ((foreground = tcgetpgrp(fd)) != -1 && foreground != shell_pgid) {
+        kill(-shell_pgid, SIGTTIN);
+        shell_pgid = getpgrp();
+    }
+
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGTTIN, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+
+    pid_t pid = getpid();
+    if (shell_pgid != pid && setpgid(pid, pid) == -1) {
+        perror("setpgid failed");
+        return -1;
+    }
+    shell_pgid = pid;
+    if (tcsetpgrp(fd, shell_pgid) == -1) {
+        perror("tcsetpgrp failed");
+        return -1;
+    }
+
+    terminal_fd = fd;
+    job_control = 1;
+    return 0;
+}
+
+void job_control_disable() {
+    job_control = 0;
+    terminal_fd = -1;
+}
+
+Job *job_create(const char *command, int foreground) {
+    Job *job = calloc(1, sizeof(Job));
+    if (!job) {
+        perror("calloc failed");
+        return NULL;
+    }
+    job->command = strdup(command ? command : "");
+    if (!job->command) {
+        perror("strdup failed");
+        free(job);
+        return NULL;
+    }
+    job->own_group = job_control;
+    job->foreground = foreground;
+    job->running = 1;
+    return job;
+}
+
+pid_t job_next_pgid(const Job *job) {
+    return (job && job->own_group) ? job->pgid : -1;
+}
+
+int job_terminal(const Job *job) {
+    return (job && job->own_group && job->foreground) ? terminal_fd : -1;
+}
+
+void job_setup_child(const Job *job) {
+    sigset_t empty_mask;
+
+    if (job && job->own_group) {
+        pid_t pgid = job->pgid ? job->pgid : getpid();
+        setpgid(0, pgid);
+        if (job->foreground && terminal_fd != -1) {
+            tcsetpgrp(terminal_fd, pgid);
+        }
+    }
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+
+    // Les signaux bloqués par la boucle d'événements ne concernent que le shell
+    sigemptyset(&empty_mask);
+    sigprocmask(SIG_SETMASK, &empty_mask, NULL);
+}
+
+int job_add_process(Job *job, pid_t pid, const char *name) {
+    if (job->num_procs == job->procs_cap) {
+        int new_cap = job->procs_cap ? job->procs_cap * 2 : 4;
+        JobProcess *procs = realloc(job->procs, new_cap * sizeof(JobProcess));
+        if (!procs) {
+            perror("realloc failed");
+            return -1;
+        }
+        job->procs = procs;
+        job->procs_cap = new_cap;
+    }
+    if (pid_entry_count >= pid_bucket_count && grow_pid_index() == -1) {
+        perror("calloc failed");
+        return -1;
+    }
+    PidEntry *entry = malloc(sizeof(PidEntry));
+    if (!entry) {
+        perror("malloc failed");
+        return -1;
+    }
+
+    if (job->pgid == 0) {
+        job->pgid = pid;
+    }
+    // Aussi fait dans l'enfant : le premier des deux gagne, sans course avec l'exec
+    if (job->own_group) {
+        setpgid(pid, job->pgid);
+    }
+
+    int proc = job->num_procs++;
+    JobProcess *process = &job->procs[proc];
+    memset(process, 0, sizeof(*process));
+    process->pid = pid;
+    strncpy(process->name, name ? name : "", sizeof(process->name) - 1);
+    process->state = PROCESS_RUNNING;
+    clock_gettime(CLOCK_MONOTONIC, &process->started);
+
+    size_t index = pid_slot(pid, pid_bucket_count);
+    entry->pid = pid;
+    entry->job = job;
+    entry->proc = proc;
+    entry->next = pid_buckets[index];
+    pid_buckets[index] = entry;
+    pid_entry_count++;
+    return 0;
+}
+
+int job_add_thread(Job *job, pthread_t thread, void *data) {
+    JobThread *entry = malloc(sizeof(JobThread));
+    if (!entry) {
+        perror("malloc failed");
+        return -1;
+    }
+    entry->thread = thread;
+    entry->owner = getpid();
+    entry->data = data;
+    entry->next = job->threads;
+    job->threads = entry;
+    return 0;
+}
+
+void remove_job(Job *job) {
+    while (job->threads) {
+        JobThread *entry = job->threads;
+        job->threads = entry->next;
+        if (entry->owner == getpid()) {
+            pthread_join(entry->thread, NULL);
+            free(entry->data);
+        }
+        free(entry);
+    }
+
+    for (int i = 0; i < job->num_procs; i++) {
+        PidEntry **link = &pid_buckets[pid_slot(job->procs[i].pid, pid_bucket_count)];
+        while (*link) {
+            if ((*link)->job == job) {
+                PidEntry *entry = *link;
+                *link = entry->next;
+                free(entry);
+                pid_entry_count--;
+                break;
             }
-            job_count--;
-            break;
+            link = &(*link)->next;
         }
     }
+
+    if (job->job_id) {
+        Job **link = &id_buckets[(size_t)job->job_id & (id_bucket_count - 1)];
+        while (*link && *link != job) {
+            link = &(*link)->id_next;
+        }
+        if (*link) {
+            *link = job->id_next;
+        }
+        if (job->prev) {
+            job->prev->next = job->next;
+        } else {
+            first_job = job->next;
+        }
+        if (job->next) {
+            job->next->prev = job->prev;
+        } else {
+            last_job = job->prev;
+        }
+        job_count--;
+    }
+
+    free(job->procs);
+    free(job->command);
+    free(job);
 }
 
-void list_jobs() {
-    for (int i = 0; i < job_count; i++) {
-        printf("[%d] %d %s %s\n",
-               jobs[i].job_id,
-               jobs[i].pid,
-               jobs[i].running ? "En cours d'exécution" : "Stoppé",
-               jobs[i].command);
+int wait_for_job(Job *job, JobProcess *results) {
+    int stopped = 0;
+
+    if (job->own_group && terminal_fd != -1) {
+        tcsetpgrp(terminal_fd, job->pgid);
+    }
+    job->foreground = 1;
+
+    for (int i = 0; i < job->num_procs && !stopped; i++) {
+        JobProcess *process = &job->procs[i];
+        while (process->state == PROCESS_RUNNING) {
+            int status;
+            struct rusage usage;
+            if (wait4(process->pid, &status, WUNTRACED, &usage) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("wait4 failed");
+                set_process_state(job, i, 127 << 8, NULL);
+            } else {
+                set_process_state(job, i, status, &usage);
+            }
+        }
+        stopped = (process->state == PROCESS_STOPPED);
+    }
+
+    if (job->own_group && terminal_fd != -1) {
+        tcsetpgrp(terminal_fd, shell_pgid);
+    }
+
+    if (results) {
+        for (int i = 0; i < job->num_procs; i++) {
+            results[i] = job->procs[i];
+            if (results[i].state != PROCESS_DONE) {
+                results[i].exit_status = 128 + SIGTSTP;
+            }
+        }
     }
+
+    update_job_state(job);
+    if (!job->done) {
+        // Les autres processus du groupe ont reçu le même SIGTSTP : la boucle
+        // d'événements récupérera leurs arrêts
+        job->running = 0;
+        job->foreground = 0;
+        if (!job->job_id && register_job(job) == -1) {
+            signal_job(job, SIGKILL);
+            remove_job(job);
+            return 128 + SIGKILL;
+        }
+        printf("\n[%d] Commande stoppée: %s\n", job->job_id, job->command);
+        return 128 + SIGTSTP;
+    }
+
+    int result = job->exit_status;
+    remove_job(job);
+    return result;
 }
 
-void bring_job_to_foreground(int job_id) {
-    for (int i = 0; i < job_count; i++) {
-        if (jobs[i].job_id == job_id) {
-            printf("Bringing job [%d] %s to foreground.\n", job_id, jobs[i].command);
-            kill(jobs[i].pid, SIGCONT);
-            waitpid(jobs[i].pid, NULL, 0);
-            remove_job(jobs[i].pid);
-            return;
+int wait_for_job_process(Job *job) {
+    int running = 0;
+    for (int i = 0; i < job->num_procs; i++) {
+        running += job->procs[i].state == PROCESS_RUNNING;
+    }
+    if (running == 0) {
+        return -1;
+    }
+
+    if (job->own_group && terminal_fd != -1) {
+        tcsetpgrp(terminal_fd, job->pgid);
+    }
+    job->foreground = 1;
+
+    for (;;) {
+        int status;
+        struct rusage usage;
+        // Seulement les enfants du thread appelant : une commande interne d'un pipeline
+        // peut attendre ses lots pendant que le shell attend les autres processus
+        pid_t pid = wait4(-1, &status, WUNTRACED | __WNOTHREAD, &usage);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("wait4 failed");
+            for (int i = 0; i < job->num_procs; i++) {
+                if (job->procs[i].state == PROCESS_RUNNING) {
+                    set_process_state(job, i, 127 << 8, NULL);
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        PidEntry *entry = find_pid(pid);
+        if (!entry) {
+            continue;
+        }
+        set_process_state(entry->job, entry->proc, status, &usage);
+        if (entry->job == job) {
+            return entry->proc;
         }
+        update_job_state(entry->job);
+    }
+}
+
+void put_job_in_background(Job *job) {
+    if (job->num_procs == 0 || register_job(job) == -1) {
+        remove_job(job);
+        return;
+    }
+    job->foreground = 0;
+    last_background_pid = job_display_pid(job);
+    printf("[%d] %d\n", job->job_id, job_display_pid(job));
+}
+
+void job_status_changed(pid_t pid, int status, const struct rusage *usage) {
+    PidEntry *entry = find_pid(pid);
+    if (!entry) {
+        return;
     }
-    fprintf(stderr, "Job [%d] not found.\n", job_id);
+    set_process_state(entry->job, entry->proc, status, usage);
+    update_job_state(entry->job);
 }
 
-void move_job_to_background(int job_id) {
-    for (int i = 0; i < job_count; i++) {
-        if (jobs[i].job_id == job_id) {
-            if (jobs[i].running) {
-                fprintf(stderr, "Job [%d] is already running in background.\n", job_id);
-                return;
+void notify_jobs(int print) {
+    Job *job = first_job;
+    while (job) {
+        Job *next = job->next;
+        if (job->done) {
+            if (print) {
+                printf("[%d] %d terminé avec status=%d\n", job->job_id, job_display_pid(job), job->exit_status);
             }
-            printf("Moving job [%d] %s to background.\n", job_id, jobs[i].command);
-            jobs[i].running = 1;
-            kill(jobs[i].pid, SIGCONT);
-            return;
+            remove_job(job);
         }
+        job = next;
+    }
+    if (print) {
+        fflush(stdout);
+    }
+}
+
+void list_jobs(int verbose) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (Job *job = first_job; job; job = job->next) {
+        printf("[%d] %d %s %s\n",
+               job->job_id,
+               job_display_pid(job),
+               job->done ? "Terminé" : (job->running ? "En cours d'exécution" : "Stoppé"),
+               job->command);
+        if (!verbose) {
+            continue;
+        }
+        for (int i = 0; i < job->num_procs; i++) {
+            const JobProcess *process = &job->procs[i];
+            if (process->state != PROCESS_DONE) {
+                printf("    %d %s : %s depuis %.3fs\n", process->pid, process->name,
+                       process->state == PROCESS_STOPPED ? "stoppé" : "en cours",
+                       elapsed_seconds(&process->started, &now));
+                continue;
+            }
+            StageUsage stage;
+            memset(&stage, 0, sizeof(stage));
+            stage.real = elapsed_seconds(&process->started, &process->finished);
+            stage.usage = process->usage;
+            printf("    %d %s (code %d) : ", process->pid, process->name, process->exit_status);
+            print_usage(stdout, &stage);
+        }
+    }
+}
+
+int bring_job_to_foreground(int job_id) {
+    Job *job = find_job(job_id);
+    if (!job) {
+        fprintf(stderr, "Job [%d] not found.\n", job_id);
+        return 1;
+    }
+
+    printf("Bringing job [%d] %s to foreground.\n", job->job_id, job->command);
+    fflush(stdout);
+
+    // Un job déjà récupéré par la boucle d'événements n'a plus rien à attendre
+    if (job->done) {
+        int result = job->exit_status;
+        remove_job(job);
+        return result;
+    }
+
+    // Donner le terminal avant de relancer, pour qu'une lecture ne provoque pas de SIGTTIN
+    if (job->own_group && terminal_fd != -1) {
+        tcsetpgrp(terminal_fd, job->pgid);
+    }
+    continue_job(job);
+    return wait_for_job(job, NULL);
+}
+
+int move_job_to_background(int job_id) {
+    Job *job = find_job(job_id);
+    if (!job) {
+        fprintf(stderr, "Job [%d] not found.\n", job_id);
+        return 1;
+    }
+    if (job->running) {
+        fprintf(stderr, "Job [%d] is already running in background.\n", job->job_id);
+        return 1;
     }
-    fprintf(stderr, "Job [%d] not found.\n", job_id);
+    printf("Moving job [%d] %s to background.\n", job->job_id, job->command);
+    continue_job(job);
+    return 0;
 }
@@ -0,0 +1,144 @@
+#include "../include/reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define READER_BUFFER_SIZE 65536
+#define READER_INITIAL_LINE 256
+
+
+int reader_init(LineReader *reader, int fd) {
+    reader->fd = fd;
+    reader->buf_len = 0;
+    reader->buf_pos = 0;
+    reader->buf_cap = READER_BUFFER_SIZE;
+    reader->line_cap = READER_INITIAL_LINE;
+    reader->eof = 0;
+    reader->wait_input = NULL;
+    reader->buf = malloc(reader->buf_cap);
+    reader->line = malloc(reader->line_cap);
+    if (!reader->buf || !reader->line) {
+        perror("malloc failed");
+        reader_free(reader);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Ajoute un fragment à la ligne courante en agrandissant son tampon si nécessaire.
+ *
+ * @param reader Lecteur.
+ * @param len Longueur actuelle de la ligne.
+ * @param data Fragment à ajouter.
+ * @param n Taille du fragment.
+ * @return int 0 si réussi, -1 en cas d'échec d'allocation.
+ */
+static int append_to_line(LineReader *reader, size_t len, const char *data, size_t n) {
+    if (len + n + 1 > reader->line_cap) {
+        size_t new_cap = reader->line_cap;
+        while (len + n + 1 > new_cap) {
+            new_cap *= 2;
+        }
+        char *temp = realloc(reader->line, new_cap);
+        if (!temp) {
+            perror("realloc failed");
+            return -1;
+        }
+        reader->line = temp;
+        reader->line_cap = new_cap;
+    }
+    memcpy(reader->line + len, data, n);
+    reader->line[len + n] = '\0';
+    return 0;
+}
+
+
+/**
+ * @brief Remplit le tampon de lecture.
+ *
+ * @param reader Lecteur.
+ * @return ssize_t Nombre d'octets lus, 0 à la fin de l'entrée, -1 en cas d'erreur,
+ *         READER_INTERRUPTED si l'attente a été interrompue.
+ */
+static ssize_t fill_buffer(LineReader *reader) {
+    ssize_t n;
+
+    if (reader->wait_input && !reader->wait_input(reader->fd)) {
+        return READER_INTERRUPTED;
+    }
+
+    do {
+        n = read(reader->fd, reader->buf, reader->buf_cap);
+    } while (n == -1 && errno == EINTR);
+
+    if (n == -1) {
+        perror("read error");
+        return -1;
+    }
+    reader->buf_len = (size_t)n;
+    reader->buf_pos = 0;
+    if (n == 0) {
+        reader->eof = 1;
+    }
+    return n;
+}
+
+
+ssize_t reader_getline(LineReader *reader, char **line) {
+    size_t len = 0;
+    int got_data = 0;
+
+    reader->line[0] = '\0';
+
+    while (1) {
+        if (reader->buf_pos >= reader->buf_len) {
+            if (reader->eof) {
+                break;
+            }
+            ssize_t n = fill_buffer(reader);
+            if (n == READER_INTERRUPTED) {
+                return READER_INTERRUPTED;
+            }
+            if (n <= 0) {
+                break;
+            }
+        }
+
+        char *start = reader->buf + reader->buf_pos;
+        size_t available = reader->buf_len - reader->buf_pos;
+        char *newline = memchr(start, '\n', available);
+        size_t chunk = newline ? (size_t)(newline - start) : available;
+
+        got_data = 1;
+        if (append_to_line(reader, len, start, chunk) == -1) {
+            return READER_EOF;
+        }
+        len += chunk;
+
+        if (newline) {
+            reader->buf_pos += chunk + 1;
+            *line = reader->line;
+            return (ssize_t)len;
+        }
+        reader->buf_pos = reader->buf_len;
+    }
+
+    // Dernière ligne sans '\n' final
+    if (got_data) {
+        *line = reader->line;
+        return (ssize_t)len;
+    }
+    return READER_EOF;
+}
+
+
+void reader_free(LineReader *reader) {
+    free(reader->buf);
+    free(reader->line);
+    reader->buf = NULL;
+    reader->line = NULL;
+}
@@ -1,183 +1,423 @@
+#define _GNU_SOURCE
 #include "../include/redirection.h"
+#include "../include/executor.h"
+#include "../include/expander.h"
+#include "../include/builtins.h"
+#include "../include/accounting.h"
+#include "../include/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/wait.h>
+#include <spawn.h>
+#include <pthread.h>
 
 
+int pipefail_enabled = 0;
+
+#define IN_SHELL_STAGE -2  ///< Étape exécutée dans le shell (commande interne en fin de pipeline).
+
+
+/**
+ * @brief Donne les options d'ouverture du fichier cible d'une redirection.
+ */
+static int redirection_flags(RedirectionType type) {
+    switch (type) {
+        case REDIR_INPUT:
+            return O_RDONLY;
+        case REDIR_APPEND:
+        case REDIR_ERROR_APPEND:
+        case REDIR_OUTPUT_ERROR_APPEND:
+            return O_WRONLY | O_CREAT | O_APPEND;
+        default:
+            return O_WRONLY | O_CREAT | O_TRUNC;
+    }
+}
+
+
+/**
+ * @brief Donne le descripteur remplacé par une redirection.
+ * 
+ * @param type Type de redirection.
+ * @param also_stderr Reçoit 1 si la sortie d'erreur doit aussi être redirigée (`>&`, `>>&`).
+ * @return int STDIN_FILENO, STDOUT_FILENO ou STDERR_FILENO.
+ */
+static int redirection_target_fd(RedirectionType type, int *also_stderr) {
+    *also_stderr = 0;
+    switch (type) {
+        case REDIR_INPUT:
+            return STDIN_FILENO;
+        case REDIR_ERROR:
+        case REDIR_ERROR_APPEND:
+            return STDERR_FILENO;
+        case REDIR_OUTPUT_ERROR:
+        case REDIR_OUTPUT_ERROR_APPEND:
+            *also_stderr = 1;
+            return STDOUT_FILENO;
+        default:
+            return STDOUT_FILENO;
+    }
+}
+
+
+/**
+ * @brief Sauvegarde un descripteur standard sur un numéro élevé, fermé à l'exec.
+ */
+int save_fd(int fd) {
+    return fcntl(fd, F_DUPFD_CLOEXEC, 10);
+}
+
+
+/**
+ * @brief Restaure un descripteur standard sauvegardé par save_fd.
+ */
+void restore_fd(int saved, int fd) {
+    if (saved != -1) {
+        dup2(saved, fd);
+        close(saved);
+    }
+}
+
 
 /**
- * @brief Gère les redirections d'entrée, de sortie et des erreurs standard dans une commande.
+ * @brief Gère les redirections d'entrée, de sortie et des erreurs standard d'une commande.
  * 
- * Cette fonction identifie et configure les redirections pour une commande, 
- * notamment les redirections de type `>`, `>>`, `<` et `2>`.
+ * Cette fonction applique, dans l'ordre de la ligne, les redirections de type
+ * `>`, `>>`, `<`, `2>`, `2>>`, `>&` et `>>&` analysées par le parser.
  * Elle modifie les descripteurs de fichiers en conséquence pour diriger 
  * les entrées/sorties vers les fichiers spécifiés.
  * 
- * @param command La commande contenant les instructions de redirection.
+ * @param arena Arène de la ligne en cours (pour retirer les guillemets des cibles).
+ * @param redirections Liste des redirections de la commande.
+ * @return int 0 si réussi, -1 si un fichier n'a pas pu être ouvert.
  */
-void handle_redirection(char *command) {
-    int fd;
-    
-    // Gestion de >& ou >>&
-    char *combined_redirect = strstr(command, ">>&");
-    if (combined_redirect) {
-        *combined_redirect = '\0'; 
-        combined_redirect += 3;   
-
-        while (*combined_redirect == ' ') combined_redirect++;
-
-        fd = open(combined_redirect, O_WRONLY | O_CREAT | O_APPEND, 0644);
+int apply_redirections(Arena *arena, const Redirection *redirections) {
+    for (const Redirection *redir = redirections; redir; redir = redir->next) {
+        const char *target = expand_word(arena, redir->target);
+        int also_stderr;
+        int target_fd = redirection_target_fd(redir->type, &also_stderr);
+
+        int fd = target ? open(target, redirection_flags(redir->type), 0644) : -1;
         if (fd == -1) {
             perror("open failed");
-            return;
+            return -1;
         }
 
-        dup2(fd, STDOUT_FILENO);
-        dup2(fd, STDERR_FILENO);
+        dup2(fd, target_fd);
+        if (also_stderr) {
+            dup2(fd, STDERR_FILENO);
+        }
         close(fd);
-        return;
     }
+    return 0;
+}
 
-    combined_redirect = strstr(command, ">&");
-    if (combined_redirect) {
-        *combined_redirect = '\0'; 
-        combined_redirect += 2; 
 
-        while (*combined_redirect == ' ') combined_redirect++;
+/**
+ * @brief Traduit les redirections d'une commande en actions posix_spawn.
+ * 
+ * Le fichier est ouvert directement sur le descripteur cible dans l'enfant,
+ * avant l'exec, exactement comme le ferait apply_redirections après un fork.
+ * 
+ * @param arena Arène de la ligne en cours.
+ * @param actions Actions de fichier à compléter.
+ * @param redirections Liste des redirections de la commande.
+ * @return int 0 si réussi, -1 en cas d'erreur.
+ */
+int add_redirection_actions(Arena *arena, posix_spawn_file_actions_t *actions, const Redirection *redirections) {
+    for (const Redirection *redir = redirections; redir; redir = redir->next) {
+        const char *target = expand_word(arena, redir->target);
+        int also_stderr;
+        int target_fd = redirection_target_fd(redir->type, &also_stderr);
 
-        fd = open(combined_redirect, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-        if (fd == -1) {
-            perror("open failed");
-            return;
+        if (!target ||
+            posix_spawn_file_actions_addopen(actions, target_fd, target, redirection_flags(redir->type), 0644) != 0) {
+            return -1;
+        }
+        if (also_stderr && posix_spawn_file_actions_adddup2(actions, STDOUT_FILENO, STDERR_FILENO) != 0) {
+            return -1;
         }
-
-        dup2(fd, STDOUT_FILENO);
-        dup2(fd, STDERR_FILENO);
-        close(fd);
-        return;
     }
+    return 0;
+}
 
-    // Gestion de 2> ou 2>> 
-    char *error_redirect = strstr(command, "2>");
-    if (error_redirect) {
-        int append = (*(error_redirect + 2) == '>'); 
-        *error_redirect = '\0'; 
-        error_redirect += append ? 3 : 2;
-
-        while (*error_redirect == ' ') error_redirect++;
 
-        fd = open(error_redirect, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
-        if (fd == -1) {
-            perror("open failed");
-            return;
-        }
-        dup2(fd, STDERR_FILENO);
-        close(fd);
+/**
+ * @brief Convertit un statut renvoyé par waitpid en code de retour du shell.
+ *
+ * @param status Statut brut renvoyé par waitpid.
+ * @return int Le code de sortie, ou 128 + numéro du signal si le processus a été tué.
+ */
+int status_to_exit_code(int status) {
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
     }
+    return 1;
+}
+
 
-    // Gestion de > ou >>
-    char *output_redirect = strstr(command, ">");
-    if (output_redirect && *(output_redirect - 1) != '2') {
-        int append = (*(output_redirect + 1) == '>');
-        *output_redirect = '\0'; 
-        output_redirect += append ? 2 : 1;
+/**
+ * @brief Commande interne exécutée dans un thread d'un pipeline.
+ *
+ * Alloué sur le tas avec une copie des arguments : si le job est stoppé, le
+ * thread lui est confié et peut survivre à l'arène de la ligne.
+ */
+typedef struct {
+    const Builtin *builtin;
+    int argc;
+    char **argv;
+    FILE *out;        ///< Extrémité d'écriture du pipe, fermée à la fin du thread.
+    int status;
+    StageUsage usage; ///< Ressources consommées par le thread.
+    pthread_t thread;
+} BuiltinThread;
 
-        while (*output_redirect == ' ') output_redirect++;
 
-        fd = open(output_redirect, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
-        if (fd == -1) {
-            perror("open failed");
-            return;
-        }
-        dup2(fd, STDOUT_FILENO);
-        close(fd);
-    }
+static void *builtin_thread_main(void *arg) {
+    BuiltinThread *job = arg;
+    long long span = trace_begin();
+    stage_usage_begin(&job->usage, job->argv[0]);
+    job->status = job->builtin->handler(job->argc, job->argv, job->out);
+    stage_usage_end(&job->usage, job->status);
+    trace_end(span, "builtin", job->argv[0], NULL);
+    // Fermer le pipe signale EOF à l'étape suivante
+    fclose(job->out);
+    return NULL;
+}
 
-    
-    char *input_redirect = strstr(command, "<");
-    if (input_redirect) {
-        *input_redirect = '\0'; 
-        input_redirect++;
 
-        while (*input_redirect == ' ') input_redirect++;
+/**
+ * @brief Lance une commande interne dans un thread qui écrit dans le pipe.
+ * 
+ * @return BuiltinThread* Le thread lancé (à libérer après pthread_join), ou `NULL`
+ *         en cas d'échec (le descripteur est alors fermé).
+ */
+static BuiltinThread *start_builtin_thread(const Builtin *builtin, int argc, char **argv, int out_fd) {
+    size_t size = sizeof(BuiltinThread) + (argc + 1) * sizeof(char *);
+    for (int i = 0; i < argc; i++) {
+        size += strlen(argv[i]) + 1;
+    }
+    BuiltinThread *job = malloc(size);
+    FILE *out = job ? fdopen(out_fd, "w") : NULL;
+    if (!out) {
+        perror(job ? "fdopen failed" : "malloc failed");
+        close(out_fd);
+        free(job);
+        return NULL;
+    }
 
-        fd = open(input_redirect, O_RDONLY);
-        if (fd == -1) {
-            perror("open failed");
-            return;
-        }
-        dup2(fd, STDIN_FILENO);
-        close(fd);
+    job->builtin = builtin;
+    job->argc = argc;
+    job->argv = (char **)(job + 1);
+    char *strings = (char *)(job->argv + argc + 1);
+    for (int i = 0; i < argc; i++) {
+        job->argv[i] = strcpy(strings, argv[i]);
+        strings += strlen(argv[i]) + 1;
+    }
+    job->argv[argc] = NULL;
+    job->out = out;
+    job->status = 0;
+    if (pthread_create(&job->thread, NULL, builtin_thread_main, job) != 0) {
+        perror("pthread_create failed");
+        fclose(out);
+        free(job);
+        return NULL;
     }
+    return job;
 }
 
 
-
 /**
  * @brief Gère l'exécution de commandes en pipeline.
  * 
- * Cette fonction divise une commande en plusieurs sous-commandes 
- * reliées par des pipes (`|`). Chaque sous-commande est exécutée dans 
- * un processus enfant, et les entrées/sorties sont chaînées 
- * via des descripteurs de pipe.
+ * Cette fonction lance chaque étape d'un pipeline analysé, les étapes étant reliées
+ * par des pipes (`|`). Les arguments sont étendus dans le shell avant le lancement.
+ * Toutes les étapes sont lancées avant d'attendre la moindre d'entre elles, afin
+ * qu'elles s'exécutent en parallèle : un producteur qui remplit le tampon du pipe
+ * n'est jamais bloqué faute de consommateur. Les processus forment un seul job,
+ * dans un même groupe de processus, attendu comme un tout.
+ * 
+ * Au premier plan, les commandes internes qui n'écrivent que dans leur flux de sortie
+ * (`myls`, `myps`) ne sont pas forkées : au milieu du pipeline elles tournent dans un
+ * thread qui écrit dans le pipe, et en dernière position elles s'exécutent dans le
+ * shell une fois les autres étapes lancées. En arrière-plan, toutes les étapes sont
+ * des processus du job. Si le job est stoppé (Ctrl+Z), ses threads lui sont confiés
+ * et joints quand il se termine ou est tué, pour ne pas bloquer le shell.
  * 
- * @param command La commande complète avec des sous-commandes séparées par `|`.
- * @return int Le code de retour de la commande (0 en cas de succès, 1 sinon).
+ * @param arena Arène de la ligne en cours.
+ * @param stages Les commandes simples du pipeline, dans l'ordre.
+ * @param num_commands Nombre d'étapes.
+ * @param text Texte source du pipeline, utilisé pour la liste des jobs.
+ * @param background 1 pour lancer le pipeline en arrière-plan sans l'attendre.
+ * @return int Le code de retour de la dernière étape, ou celui de la dernière
+ *         étape en échec si le mode pipefail est actif (0 en arrière-plan).
  */
-int handle_pipeline(char *command) {
-    char *commands[10];
-    int num_commands = 0;
-
-    
-    char *token = strtok(command, "|");
-    while (token != NULL && num_commands < 10) {
-        commands[num_commands++] = token;
-        token = strtok(NULL, "|");
+int handle_pipeline(Arena *arena, const SimpleCommand *stages, int num_commands,
+                    const char *text, int background) {
+    int *procs = arena_alloc(arena, num_commands * sizeof(int));
+    BuiltinThread **threads = arena_alloc(arena, num_commands * sizeof(BuiltinThread *));
+    int *codes = arena_alloc(arena, num_commands * sizeof(int));
+    StageUsage *builtin_usage = arena_alloc(arena, num_commands * sizeof(StageUsage));
+    Job *job = job_create(text, !background);
+    if (!procs || !threads || !codes || !builtin_usage || !job) {
+        if (job) {
+            remove_job(job);
+        }
+        return 1;
     }
 
-    int pipefd[2], in_fd = 0;
-    pid_t pid;
+    int pipefd[2], in_fd = STDIN_FILENO;
+    int launched = 0;
+    long long pipeline_span = trace_begin();
+
+    fflush(stdout);
 
     for (int i = 0; i < num_commands; i++) {
-        if (pipe(pipefd) == -1) {
+        int is_last = (i == num_commands - 1);
+
+        // O_CLOEXEC : seules les copies placées sur 0 et 1 par dup2 survivent à l'exec
+        if (!is_last && pipe2(pipefd, O_CLOEXEC) == -1) {
             perror("pipe failed");
-            return 1;
+            break;
+        }
+
+        int argc = 0;
+        char **args = expand_arguments(arena, &stages[i], &argc);
+        const Builtin *builtin = (args && argc > 0 && !background) ? find_builtin(args[0], strlen(args[0])) : NULL;
+        int output_taken = 0;
+        int in_shell = 0;
+
+        procs[i] = -1;
+        threads[i] = NULL;
+        codes[i] = 127;
+
+        if (builtin && (builtin->flags & BUILTIN_PIPEABLE) && is_last) {
+            // Exécutée plus bas, dans le shell, une fois toutes les étapes lancées
+            in_shell = 1;
+        } else if (builtin && (builtin->flags & BUILTIN_PIPEABLE) && !stages[i].redirections) {
+            threads[i] = start_builtin_thread(builtin, argc, args, pipefd[1]);
+            output_taken = 1;
+        } else if (args) {
+            int index = job->num_procs;
+            if (launch_command(arena, argc, args, stages[i].redirections,
+                               in_fd, is_last ? STDOUT_FILENO : pipefd[1],
+                               is_last ? -1 : pipefd[0], job) > 0) {
+                procs[i] = index;
+            }
+        }
+
+        // Le parent ferme ses copies pour que chaque lecteur voie EOF à la fin de l'écrivain.
+        // Une étape qui n'a pas pu être lancée compte comme un échec, les autres continuent.
+        launched++;
+        if (in_fd != STDIN_FILENO) {
+            close(in_fd);
+        }
+        if (!is_last) {
+            if (!output_taken) {
+                close(pipefd[1]);
+            }
+            in_fd = pipefd[0];
         }
 
-        if ((pid = fork()) == -1) {
-            perror("fork failed");
+        if (in_shell) {
+            long long span = trace_begin();
+            stage_usage_begin(&builtin_usage[i], args[0]);
+            codes[i] = run_builtin(builtin, argc, args, arena, stages[i].redirections);
+            stage_usage_end(&builtin_usage[i], codes[i]);
+            trace_end(span, "builtin", args[0], NULL);
+            procs[i] = IN_SHELL_STAGE;
+        }
+    }
+
+    if (in_fd != STDIN_FILENO) {
+        close(in_fd);
+    }
+
+    if (background) {
+        put_job_in_background(job);
+        trace_end(pipeline_span, "shell", "pipeline", text);
+        return 0;
+    }
+
+    JobProcess *results = NULL;
+    int stopped = 0;
+    long long wait_span = trace_begin();
+    if (job->num_procs > 0) {
+        results = arena_alloc(arena, job->num_procs * sizeof(JobProcess));
+        if (!results) {
+            // Sans relevé des processus : les threads sont joints avec le job
+            for (int i = 0; i < launched; i++) {
+                if (threads[i] && job_add_thread(job, threads[i]->thread, threads[i]) == 0) {
+                    threads[i] = NULL;
+                }
+            }
+            wait_for_job(job, NULL);
+            for (int i = 0; i < launched; i++) {
+                if (threads[i]) {
+                    pthread_join(threads[i]->thread, NULL);
+                    free(threads[i]);
+                }
+            }
             return 1;
+        } else {
+            int num_procs = job->num_procs;
+            wait_for_job(job, results);
+            for (int i = 0; i < num_procs; i++) {
+                stopped |= results[i].state != PROCESS_DONE;
+            }
         }
+    } else {
+        remove_job(job);
+    }
+    trace_end(wait_span, "process", "wait", text);
 
-        if (pid == 0) { 
-            dup2(in_fd, STDIN_FILENO);
-            if (i < num_commands - 1) {
-                dup2(pipefd[1], STDOUT_FILENO);
+    if (stopped) {
+        // Job stoppé : un thread peut être bloqué sur un pipe dont le lecteur est
+        // stoppé, il est joint quand le job se termine ou est tué
+        for (int i = 0; i < launched; i++) {
+            if (threads[i] && job_add_thread(job, threads[i]->thread, threads[i]) == -1) {
+                pthread_join(threads[i]->thread, NULL);
+                free(threads[i]);
             }
-            close(pipefd[0]);
-            handle_redirection(commands[i]);
-
-            char *args[100];
-            int j = 0;
-            char *arg = strtok(commands[i], " ");
-            while (arg != NULL) {
-                args[j++] = arg;
-                arg = strtok(NULL, " ");
+        }
+        trace_end(pipeline_span, "shell", "pipeline", text);
+        return 128 + SIGTSTP;
+    }
+
+    // Relevé des ressources dans l'ordre des étapes, pour `time` et `status -v`
+    int result = (launched == num_commands) ? 0 : 1;
+    int last_failure = 0;
+    for (int i = 0; i < launched; i++) {
+        if (threads[i]) {
+            pthread_join(threads[i]->thread, NULL);
+            codes[i] = threads[i]->status;
+            accounting_add(&threads[i]->usage);
+            free(threads[i]);
+        } else if (procs[i] == IN_SHELL_STAGE) {
+            accounting_add(&builtin_usage[i]);
+        } else if (procs[i] >= 0) {
+            codes[i] = results[procs[i]].exit_status;
+            if (results[procs[i]].state == PROCESS_DONE) {
+                accounting_add_process(&results[procs[i]]);
             }
-            args[j] = NULL;
-
-            execvp(args[0], args);
-            perror("execvp failed");
-            exit(1);
-        } else { 
-            wait(NULL);
-            close(pipefd[1]);
-            in_fd = pipefd[0]; 
+        }
+        if (codes[i] != 0) {
+            last_failure = codes[i];
+        }
+        if (i == num_commands - 1) {
+            result = codes[i];
         }
     }
 
-    return 0;
+    if (pipefail_enabled && last_failure != 0) {
+        result = last_failure;
+    }
+
+    trace_end(pipeline_span, "shell", "pipeline", text);
+    return result;
 }
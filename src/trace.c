@@ -0,0 +1,244 @@
+#define _GNU_SOURCE
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#define TRACE_BUFFER_SIZE (64 * 1024)
+
+
+int trace_enabled = 0;
+
+static int trace_fd = -1;
+static char *buffer = NULL;
+static size_t buffer_len = 0;
+static int first_event = 1;
+static long long origin_us = 0;
+static pid_t shell_pid = 0;
+static int exit_hook_installed = 0;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * @brief Convertit un instant en microsecondes.
+ */
+static long long timespec_us(const struct timespec *ts) {
+    return (long long)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+
+/**
+ * @brief Horloge monotone en microsecondes.
+ */
+static long long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_us(&ts);
+}
+
+
+/**
+ * @brief Écrit le tampon dans le fichier de trace.
+ */
+static void flush_buffer() {
+    size_t written = 0;
+    while (written < buffer_len) {
+        ssize_t n = write(trace_fd, buffer + written, buffer_len - written);
+        if (n <= 0) {
+            break;
+        }
+        written += n;
+    }
+    buffer_len = 0;
+}
+
+
+/**
+ * @brief Ajoute des octets au tampon, vidé dans le fichier quand il est plein.
+ */
+static void append(const char *data, size_t len) {
+    if (buffer_len + len > TRACE_BUFFER_SIZE) {
+        flush_buffer();
+    }
+    if (len > TRACE_BUFFER_SIZE) {
+        if (write(trace_fd, data, len) == -1) {
+            perror("trace write failed");
+        }
+        return;
+    }
+    memcpy(buffer + buffer_len, data, len);
+    buffer_len += len;
+}
+
+
+/**
+ * @brief Ajoute une chaîne telle quelle (fragment JSON déjà formé).
+ */
+static void append_literal(const char *text) {
+    append(text, strlen(text));
+}
+
+
+/**
+ * @brief Ajoute une chaîne JSON (avec guillemets), en échappant les caractères spéciaux.
+ */
+static void append_string(const char *str) {
+    char escape[8];
+
+    append_literal("\"");
+    const char *run = str;
+    for (const char *s = str; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+        append(run, s - run);
+        snprintf(escape, sizeof(escape), c == '"' || c == '\\' ? "\\%c" : "\\u%04x", c);
+        append(escape, strlen(escape));
+        run = s + 1;
+    }
+    append(run, strlen(run));
+    append_literal("\"");
+}
+
+
+/**
+ * @brief Écrit un événement complet ("ph":"X") ; appelée sous trace_lock.
+ */
+static void append_event(const char *category, const char *name, long long start, long long duration,
+                         int tid, const char *detail) {
+    char numbers[128];
+
+    append_literal(first_event ? "" : ",\n");
+    first_event = 0;
+
+    append_literal("{\"name\":");
+    append_string(name);
+    append_literal(",\"cat\":");
+    append_string(category);
+    int len = snprintf(numbers, sizeof(numbers), ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d",
+                       start - origin_us, duration, (int)shell_pid, tid);
+    append(numbers, len);
+    if (detail) {
+        append_literal(",\"args\":{\"detail\":");
+        append_string(detail);
+        append_literal("}");
+    }
+    append_literal("}");
+}
+
+
+/**
+ * @brief Nomme une piste dans le visualiseur (événement de métadonnées "M").
+ */
+static void append_thread_name(int tid, const char *name) {
+    char header[128];
+
+    append_literal(first_event ? "" : ",\n");
+    first_event = 0;
+
+    int len = snprintf(header, sizeof(header), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                       (int)shell_pid, tid);
+    append(header, len);
+    append_string(name);
+    append_literal("}}");
+}
+
+
+int trace_start(const char *path) {
+    trace_stop();
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        perror(path);
+        return -1;
+    }
+    buffer = malloc(TRACE_BUFFER_SIZE);
+    if (!buffer) {
+        perror("malloc failed");
+        close(fd);
+        return -1;
+    }
+
+    // `exit` quitte sans repasser par la boucle principale : la trace doit être terminée quand même
+    if (!exit_hook_installed) {
+        atexit(trace_stop);
+        exit_hook_installed = 1;
+    }
+
+    trace_fd = fd;
+    buffer_len = 0;
+    first_event = 1;
+    origin_us = now_us();
+    shell_pid = getpid();
+
+    append_literal("[\n");
+    append_thread_name(shell_pid, "mysh");
+    trace_enabled = 1;
+    return 0;
+}
+
+void trace_stop() {
+    if (!trace_enabled) {
+        return;
+    }
+    pthread_mutex_lock(&trace_lock);
+    trace_enabled = 0;
+    append_literal("\n]\n");
+    flush_buffer();
+    close(trace_fd);
+    trace_fd = -1;
+    free(buffer);
+    buffer = NULL;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void trace_drop_in_child() {
+    if (!trace_enabled) {
+        return;
+    }
+    trace_enabled = 0;
+    close(trace_fd);
+    trace_fd = -1;
+    free(buffer);
+    buffer = NULL;
+    buffer_len = 0;
+}
+
+long long trace_begin() {
+    return trace_enabled ? now_us() : 0;
+}
+
+void trace_end(long long start, const char *category, const char *name, const char *detail) {
+    if (!trace_enabled || start == 0) {
+        return;
+    }
+    long long end = now_us();
+
+    pthread_mutex_lock(&trace_lock);
+    if (trace_enabled) {
+        append_event(category, name, start, end - start, (int)gettid(), detail);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void trace_process(pid_t pid, const char *name, const struct timespec *started,
+                   const struct timespec *finished, int exit_status) {
+    char detail[32];
+
+    if (!trace_enabled) {
+        return;
+    }
+    long long start = timespec_us(started);
+    snprintf(detail, sizeof(detail), "code %d", exit_status);
+
+    pthread_mutex_lock(&trace_lock);
+    if (trace_enabled) {
+        append_thread_name(pid, name);
+        append_event("exec", name, start, timespec_us(finished) - start, pid, detail);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
@@ -1,63 +1,606 @@
+#define _GNU_SOURCE
 #include "../include/variable.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/shm.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <pthread.h>
 
+extern char **environ;
 
-typedef struct LocalVariable {
-    char name[64];
-    char value[256];
-    struct LocalVariable *next;
+
+#define LOCAL_TABLE_INITIAL_SIZE 64
+
+#define SLOT_EMPTY 0    ///< Case jamais utilisée : fin d'une suite de sondage.
+#define SLOT_USED 1     ///< Case occupée par une variable.
+#define SLOT_DELETED 2  ///< Variable supprimée : la suite de sondage continue.
+
+/**
+ * @brief Variable locale : nom et valeur alloués sur le tas, longueurs mémorisées.
+ */
+typedef struct {
+    char *name;
+    size_t name_len;
+    char *value;
+    size_t value_len;
+    size_t value_cap;
+    unsigned int hash;
+    int state;
 } LocalVariable;
 
-LocalVariable *local_vars = NULL;
+static LocalVariable *local_table = NULL;
+static size_t local_capacity = 0;
+static size_t local_count = 0;      ///< Cases SLOT_USED.
+static size_t local_deleted = 0;    ///< Cases SLOT_DELETED.
+
+
+/**
+ * @brief Fonction de hachage FNV-1a sur un nom de longueur donnée.
+ */
+static unsigned int hash_name(const char *name, size_t len) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+/*
+ * Variables d'environnement : segment POSIX nommé (shm_open + mmap), partagé
+ * par toutes les instances de mysh qui ouvrent le même nom. Disposition :
+ *
+ *   [EnvHeader][index : bucket_count offsets][données : EnvEntry...]
+ *
+ * L'index est une table à adressage ouvert d'offsets vers les entrées. Une
+ * entrée remplacée ou supprimée reste dans la zone de données jusqu'au prochain
+ * compactage, fait quand la zone ou l'index est plein ; le segment grandit alors
+ * (ftruncate) et les autres instances le remappent à leur prochain accès.
+ *
+ * Les variables héritées (environ) ne sont pas copiées dans le segment : celles
+ * du segment les complètent ou les remplacent, et la suppression d'une variable
+ * y laisse une entrée « supprimée » qui masque la variable héritée du même nom.
+ *
+ * Les écrivains se sérialisent sur un mutex partagé entre processus (robuste : un
+ * shell tué en pleine écriture ne bloque pas les autres). Les lecteurs ne prennent
+ * aucun verrou : un compteur de séquence (seqlock), impair pendant une écriture,
+ * leur indique qu'ils doivent recommencer leur lecture.
+ */
+#define ENV_MAGIC 0x6d797368u               ///< "mysh" : le segment est initialisé.
+#define ENV_INITIAL_SIZE (64 * 1024)
+#define ENV_INITIAL_BUCKETS 256
+#define ENV_HEADER_SIZE 128                  ///< sizeof(EnvHeader) arrondi, début de l'index.
+#define ENV_BUCKET_EMPTY 0                   ///< Case jamais utilisée.
+#define ENV_BUCKET_DELETED 1                 ///< Entrée supprimée : la suite de sondage continue.
+#define ENV_READ_SPINS 128                   ///< Écriture en cours vue par un lecteur avant qu'il prenne le verrou.
+
+/**
+ * @brief En-tête du segment partagé.
+ */
+typedef struct {
+    _Atomic uint32_t magic;         ///< ENV_MAGIC une fois l'en-tête initialisé.
+    _Atomic uint32_t seq;           ///< Compteur de séquence, impair pendant une écriture.
+    _Atomic uint64_t size;          ///< Taille du segment ; les autres instances remappent si elle a grandi.
+    _Atomic uint64_t generation;    ///< Incrémenté à chaque modification.
+    uint32_t attached;              ///< Instances attachées ; la dernière supprime le nom.
+    uint32_t bucket_count;          ///< Taille de l'index (puissance de 2).
+    uint32_t entry_count;           ///< Entrées de l'index, variables supprimées comprises.
+    uint32_t deleted_count;         ///< Cases ENV_BUCKET_DELETED.
+    uint64_t data_start;            ///< Début de la zone de données.
+    uint64_t data_used;             ///< Octets occupés dans la zone de données.
+    pthread_mutex_t lock;           ///< Verrou des écrivains (PTHREAD_PROCESS_SHARED).
+} EnvHeader;
+
+/**
+ * @brief Entrée du segment : "nom=valeur\0", longueurs mémorisées.
+ */
+typedef struct {
+    uint32_t hash;
+    uint32_t name_len;
+    uint32_t value_len;
+    uint32_t unset;                 ///< 1 : variable supprimée (valeur vide), masque la variable héritée.
+    char text[];
+} EnvEntry;
+
+_Static_assert(sizeof(EnvHeader) <= ENV_HEADER_SIZE, "EnvHeader trop grand");
+
+static EnvHeader *env_header = NULL;
+static size_t env_mapped = 0;       ///< Taille de la projection dans ce processus.
+static int env_fd = -1;
+static char env_name[256];
+static pid_t env_owner = 0;         ///< Processus qui s'est attaché (pas ses enfants forkés).
+static char *read_buffer = NULL;    ///< Copie de la dernière valeur lue dans le segment.
+static size_t read_buffer_cap = 0;
+
+static char **env_cache = NULL;             ///< envp transmis aux commandes.
+static char *env_cache_strings = NULL;      ///< Copie des variables du segment pointées par env_cache.
+static uint64_t env_cache_generation = 0;   ///< Génération du segment lors de la construction.
+
+
+/**
+ * @brief Projette le segment sur `size` octets (ou agrandit la projection existante).
+ */
+static int map_env_segment(size_t size) {
+    void *addr;
+    if (env_header) {
+        addr = mremap(env_header, env_mapped, size, MREMAP_MAYMOVE);
+    } else {
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, env_fd, 0);
+    }
+    if (addr == MAP_FAILED) {
+        perror("mmap failed");
+        return -1;
+    }
+    env_header = addr;
+    env_mapped = size;
+    return 0;
+}
+
+
+/**
+ * @brief Suit le segment s'il a été agrandi par une autre instance.
+ */
+static int refresh_env_mapping() {
+    size_t size = atomic_load_explicit(&env_header->size, memory_order_acquire);
+    return size > env_mapped ? map_env_segment(size) : 0;
+}
+
+
+/**
+ * @brief Taille d'une entrée dans la zone de données, alignée sur 8 octets.
+ */
+static size_t env_entry_size(size_t name_len, size_t value_len) {
+    return (sizeof(EnvEntry) + name_len + value_len + 2 + 7) & ~(size_t)7;
+}
+
+
+/**
+ * @brief Index du segment.
+ */
+static uint64_t *env_buckets() {
+    return (uint64_t *)((char *)env_header + ENV_HEADER_SIZE);
+}
+
+
+/**
+ * @brief Entrée à un offset donné, ou `NULL` si elle sort de la projection.
+ *
+ * Un lecteur peut voir un état incohérent pendant une écriture : tout ce qui est
+ * lu dans le segment est vérifié avant d'être suivi, le seqlock fait le reste.
+ */
+static EnvEntry *env_entry_at(uint64_t offset) {
+    if (offset < ENV_HEADER_SIZE || offset + sizeof(EnvEntry) > env_mapped) {
+        return NULL;
+    }
+    EnvEntry *entry = (EnvEntry *)((char *)env_header + offset);
+    if ((uint64_t)entry->name_len + entry->value_len + 2 > env_mapped - offset - sizeof(EnvEntry)) {
+        return NULL;
+    }
+    return entry;
+}
+
+
+/**
+ * @brief Cherche une variable dans l'index.
+ *
+ * @param slot_out Reçoit la case de la variable, ou la première case libre de la
+ *        suite de sondage si elle n'existe pas (peut être `NULL`).
+ * @return EnvEntry* L'entrée, ou `NULL` si la variable n'existe pas.
+ */
+static EnvEntry *find_env(const char *name, size_t len, uint32_t hash, uint64_t **slot_out) {
+    uint32_t count = env_header->bucket_count;
+    if (count == 0 || (count & (count - 1)) || ENV_HEADER_SIZE + (uint64_t)count * 8 > env_mapped) {
+        return NULL;
+    }
+    uint64_t *buckets = env_buckets();
+    uint64_t *free_slot = NULL;
+    uint32_t slot = hash & (count - 1);
+
+    for (uint32_t probes = 0; probes < count; probes++, slot = (slot + 1) & (count - 1)) {
+        uint64_t offset = buckets[slot];
+        if (offset == ENV_BUCKET_EMPTY) {
+            if (!free_slot) {
+                free_slot = &buckets[slot];
+            }
+            break;
+        }
+        if (offset == ENV_BUCKET_DELETED) {
+            if (!free_slot) {
+                free_slot = &buckets[slot];
+            }
+            continue;
+        }
+        EnvEntry *entry = env_entry_at(offset);
+        if (entry && entry->hash == hash && entry->name_len == len && memcmp(entry->text, name, len) == 0) {
+            if (slot_out) {
+                *slot_out = &buckets[slot];
+            }
+            return entry;
+        }
+    }
+    if (slot_out) {
+        *slot_out = free_slot;
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Prend le verrou des écrivains ; si son détenteur est mort, remet la
+ * séquence à une valeur paire.
+ */
+static void lock_env_segment() {
+    int err = pthread_mutex_lock(&env_header->lock);
+    if (err == EOWNERDEAD) {
+        // L'instance précédente est morte en pleine écriture : le compactage suivant repart des entrées lisibles
+        pthread_mutex_consistent(&env_header->lock);
+        if (atomic_load_explicit(&env_header->seq, memory_order_relaxed) & 1) {
+            atomic_fetch_add_explicit(&env_header->seq, 1, memory_order_release);
+        }
+    }
+}
+
+
+/**
+ * @brief Prend le verrou des écrivains et ouvre une écriture (séquence impaire).
+ */
+static void begin_env_write() {
+    lock_env_segment();
+    refresh_env_mapping();
+    atomic_fetch_add_explicit(&env_header->seq, 1, memory_order_acq_rel);
+}
+
+
+/**
+ * @brief Publie l'écriture (séquence paire) et rend le verrou.
+ *
+ * @param changed 1 si une variable a été modifiée.
+ */
+static void end_env_write(int changed) {
+    if (changed) {
+        atomic_fetch_add_explicit(&env_header->generation, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&env_header->seq, 1, memory_order_release);
+    pthread_mutex_unlock(&env_header->lock);
+}
+
+
+/**
+ * @brief Copie une entrée à la fin de la zone de données (appelée par un écrivain).
+ *
+ * @return uint64_t Offset de la nouvelle entrée.
+ */
+static uint64_t append_env_entry(uint32_t hash, const char *name, size_t name_len,
+                                 const char *value, size_t value_len, uint32_t unset) {
+    uint64_t offset = env_header->data_start + env_header->data_used;
+    EnvEntry *entry = (EnvEntry *)((char *)env_header + offset);
+    entry->hash = hash;
+    entry->name_len = name_len;
+    entry->value_len = value_len;
+    entry->unset = unset;
+    memcpy(entry->text, name, name_len);
+    entry->text[name_len] = '=';
+    memcpy(entry->text + name_len + 1, value, value_len);
+    entry->text[name_len + 1 + value_len] = '\0';
+    env_header->data_used += env_entry_size(name_len, value_len);
+    return offset;
+}
+
+
+/**
+ * @brief Indique si une variable fait partie de l'environnement hérité.
+ */
+static int is_inherited(const char *name, size_t len) {
+    for (char **entry = environ; *entry; entry++) {
+        if (strncmp(*entry, name, len) == 0 && (*entry)[len] == '=') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Entrée d'une case à garder au compactage, ou `NULL` : une entrée
+ * « supprimée » n'a d'utilité que si elle masque une variable héritée.
+ */
+static EnvEntry *kept_env_entry(uint64_t offset) {
+    EnvEntry *entry = offset > ENV_BUCKET_DELETED ? env_entry_at(offset) : NULL;
+    if (entry && entry->unset && !is_inherited(entry->text, entry->name_len)) {
+        return NULL;
+    }
+    return entry;
+}
+
+
+/**
+ * @brief Compacte le segment en gardant les entrées vivantes (et celles qui
+ * masquent une variable héritée), en l'agrandissant
+ * pour que `extra` octets et une entrée de plus y tiennent (appelée par un écrivain).
+ */
+static int compact_env_segment(size_t extra) {
+    uint32_t old_count = env_header->bucket_count;
+    uint64_t *buckets = env_buckets();
+    size_t live_bytes = 0;
+
+    for (uint32_t i = 0; i < old_count; i++) {
+        EnvEntry *entry = kept_env_entry(buckets[i]);
+        if (entry) {
+            live_bytes += env_entry_size(entry->name_len, entry->value_len);
+        }
+    }
+
+    char *saved = malloc(live_bytes ? live_bytes : 1);
+    if (!saved) {
+        perror("malloc failed");
+        return -1;
+    }
+    size_t saved_len = 0;
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < old_count; i++) {
+        EnvEntry *entry = kept_env_entry(buckets[i]);
+        if (entry) {
+            size_t size = env_entry_size(entry->name_len, entry->value_len);
+            memcpy(saved + saved_len, entry, size);
+            saved_len += size;
+            live++;
+        }
+    }
+
+    // Index rempli au plus à moitié, zone de données au plus à moitié après l'ajout
+    uint32_t bucket_count = ENV_INITIAL_BUCKETS;
+    while ((uint64_t)(live + 1) * 2 > bucket_count) {
+        bucket_count *= 2;
+    }
+    uint64_t data_start = ENV_HEADER_SIZE + (uint64_t)bucket_count * 8;
+    uint64_t size = atomic_load_explicit(&env_header->size, memory_order_relaxed);
+    while (size < data_start + 2 * (saved_len + extra)) {
+        size *= 2;
+    }
+    if (size > env_mapped) {
+        if (ftruncate(env_fd, size) == -1) {
+            perror("ftruncate failed");
+            free(saved);
+            return -1;
+        }
+        if (map_env_segment(size) == -1) {
+            free(saved);
+            return -1;
+        }
+        atomic_store_explicit(&env_header->size, size, memory_order_release);
+    }
+
+    env_header->bucket_count = bucket_count;
+    env_header->data_start = data_start;
+    env_header->data_used = 0;
+    env_header->deleted_count = 0;
+    buckets = env_buckets();
+    memset(buckets, 0, (size_t)bucket_count * 8);
+
+    for (size_t pos = 0; pos < saved_len; ) {
+        EnvEntry *entry = (EnvEntry *)(saved + pos);
+        uint32_t slot = entry->hash & (bucket_count - 1);
+        while (buckets[slot] != ENV_BUCKET_EMPTY) {
+            slot = (slot + 1) & (bucket_count - 1);
+        }
+        buckets[slot] = append_env_entry(entry->hash, entry->text, entry->name_len,
+                                         entry->text + entry->name_len + 1, entry->value_len, entry->unset);
+        pos += env_entry_size(entry->name_len, entry->value_len);
+    }
+    env_header->entry_count = live;
+    free(saved);
+    return 0;
+}
+
+
+/**
+ * @brief Crée l'en-tête d'un segment neuf.
+ */
+static int init_env_header() {
+    if (ftruncate(env_fd, ENV_INITIAL_SIZE) == -1) {
+        perror("ftruncate failed");
+        return -1;
+    }
+    if (map_env_segment(ENV_INITIAL_SIZE) == -1) {
+        return -1;
+    }
 
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&env_header->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
 
-#define SHM_KEY 12345
-#define SHM_SIZE 4096
-char *shared_memory = NULL;
-int shm_id;
-pthread_mutex_t shm_mutex = PTHREAD_MUTEX_INITIALIZER;
+    env_header->bucket_count = ENV_INITIAL_BUCKETS;
+    env_header->data_start = ENV_HEADER_SIZE + ENV_INITIAL_BUCKETS * 8;
+    atomic_store_explicit(&env_header->size, ENV_INITIAL_SIZE, memory_order_relaxed);
+    atomic_store_explicit(&env_header->magic, ENV_MAGIC, memory_order_release);
+    return 0;
+}
 
 
 /**
- * @brief Initialise la mémoire partagée pour stocker les variables d'environnement.
+ * @brief Attend qu'une autre instance ait fini d'initialiser le segment, puis le projette.
+ */
+static int attach_env_header() {
+    struct stat st;
+
+    for (int tries = 0; ; tries++) {
+        if (fstat(env_fd, &st) == -1) {
+            perror("fstat failed");
+            return -1;
+        }
+        if ((size_t)st.st_size >= ENV_HEADER_SIZE) {
+            if (!env_header && map_env_segment(ENV_HEADER_SIZE) == -1) {
+                return -1;
+            }
+            if (atomic_load_explicit(&env_header->magic, memory_order_acquire) == ENV_MAGIC) {
+                return refresh_env_mapping();
+            }
+        }
+        if (tries == 1000) {
+            fprintf(stderr, "%s: shared environment segment is not initialized.\n", env_name);
+            return -1;
+        }
+        usleep(1000);
+    }
+}
+
+
+/**
+ * @brief Attache le shell au segment partagé des variables d'environnement.
  * 
- * Cette fonction crée un segment de mémoire partagée avec une taille prédéfinie
- * et initialise son contenu à zéro. Elle est utilisée pour gérer les variables
- * d'environnement entre différents processus.
+ * Le segment s'appelle `/mysh-env-<uid>` : les instances d'un même utilisateur
+ * partagent leurs variables, celles d'utilisateurs différents ne se gênent pas.
+ * La variable d'environnement `MYSH_ENV_SEGMENT` (un nom commençant par '/')
+ * permet de choisir un autre groupe d'instances. Le segment est créé par la
+ * première instance et supprimé par la dernière qui s'en détache.
  */
 void init_shared_memory() {
-    shm_id = shmget(SHM_KEY, SHM_SIZE, IPC_CREAT | 0666);
-    if (shm_id < 0) {
-        perror("shmget failed");
+    const char *name = getenv("MYSH_ENV_SEGMENT");
+    if (name && name[0] == '/' && strlen(name) < sizeof(env_name)) {
+        strcpy(env_name, name);
+    } else {
+        snprintf(env_name, sizeof(env_name), "/mysh-env-%u", (unsigned)getuid());
+    }
+
+    int created = 1;
+    env_fd = shm_open(env_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (env_fd == -1 && errno == EEXIST) {
+        created = 0;
+        env_fd = shm_open(env_name, O_RDWR, 0600);
+    }
+    if (env_fd == -1) {
+        perror("shm_open failed");
         exit(1);
     }
-    shared_memory = (char *)shmat(shm_id, NULL, 0);
-    if (shared_memory == (char *)-1) {
-        perror("shmat failed");
+    if ((created ? init_env_header() : attach_env_header()) == -1) {
+        if (created) {
+            shm_unlink(env_name);
+        }
         exit(1);
     }
-    memset(shared_memory, 0, SHM_SIZE);
+
+    begin_env_write();
+    env_header->attached++;
+    end_env_write(0);
+
+    // `exit` quitte sans repasser par main : l'instance doit quand même se détacher
+    env_owner = getpid();
+    atexit(destroy_shared_memory);
 }
 
 
 /**
- * @brief Détruit la mémoire partagée utilisée pour les variables d'environnement.
+ * @brief Détache le shell du segment partagé.
  * 
- * Cette fonction détache le segment de mémoire partagée du processus actuel
- * et le marque pour suppression.
+ * La dernière instance attachée supprime le nom du segment. Sans effet dans un
+ * enfant forké, qui n'a pas été compté parmi les instances.
  */
 void destroy_shared_memory() {
-    if (shmdt(shared_memory) == -1) {
-        perror("shmdt failed");
+    if (!env_header || getpid() != env_owner) {
+        return;
     }
-    if (shmctl(shm_id, IPC_RMID, NULL) == -1) {
-        perror("shmctl failed");
+    begin_env_write();
+    if (--env_header->attached == 0 && shm_unlink(env_name) == -1) {
+        perror("shm_unlink failed");
     }
+    end_env_write(0);
+
+    munmap(env_header, env_mapped);
+    close(env_fd);
+    env_header = NULL;
+    env_mapped = 0;
+    env_fd = -1;
+    free(read_buffer);
+    read_buffer = NULL;
+    read_buffer_cap = 0;
+    free(env_cache);
+    free(env_cache_strings);
+    env_cache = NULL;
+    env_cache_strings = NULL;
+}
+
+
+/**
+ * @brief Cherche la case d'une variable (sondage linéaire).
+ * 
+ * @return LocalVariable* La case occupée par la variable, ou `NULL` si elle n'existe pas.
+ */
+static LocalVariable *find_local(const char *name, size_t len, unsigned int hash) {
+    if (!local_capacity) {
+        return NULL;
+    }
+    size_t slot = hash & (local_capacity - 1);
+    while (local_table[slot].state != SLOT_EMPTY) {
+        LocalVariable *var = &local_table[slot];
+        if (var->state == SLOT_USED && var->hash == hash && var->name_len == len &&
+            memcmp(var->name, name, len) == 0) {
+            return var;
+        }
+        slot = (slot + 1) & (local_capacity - 1);
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Reconstruit la table avec la capacité donnée, en oubliant les cases supprimées.
+ */
+static int resize_local_table(size_t capacity) {
+    LocalVariable *table = calloc(capacity, sizeof(LocalVariable));
+    if (!table) {
+        perror("calloc failed");
+        return -1;
+    }
+    for (size_t i = 0; i < local_capacity; i++) {
+        if (local_table[i].state != SLOT_USED) {
+            continue;
+        }
+        size_t slot = local_table[i].hash & (capacity - 1);
+        while (table[slot].state != SLOT_EMPTY) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = local_table[i];
+    }
+    free(local_table);
+    local_table = table;
+    local_capacity = capacity;
+    local_deleted = 0;
+    return 0;
+}
+
+
+/**
+ * @brief Copie une valeur dans une variable, en agrandissant son tampon si besoin.
+ */
+static int store_value(LocalVariable *var, const char *value, size_t len) {
+    if (len + 1 > var->value_cap) {
+        size_t cap = var->value_cap ? var->value_cap : 16;
+        while (cap < len + 1) {
+            cap *= 2;
+        }
+        char *buffer = realloc(var->value, cap);
+        if (!buffer) {
+            perror("realloc failed");
+            return -1;
+        }
+        var->value = buffer;
+        var->value_cap = cap;
+    }
+    memcpy(var->value, value, len);
+    var->value[len] = '\0';
+    var->value_len = len;
+    return 0;
 }
 
 
@@ -65,50 +608,74 @@ void destroy_shared_memory() {
  * @brief Définit une variable locale avec un nom et une valeur.
  * 
  * Cette fonction ajoute une nouvelle variable locale ou met à jour la valeur
- * d'une variable existante. Les noms et les valeurs ont des longueurs maximales
- * définies pour éviter les dépassements de mémoire.
+ * d'une variable existante. Les variables sont rangées dans une table de hachage
+ * à adressage ouvert : recherche, ajout et suppression en temps constant. Les
+ * valeurs n'ont pas de longueur maximale ; le tampon d'une variable est réutilisé
+ * tant que la nouvelle valeur y tient.
  * 
  * @param name Le nom de la variable locale.
  * @param value La valeur de la variable locale.
  */
 void set_local_variable(const char *name, const char *value) {
-    
-    if (!name || !value || strlen(name) == 0 || strlen(value) == 0 || strlen(name) >= 64 || strlen(value) >= 256) {
+    if (!name || !value || name[0] == '\0' || value[0] == '\0') {
         fprintf(stderr, "Error: Invalid name or value for local variable.\n");
         return;
     }
 
-    LocalVariable *current = local_vars;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            strncpy(current->value, value, sizeof(current->value) - 1);
-            current->value[sizeof(current->value) - 1] = '\0';
+    size_t name_len = strlen(name);
+    size_t value_len = strlen(value);
+    unsigned int hash = hash_name(name, name_len);
+
+    LocalVariable *var = find_local(name, name_len, hash);
+    if (var) {
+        store_value(var, value, value_len);
+        return;
+    }
+
+    // Charge maximale 3/4, cases supprimées comprises (elles allongent les sondages)
+    if ((local_count + local_deleted + 1) * 4 > local_capacity * 3) {
+        size_t capacity = local_capacity ? local_capacity : LOCAL_TABLE_INITIAL_SIZE;
+        if ((local_count + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+        if (resize_local_table(capacity) == -1) {
             return;
         }
-        current = current->next;
     }
 
-    LocalVariable *new_var = malloc(sizeof(LocalVariable));
-    if (!new_var) {
-        perror("malloc failed");
-        return;
+    size_t slot = hash & (local_capacity - 1);
+    while (local_table[slot].state == SLOT_USED) {
+        slot = (slot + 1) & (local_capacity - 1);
+    }
+    var = &local_table[slot];
+    if (var->state == SLOT_DELETED) {
+        local_deleted--;
     }
 
-    memset(new_var, 0, sizeof(LocalVariable));
-    strncpy(new_var->name, name, sizeof(new_var->name) - 1);
-    new_var->name[sizeof(new_var->name) - 1] = '\0';
-    strncpy(new_var->value, value, sizeof(new_var->value) - 1);
-    new_var->value[sizeof(new_var->value) - 1] = '\0';
-    new_var->next = local_vars;
-    local_vars = new_var;
+    memset(var, 0, sizeof(*var));
+    var->name = strndup(name, name_len);
+    if (!var->name || store_value(var, value, value_len) == -1) {
+        if (!var->name) {
+            perror("strndup failed");
+        }
+        free(var->name);
+        memset(var, 0, sizeof(*var));
+        var->state = SLOT_DELETED;
+        local_deleted++;
+        return;
+    }
+    var->name_len = name_len;
+    var->hash = hash;
+    var->state = SLOT_USED;
+    local_count++;
 }
 
 
 /**
  * @brief Supprime une variable locale existante.
  * 
- * Cette fonction recherche et supprime une variable locale par son nom.
- * Si la variable n'est pas trouvée, un message d'erreur est affiché.
+ * La case est marquée comme supprimée pour ne pas couper les suites de sondage
+ * des autres variables. Si la variable n'est pas trouvée, un message d'erreur est affiché.
  * 
  * @param name Le nom de la variable locale à supprimer.
  */
@@ -118,71 +685,94 @@ void unset_local_variable(const char *name) {
         return;
     }
 
-    LocalVariable **current = &local_vars;
-    while (*current) {
-        if (strcmp((*current)->name, name) == 0) {
-            LocalVariable *to_delete = *current;
-            *current = (*current)->next; 
-            free(to_delete);
-            return;
-        }
-        current = &((*current)->next);
+    size_t len = strlen(name);
+    LocalVariable *var = find_local(name, len, hash_name(name, len));
+    if (!var) {
+        fprintf(stderr, "Error: Variable %s not found.\n", name);
+        return;
     }
 
-    fprintf(stderr, "Error: Variable %s not found.\n", name);
+    free(var->name);
+    free(var->value);
+    memset(var, 0, sizeof(*var));
+    var->state = SLOT_DELETED;
+    local_count--;
+    local_deleted++;
 }
 
 
 /**
  * @brief Affiche toutes les variables locales et leurs valeurs.
  * 
- * Parcourt la liste des variables locales et imprime leurs noms et valeurs
+ * Parcourt la table des variables locales et imprime leurs noms et valeurs
  * au format `nom=valeur`.
  */
 void list_local_variables() {
-    LocalVariable *current = local_vars;
-    while (current) {
-        printf("%s=%s\n", current->name, current->value);
-        current = current->next;
+    for (size_t i = 0; i < local_capacity; i++) {
+        if (local_table[i].state == SLOT_USED) {
+            printf("%s=%s\n", local_table[i].name, local_table[i].value);
+        }
+    }
+}
+
+/**
+ * @brief Ajoute ou remplace l'entrée d'une variable (appelée par un écrivain).
+ *
+ * @param unset 1 pour une entrée « supprimée » (valeur vide).
+ * @return int 0 si réussi, -1 si le segment n'a pas pu être compacté.
+ */
+static int put_env_entry(const char *name, size_t name_len, const char *value, size_t value_len,
+                         uint32_t unset) {
+    uint32_t hash = hash_name(name, name_len);
+    size_t needed = env_entry_size(name_len, value_len);
+
+    uint64_t *slot;
+    EnvEntry *entry = find_env(name, name_len, hash, &slot);
+    int full = env_header->data_start + env_header->data_used + needed > env_mapped;
+    int crowded = !entry && (env_header->entry_count + env_header->deleted_count + 1) * 4 > env_header->bucket_count * 3;
+    if (full || crowded || !slot) {
+        if (compact_env_segment(needed) == -1) {
+            return -1;
+        }
+        entry = find_env(name, name_len, hash, &slot);
+    }
+
+    if (!entry) {
+        if (*slot == ENV_BUCKET_DELETED) {
+            env_header->deleted_count--;
+        }
+        env_header->entry_count++;
     }
+    *slot = append_env_entry(hash, name, name_len, value, value_len, unset);
+    return 0;
 }
 
+
 /**
  * @brief Définit une variable d'environnement dans la mémoire partagée.
  * 
- * Cette fonction ajoute ou met à jour une variable d'environnement dans la mémoire partagée.
- * Si la mémoire est pleine ou non initialisée, elle affiche un message d'erreur.
+ * Cette fonction ajoute ou remplace une variable d'environnement dans le segment
+ * partagé, qui grandit si nécessaire. La modification est visible immédiatement
+ * par toutes les instances attachées au segment.
  * 
  * @param name Le nom de la variable d'environnement.
  * @param value La valeur de la variable d'environnement.
  */
 void set_env_variable(const char *name, const char *value) {
-    if (!shared_memory) {
+    if (!env_header) {
         fprintf(stderr, "Shared memory not initialized.\n");
         return;
     }
 
-    if (!name || !value || strlen(name) == 0 || strlen(value) == 0 || strlen(name) >= 64 || strlen(value) >= 256) {
+    if (!name || !value || name[0] == '\0' || value[0] == '\0' || strchr(name, '=') ||
+        strlen(name) > UINT32_MAX / 2 || strlen(value) > UINT32_MAX / 2) {
         fprintf(stderr, "Error: Invalid name or value for environment variable.\n");
         return;
     }
 
-    pthread_mutex_lock(&shm_mutex);
-
-    char *current = shared_memory;
-    while (*current && current < shared_memory + SHM_SIZE - 256) {
-        current += strlen(current) + 1;
-    }
-
-    if (current >= shared_memory + SHM_SIZE - 256) {
-        fprintf(stderr, "Shared memory is full.\n");
-        pthread_mutex_unlock(&shm_mutex);
-        return;
-    }
-
-    snprintf(current, 256, "%s=%s", name, value);
-
-    pthread_mutex_unlock(&shm_mutex);
+    begin_env_write();
+    int changed = put_env_entry(name, strlen(name), value, strlen(value), 0) == 0;
+    end_env_write(changed);
 }
 
 
@@ -190,13 +780,15 @@ void set_env_variable(const char *name, const char *value) {
 /**
  * @brief Supprime une variable d'environnement de la mémoire partagée.
  * 
- * Cette fonction recherche une variable d'environnement dans la mémoire partagée
- * et la supprime si elle existe.
+ * Cette fonction supprime une variable définie dans la mémoire partagée ou
+ * héritée du processus parent. Son entrée est remplacée par une entrée
+ * « supprimée », qui empêche la variable héritée du même nom d'être transmise
+ * aux commandes lancées par toutes les instances.
  * 
  * @param name Le nom de la variable d'environnement à supprimer.
  */
 void unset_env_variable(const char *name) {
-    if (!shared_memory) {
+    if (!env_header) {
         fprintf(stderr, "Shared memory not initialized.\n");
         return;
     }
@@ -206,27 +798,118 @@ void unset_env_variable(const char *name) {
         return;
     }
 
-    pthread_mutex_lock(&shm_mutex);
+    size_t len = strlen(name);
 
-    char *current = shared_memory;
-    int found = 0;
-    while (*current) {
-        if (strncmp(current, name, strlen(name)) == 0 && current[strlen(name)] == '=') {
-            char *next = current + strlen(current) + 1;
-            memmove(current, next, shared_memory + SHM_SIZE - next);
-            found = 1;
-            break;
-        }
-        current += strlen(current) + 1;
-    }
-
-    pthread_mutex_unlock(&shm_mutex);
+    begin_env_write();
+    EnvEntry *entry = find_env(name, len, hash_name(name, len), NULL);
+    int found = entry ? !entry->unset : is_inherited(name, len);
+    int changed = found && put_env_entry(name, len, "", 0, 1) == 0;
+    end_env_write(changed);
 
     if (!found) {
         fprintf(stderr, "Error: Environment variable %s not found.\n", name);
     }
 }
 
+
+/**
+ * @brief Agrandit le tampon de lecture pour `size` octets.
+ */
+static int reserve_read_buffer(size_t size) {
+    if (size <= read_buffer_cap) {
+        return 0;
+    }
+    size_t cap = read_buffer_cap ? read_buffer_cap : 256;
+    while (cap < size) {
+        cap *= 2;
+    }
+    char *buffer = realloc(read_buffer, cap);
+    if (!buffer) {
+        perror("realloc failed");
+        return -1;
+    }
+    read_buffer = buffer;
+    read_buffer_cap = cap;
+    return 0;
+}
+
+
+/**
+ * @brief Copie de façon cohérente les variables du segment dans le tampon de lecture.
+ *
+ * Sans verrou : la copie est recommencée si un écrivain est passé entre-temps.
+ * Une écriture qui dure (écrivain mort en cours de route) fait prendre le verrou
+ * une fois, ce qui attend l'écrivain ou répare la séquence.
+ *
+ * @param name Variable à copier (valeur seule), ou `NULL` pour copier toutes
+ *        les variables à la suite, sous la forme "nom=valeur\0" ("nom\0" pour
+ *        une variable supprimée).
+ * @param len Longueur du nom.
+ * @param out_len Reçoit la longueur copiée.
+ * @return int 1 si quelque chose a été copié, 0 si la variable n'existe pas, -1 en cas d'erreur.
+ */
+static int read_env_snapshot(const char *name, size_t len, size_t *out_len) {
+    uint32_t hash = name ? hash_name(name, len) : 0;
+    int spins = 0;
+
+    for (;;) {
+        if (refresh_env_mapping() == -1) {
+            return -1;
+        }
+        uint32_t seq = atomic_load_explicit(&env_header->seq, memory_order_acquire);
+        if (seq & 1) {
+            if (++spins < ENV_READ_SPINS) {
+                sched_yield();
+            } else {
+                lock_env_segment();
+                pthread_mutex_unlock(&env_header->lock);
+                spins = 0;
+            }
+            continue;
+        }
+
+        int found = 0;
+        size_t copied = 0;
+        if (name) {
+            EnvEntry *entry = find_env(name, len, hash, NULL);
+            if (entry && !entry->unset && reserve_read_buffer(entry->value_len + 1) == 0) {
+                memcpy(read_buffer, entry->text + entry->name_len + 1, entry->value_len);
+                copied = entry->value_len;
+                found = 1;
+            }
+        } else {
+            uint32_t count = env_header->bucket_count;
+            uint64_t *buckets = env_buckets();
+            found = reserve_read_buffer(1) == 0;
+            for (uint32_t i = 0; i < count && ENV_HEADER_SIZE + (uint64_t)count * 8 <= env_mapped; i++) {
+                EnvEntry *entry = buckets[i] > ENV_BUCKET_DELETED ? env_entry_at(buckets[i]) : NULL;
+                if (!entry) {
+                    continue;
+                }
+                size_t size = entry->unset ? entry->name_len + 1 : entry->name_len + entry->value_len + 2;
+                if (reserve_read_buffer(copied + size + 1) == -1) {
+                    found = 0;
+                    break;
+                }
+                memcpy(read_buffer + copied, entry->text, size);
+                read_buffer[copied + size - 1] = '\0';
+                copied += size;
+            }
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&env_header->seq, memory_order_relaxed) != seq) {
+            continue;
+        }
+        if (found) {
+            read_buffer[copied] = '\0';
+            *out_len = copied;
+        }
+        return found;
+    }
+}
+
+
 /**
  * @brief Affiche toutes les variables d'environnement stockées dans la mémoire partagée.
  * 
@@ -234,43 +917,214 @@ void unset_env_variable(const char *name) {
  * `nom=valeur`.
  */
 void list_env_variables() {
-    char *current = shared_memory;
-    while (*current) {
-        printf("%s\n", current);
-        current += strlen(current) + 1;
+    size_t len;
+    if (env_header && read_env_snapshot(NULL, 0, &len) == 1) {
+        for (size_t pos = 0; pos < len; pos += strlen(read_buffer + pos) + 1) {
+            if (strchr(read_buffer + pos, '=')) {
+                printf("%s\n", read_buffer + pos);
+            }
+        }
     }
 }
 
+
+/**
+ * @brief Longueur du nom d'une chaîne "nom=valeur".
+ */
+static size_t env_name_length(const char *entry) {
+    const char *equal = strchr(entry, '=');
+    return equal ? (size_t)(equal - entry) : strlen(entry);
+}
+
+
+/**
+ * @brief Reconstruit le tableau envp : environnement hérité, complété et remplacé
+ * par les variables du segment partagé, sans les variables supprimées.
+ */
+static int build_environment() {
+    size_t len;
+    int result = read_env_snapshot(NULL, 0, &len);
+    if (result == -1) {
+        return -1;
+    }
+    if (result == 0) {
+        len = 0;
+    }
+
+    size_t shared_count = 0;
+    for (size_t pos = 0; pos < len; pos += strlen(read_buffer + pos) + 1) {
+        shared_count++;
+    }
+    size_t inherited_count = 0;
+    while (environ[inherited_count]) {
+        inherited_count++;
+    }
+
+    char *strings = malloc(len ? len : 1);
+    char **envp = malloc((inherited_count + shared_count + 1) * sizeof(char *));
+    // Index des noms du segment, pour écarter en temps constant les variables héritées qu'ils remplacent ou masquent
+    size_t index_size = 16;
+    while (index_size < shared_count * 2) {
+        index_size *= 2;
+    }
+    char **index = calloc(index_size, sizeof(char *));
+    if (!strings || !envp || !index) {
+        perror("malloc failed");
+        free(strings);
+        free(envp);
+        free(index);
+        return -1;
+    }
+    memcpy(strings, read_buffer, len);
+
+    size_t count = 0;
+    char **shared = envp + inherited_count;
+    for (size_t pos = 0; pos < len; pos += strlen(strings + pos) + 1) {
+        char *entry = strings + pos;
+        size_t name_len = env_name_length(entry);
+        size_t slot = hash_name(entry, name_len) & (index_size - 1);
+        while (index[slot]) {
+            slot = (slot + 1) & (index_size - 1);
+        }
+        index[slot] = entry;
+        if (entry[name_len] == '=') {
+            shared[count++] = entry;
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < inherited_count; i++) {
+        size_t name_len = env_name_length(environ[i]);
+        size_t slot = hash_name(environ[i], name_len) & (index_size - 1);
+        int replaced = 0;
+        while (index[slot] && !replaced) {
+            replaced = env_name_length(index[slot]) == name_len && memcmp(index[slot], environ[i], name_len) == 0;
+            slot = (slot + 1) & (index_size - 1);
+        }
+        if (!replaced) {
+            envp[kept++] = environ[i];
+        }
+    }
+    memmove(envp + kept, shared, count * sizeof(char *));
+    envp[kept + count] = NULL;
+    free(index);
+
+    free(env_cache);
+    free(env_cache_strings);
+    env_cache = envp;
+    env_cache_strings = strings;
+    return 0;
+}
+
+
+/**
+ * @brief Environnement à transmettre aux commandes lancées (execve, posix_spawn).
+ * 
+ * Le tableau est mis en cache et n'est reconstruit que lorsque le compteur de
+ * génération du segment partagé indique qu'une variable a été définie ou supprimée
+ * (par ce shell ou par une autre instance) depuis la dernière construction.
+ * 
+ * @return char** Tableau "nom=valeur" terminé par `NULL`, valable jusqu'au prochain appel.
+ */
+char **get_environment() {
+    if (!env_header) {
+        return environ;
+    }
+    uint64_t generation = atomic_load_explicit(&env_header->generation, memory_order_acquire);
+    if (env_cache && generation == env_cache_generation) {
+        return env_cache;
+    }
+    if (build_environment() == -1) {
+        return env_cache ? env_cache : environ;
+    }
+    // Une modification pendant la construction laisse une génération plus ancienne : le prochain appel reconstruit
+    env_cache_generation = generation;
+    return env_cache;
+}
+
+
+/**
+ * @brief Valeur d'une variable (nom de longueur donnée) dans l'environnement
+ * transmis aux commandes.
+ */
+static const char *environment_value_n(const char *name, size_t len) {
+    for (char **entry = get_environment(); *entry; entry++) {
+        if (strncmp(*entry, name, len) == 0 && (*entry)[len] == '=') {
+            return *entry + len + 1;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Valeur d'une variable dans l'environnement transmis aux commandes.
+ * 
+ * @param name Nom de la variable.
+ * @return const char* La valeur, ou `NULL` si la variable n'est pas définie.
+ */
+const char *get_environment_value(const char *name) {
+    return environment_value_n(name, strlen(name));
+}
+
 /**
  * @brief Récupère la valeur d'une variable locale ou d'environnement.
  * 
- * Cette fonction recherche d'abord la variable dans la liste des variables locales,
- * puis dans les variables d'environnement stockées dans la mémoire partagée.
+ * Cette fonction recherche d'abord la variable dans la table des variables locales,
+ * puis dans les variables d'environnement stockées dans la mémoire partagée, et
+ * enfin dans l'environnement hérité, sauf si la variable y a été supprimée : la
+ * substitution voit le même environnement que les commandes lancées.
+ * Le nom n'a pas besoin d'être terminé par '\0', ce qui évite de le copier
+ * lors de la substitution.
+ *
+ * La valeur d'une variable d'environnement est une copie, valable jusqu'à la
+ * lecture suivante : une autre instance peut modifier le segment entre-temps.
  * 
  * @param name Le nom de la variable à rechercher.
+ * @param name_len Longueur du nom.
+ * @param value_len Reçoit la longueur de la valeur (peut être `NULL`).
  * @return char* La valeur de la variable ou `NULL` si elle n'est pas trouvée.
  */
-char *get_variable_value(const char *name) {
-    if (!name || strlen(name) == 0) {
+char *get_variable_value_n(const char *name, size_t name_len, size_t *value_len) {
+    if (!name || name_len == 0) {
         return NULL;
     }
 
-    
-    LocalVariable *current = local_vars;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return current->value;
+    LocalVariable *var = find_local(name, name_len, hash_name(name, name_len));
+    if (var) {
+        if (value_len) {
+            *value_len = var->value_len;
         }
-        current = current->next;
+        return var->value;
     }
 
-    char *current_env = shared_memory;
-    while (*current_env) {
-        if (strncmp(current_env, name, strlen(name)) == 0 && current_env[strlen(name)] == '=') {
-            return current_env + strlen(name) + 1;
+    size_t len;
+    int found = env_header ? read_env_snapshot(name, name_len, &len) : 0;
+    if (found == 1) {
+        if (value_len) {
+            *value_len = len;
         }
-        current_env += strlen(current_env) + 1;
+        return read_buffer;
+    }
+    if (found == -1) {
+        return NULL;
     }
 
-    return NULL;
+    // Variable héritée : l'envp en cache écarte déjà celles qui ont été supprimées
+    const char *value = environment_value_n(name, name_len);
+    if (value && value_len) {
+        *value_len = strlen(value);
+    }
+    return (char *)value;
+}
+
+
+/**
+ * @brief Récupère la valeur d'une variable locale ou d'environnement.
+ * 
+ * @param name Le nom de la variable à rechercher.
+ * @return char* La valeur de la variable ou `NULL` si elle n'est pas trouvée.
+ */
+char *get_variable_value(const char *name) {
+    return name ? get_variable_value_n(name, strlen(name), NULL) : NULL;
 }
@@ -1,120 +1,885 @@
+#define _GNU_SOURCE
 #include "../include/wildcard.h"
+#include "../include/trace.h"
+#include "../include/dir_cache.h"
 #include <stdio.h>
 #include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
-#include <fnmatch.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define GLOB_MAX_TOKENS 1023
+#define GLOB_MAX_THREADS 8
+#define GLOB_DIRENT_BUFFER (64 * 1024)  ///< Taille d'un lot de getdents64.
 
 
 /**
- * @brief Vérifie si un caractère à une position donnée dans une chaîne est échappé.
- * 
- * Cette fonction détermine si un caractère dans une chaîne est précédé d'un caractère 
- * d'échappement (`\`) et ne doit donc pas être interprété comme un caractère spécial.
- * 
- * @param pattern La chaîne de caractères à vérifier.
- * @param index L'index du caractère à analyser.
- * @return bool Retourne `true` si le caractère est échappé, sinon `false`.
+ * @brief Reconnaît une classe POSIX `[:nom:]` à l'intérieur d'une classe.
+ *
+ * @return size_t Longueur de `[:nom:]`, ou 0 si ce n'en est pas une.
  */
-bool is_escaped(const char *pattern, int index) {
-    return (index > 0 && pattern[index - 1] == '\\');
+static size_t posix_class(const char *s, size_t len, int (**predicate)(int)) {
+    static const struct { const char *name; int (*predicate)(int); } classes[] = {
+        { "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank }, { "cntrl", iscntrl },
+        { "digit", isdigit }, { "graph", isgraph }, { "lower", islower }, { "print", isprint },
+        { "punct", ispunct }, { "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit },
+    };
+    if (len < 4 || s[0] != '[' || s[1] != ':') {
+        return 0;
+    }
+    const char *end = memchr(s + 2, ':', len - 2);
+    if (!end || end + 1 >= s + len || end[1] != ']') {
+        return 0;
+    }
+    size_t name_len = end - (s + 2);
+    for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++) {
+        if (strlen(classes[i].name) == name_len && memcmp(classes[i].name, s + 2, name_len) == 0) {
+            *predicate = classes[i].predicate;
+            return end + 2 - s;
+        }
+    }
+    return 0;
 }
 
 
 /**
- * @brief Étend un motif contenant des jokers (`*`, `?`, etc.) en une liste de correspondances.
- * 
- * Cette fonction analyse un motif contenant des caractères spéciaux (jokers) et recherche 
- * tous les fichiers ou répertoires correspondants dans le chemin spécifié. Les résultats
- * sont retournés sous forme de tableau de chaînes.
- * 
- * @param pattern Le motif contenant des jokers à étendre.
- * @param num_matches Un pointeur vers un entier pour stocker le nombre de correspondances trouvées.
- * @return char** Un tableau de chaînes contenant les chemins des fichiers correspondants.
- *         Retourne `NULL` si une erreur survient ou si aucune correspondance n'est trouvée.
- * 
- * @note L'utilisateur est responsable de libérer la mémoire des chaînes dans le tableau retourné.
+ * @brief Lit une classe `[...]` et l'ajoute à l'ensemble des octets acceptés.
+ *
+ * `[!...]` et `[^...]` inversent la classe ; un `]` placé en premier ou échappé
+ * (`\]`) est littéral. Les intervalles (`a-z`) et les classes POSIX (`[:digit:]`)
+ * sont reconnus.
+ *
+ * @return size_t Longueur de la classe crochets compris, ou 0 si elle n'est pas
+ *         fermée (le `[` est alors un caractère ordinaire).
  */
-char **expand_wildcard(const char *pattern, int *num_matches) {
-    
-    const char *last_slash = strrchr(pattern, '/');
-    char dir_path[1024] = ".";
-    const char *search_pattern = pattern;
-
-    if (last_slash) {
-        size_t dir_len = last_slash - pattern;
-        if (dir_len >= sizeof(dir_path)) {
-            fprintf(stderr, "Directory path is too long.\n");
-            return NULL;
+static size_t parse_class(const char *pattern, size_t len, uint64_t accept[4]) {
+    size_t i = 1;
+    bool negate = i < len && (pattern[i] == '!' || pattern[i] == '^');
+    if (negate) {
+        i++;
+    }
+    memset(accept, 0, 4 * sizeof(uint64_t));
+
+    size_t first = i;
+    while (i < len && (pattern[i] != ']' || i == first)) {
+        int (*predicate)(int);
+        size_t used = posix_class(pattern + i, len - i, &predicate);
+        if (used > 0) {
+            for (int c = 1; c < 256; c++) {
+                if (predicate(c)) {
+                    accept[c / 64] |= 1ULL << (c % 64);
+                }
+            }
+            i += used;
+            continue;
+        }
+
+        if (pattern[i] == '\\' && i + 1 < len) {
+            i++;
         }
-        strncpy(dir_path, pattern, dir_len);
-        dir_path[dir_len] = '\0';
-        search_pattern = last_slash + 1;
+        unsigned char low = pattern[i], high = low;
+        if (i + 2 < len && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            i += 2;
+            if (pattern[i] == '\\' && i + 1 < len) {
+                i++;
+            }
+            high = pattern[i];
+        }
+        for (unsigned int c = low; c <= high; c++) {
+            accept[c / 64] |= 1ULL << (c % 64);
+        }
+        i++;
+    }
+    if (i >= len) {
+        return 0;
     }
 
-    DIR *dir = opendir(dir_path);
-    if (!dir) {
-        perror("opendir failed");
-        return NULL;
+    if (negate) {
+        for (int w = 0; w < 4; w++) {
+            accept[w] = ~accept[w];
+        }
+    }
+    accept['/' / 64] &= ~(1ULL << ('/' % 64));
+    accept[0] &= ~1ULL;
+    return i + 1;
+}
+
+
+static bool token_is_literal(const GlobToken *token, unsigned char *c) {
+    int bits = 0;
+    for (int w = 0; w < 4; w++) {
+        bits += __builtin_popcountll(token->accept[w]);
+        if (token->accept[w]) {
+            *c = w * 64 + __builtin_ctzll(token->accept[w]);
+        }
+    }
+    return !token->star && bits == 1;
+}
+
+
+/**
+ * @brief Compile un motif de nom de fichier (sans `/`).
+ *
+ * Le motif est découpé en éléments (`*`, `?`, classes, caractères), puis sa forme
+ * est reconnue : un seul `*` entouré de texte littéral (`*.log`, `core*`,
+ * `a*.c`) est comparé avec memcmp, sans automate. Un `\` rend littéral le
+ * caractère suivant : expand_pattern traduit ainsi les jokers entre guillemets.
+ *
+ * @param glob Motif compilé à remplir.
+ * @param pattern Motif.
+ * @param len Longueur du motif.
+ * @return int 0 si réussi, -1 si la mémoire est épuisée ou le motif trop long.
+ */
+int glob_compile(GlobPattern *glob, const char *pattern, size_t len) {
+    memset(glob, 0, sizeof(GlobPattern));
+    glob->match_dot = (len > 0 && pattern[0] == '.') || (len > 1 && pattern[0] == '\\' && pattern[1] == '.');
+    if (len > GLOB_MAX_TOKENS) {
+        return -1;
+    }
+
+    glob->tokens = malloc((len + 1) * sizeof(GlobToken));
+    glob->literal = malloc(len + 1);
+    if (!glob->tokens || !glob->literal) {
+        perror("malloc failed");
+        glob_free(glob);
+        return -1;
+    }
+
+    int stars = 0, star_index = -1;
+    bool literal_only = true;
+    for (size_t i = 0; i < len; ) {
+        GlobToken *token = &glob->tokens[glob->num_tokens];
+        memset(token, 0, sizeof(GlobToken));
+        size_t used = 1;
+        if (pattern[i] == '*') {
+            // `**` dans un nom équivaut à `*`
+            while (i + used < len && pattern[i + used] == '*') {
+                used++;
+            }
+            token->star = true;
+            star_index = glob->num_tokens;
+            stars++;
+        } else if (pattern[i] == '?') {
+            memset(token->accept, 0xff, sizeof(token->accept));
+            token->accept[0] &= ~1ULL;
+            literal_only = false;
+        } else if (pattern[i] == '[' && (used = parse_class(pattern + i, len - i, token->accept)) > 0) {
+            literal_only = false;
+        } else {
+            // `\x` : x littéral (un `\` final reste lui-même)
+            used = pattern[i] == '\\' && i + 1 < len ? 2 : 1;
+            unsigned char c = pattern[i + used - 1];
+            memset(token->accept, 0, sizeof(token->accept));
+            token->accept[c / 64] = 1ULL << (c % 64);
+        }
+        glob->num_tokens++;
+        i += used;
+    }
+
+    // Un caractère de classe réduite à un octet (`[a]`) reste un littéral
+    unsigned char c;
+    if (!literal_only) {
+        literal_only = true;
+        for (int i = 0; i < glob->num_tokens && literal_only; i++) {
+            literal_only = glob->tokens[i].star || token_is_literal(&glob->tokens[i], &c);
+        }
+    }
+    if (!literal_only || stars > 1) {
+        // Texte littéral avant le premier joker et après le dernier : filtre memcmp avant l'automate
+        glob->kind = GLOB_GENERAL;
+        glob->min_len = glob->num_tokens - stars;
+        glob->has_star = stars > 0;
+        for (int i = 0; i < glob->num_tokens && token_is_literal(&glob->tokens[i], &c); i++) {
+            glob->literal[glob->prefix_len++] = c;
+        }
+        if (glob->num_tokens < 64) {
+            // Automate en parallèle sur les bits : un masque par octet possible
+            glob->char_masks = calloc(256, sizeof(uint64_t));
+            if (!glob->char_masks) {
+                perror("calloc failed");
+                glob_free(glob);
+                return -1;
+            }
+            for (int i = 0; i < glob->num_tokens; i++) {
+                if (glob->tokens[i].star) {
+                    glob->star_mask |= 1ULL << i;
+                    continue;
+                }
+                for (int b = 0; b < 256; b++) {
+                    if (glob->tokens[i].accept[b / 64] & (1ULL << (b % 64))) {
+                        glob->char_masks[b] |= 1ULL << i;
+                    }
+                }
+            }
+        }
+        if (stars > 0) {
+            for (int i = glob->num_tokens - 1; i >= 0 && token_is_literal(&glob->tokens[i], &c); i--) {
+                glob->suffix_len++;
+            }
+            for (int i = glob->num_tokens - (int)glob->suffix_len; i < glob->num_tokens; i++) {
+                token_is_literal(&glob->tokens[i], &c);
+                glob->literal[glob->prefix_len + i - (glob->num_tokens - glob->suffix_len)] = c;
+            }
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < glob->num_tokens; i++) {
+        if (!glob->tokens[i].star) {
+            token_is_literal(&glob->tokens[i], &c);
+            glob->literal[glob->prefix_len + glob->suffix_len] = c;
+            if (stars == 0 || i < star_index) {
+                glob->prefix_len++;
+            } else {
+                glob->suffix_len++;
+            }
+        }
+    }
+    if (stars == 0) {
+        glob->kind = GLOB_LITERAL;
+    } else if (glob->prefix_len == 0 && glob->suffix_len == 0) {
+        glob->kind = GLOB_ANY;
+    } else if (glob->suffix_len == 0) {
+        glob->kind = GLOB_PREFIX;
+    } else if (glob->prefix_len == 0) {
+        glob->kind = GLOB_SUFFIX;
+    } else {
+        glob->kind = GLOB_PREFIX_SUFFIX;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Simule l'automate d'un motif général sur un nom.
+ *
+ * L'état i signifie « les i premiers éléments du motif sont reconnus ». Tous les
+ * états possibles sont suivis en même temps dans un ensemble de bits : chaque
+ * caractère du nom n'est lu qu'une fois, sans retour arrière. Jusqu'à 63 éléments,
+ * l'ensemble tient dans un mot et une étape se réduit à un décalage et deux masques.
+ */
+static bool match_general(const GlobPattern *glob, const char *name, size_t len) {
+    int n = glob->num_tokens;
+
+    if (!glob->has_star) {
+        // Sans `*`, chaque élément reconnaît exactement un caractère
+        for (size_t k = 0; k < len; k++) {
+            unsigned char c = name[k];
+            if (!(glob->tokens[k].accept[c / 64] & (1ULL << (c % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (glob->char_masks) {
+        // Un `*` ne suit jamais un autre `*` : une seule propagation suffit
+        uint64_t star = glob->star_mask;
+        uint64_t states = 1 | ((1 & star) << 1);
+        for (size_t k = 0; k < len && states; k++) {
+            states = ((states & glob->char_masks[(unsigned char)name[k]]) << 1) | (states & star);
+            states |= (states & star) << 1;
+        }
+        return states & (1ULL << n);
+    }
+
+    int words = n / 64 + 1;
+    uint64_t states[GLOB_MAX_TOKENS / 64 + 1], next[GLOB_MAX_TOKENS / 64 + 1];
+
+    memset(states, 0, words * sizeof(uint64_t));
+    states[0] = 1;
+    // Un `*` peut ne rien reconnaître : l'état suivant est aussi actif
+    for (int i = 0; i < n && glob->tokens[i].star; i++) {
+        states[(i + 1) / 64] |= 1ULL << ((i + 1) % 64);
     }
 
-    char **matches = malloc(100 * sizeof(char *));
+    for (size_t k = 0; k < len; k++) {
+        unsigned char c = name[k];
+        bool any = false;
+        memset(next, 0, words * sizeof(uint64_t));
+        for (int w = 0; w < words; w++) {
+            for (uint64_t bits = states[w]; bits; bits &= bits - 1) {
+                int i = w * 64 + __builtin_ctzll(bits);
+                if (i == n) {
+                    continue;
+                }
+                const GlobToken *token = &glob->tokens[i];
+                if (token->star) {
+                    next[w] |= 1ULL << (i % 64);
+                    any = true;
+                } else if (token->accept[c / 64] & (1ULL << (c % 64))) {
+                    next[(i + 1) / 64] |= 1ULL << ((i + 1) % 64);
+                    any = true;
+                }
+            }
+        }
+        if (!any) {
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            if (glob->tokens[i].star && (next[i / 64] & (1ULL << (i % 64)))) {
+                next[(i + 1) / 64] |= 1ULL << ((i + 1) % 64);
+            }
+        }
+        memcpy(states, next, words * sizeof(uint64_t));
+    }
+    return states[n / 64] & (1ULL << (n % 64));
+}
+
+
+/**
+ * @brief Compare un nom de fichier à un motif compilé.
+ *
+ * Un nom qui commence par `.` ne correspond que si le motif commence lui aussi par `.`.
+ *
+ * @param glob Motif compilé.
+ * @param name Nom de fichier.
+ * @param len Longueur du nom.
+ * @return bool `true` si le nom correspond.
+ */
+bool glob_match(const GlobPattern *glob, const char *name, size_t len) {
+    if (name[0] == '.' && !glob->match_dot) {
+        return false;
+    }
+    const char *suffix = glob->literal + glob->prefix_len;
+    switch (glob->kind) {
+        case GLOB_LITERAL:
+            return len == glob->prefix_len && memcmp(name, glob->literal, len) == 0;
+        case GLOB_ANY:
+            return true;
+        case GLOB_PREFIX:
+            return len >= glob->prefix_len && memcmp(name, glob->literal, glob->prefix_len) == 0;
+        case GLOB_SUFFIX:
+            return len >= glob->suffix_len && memcmp(name + len - glob->suffix_len, suffix, glob->suffix_len) == 0;
+        case GLOB_PREFIX_SUFFIX:
+            return len >= glob->prefix_len + glob->suffix_len &&
+                   memcmp(name, glob->literal, glob->prefix_len) == 0 &&
+                   memcmp(name + len - glob->suffix_len, suffix, glob->suffix_len) == 0;
+        case GLOB_GENERAL:
+            if (len < glob->min_len || (!glob->has_star && len != glob->min_len) ||
+                memcmp(name, glob->literal, glob->prefix_len) != 0 ||
+                memcmp(name + len - glob->suffix_len, suffix, glob->suffix_len) != 0) {
+                return false;
+            }
+            return match_general(glob, name, len);
+    }
+    return false;
+}
+
+
+void glob_free(GlobPattern *glob) {
+    free(glob->char_masks);
+    glob->char_masks = NULL;
+    free(glob->tokens);
+    free(glob->literal);
+    glob->tokens = NULL;
+    glob->literal = NULL;
+}
+
+
+/**
+ * @brief Chemins trouvés, accumulés dans un seul tampon avant d'être triés.
+ */
+typedef struct {
+    char *pool;        ///< Chemins terminés par '\0', les uns à la suite des autres.
+    size_t pool_len;
+    size_t pool_cap;
+    size_t *offsets;   ///< Début de chaque chemin dans `pool`.
+    int count;
+    int cap;
+} MatchList;
+
+
+static int add_match(MatchList *list, const char *dir, size_t dir_len, const char *name, size_t len) {
+    if (list->pool_len + dir_len + len + 1 > list->pool_cap) {
+        size_t cap = list->pool_cap ? list->pool_cap * 2 : 4096;
+        while (cap < list->pool_len + dir_len + len + 1) {
+            cap *= 2;
+        }
+        char *pool = realloc(list->pool, cap);
+        if (!pool) {
+            perror("realloc failed");
+            return -1;
+        }
+        list->pool = pool;
+        list->pool_cap = cap;
+    }
+    if (list->count == list->cap) {
+        int cap = list->cap ? list->cap * 2 : 64;
+        size_t *offsets = realloc(list->offsets, cap * sizeof(size_t));
+        if (!offsets) {
+            perror("realloc failed");
+            return -1;
+        }
+        list->offsets = offsets;
+        list->cap = cap;
+    }
+
+    list->offsets[list->count++] = list->pool_len;
+    memcpy(list->pool + list->pool_len, dir, dir_len);
+    memcpy(list->pool + list->pool_len + dir_len, name, len + 1);
+    list->pool_len += dir_len + len + 1;
+    return 0;
+}
+
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+
+/**
+ * @brief Range les chemins trouvés dans un seul bloc trié : le tableau de
+ * pointeurs, puis les chaînes.
+ */
+static char **finish_matches(MatchList *list) {
+    char **matches = malloc((list->count + 1) * sizeof(char *) + list->pool_len);
     if (!matches) {
         perror("malloc failed");
-        closedir(dir);
         return NULL;
     }
+    char *strings = (char *)(matches + list->count + 1);
+    if (list->pool_len > 0) {
+        memcpy(strings, list->pool, list->pool_len);
+    }
+    for (int i = 0; i < list->count; i++) {
+        matches[i] = strings + list->offsets[i];
+    }
+    matches[list->count] = NULL;
+    qsort(matches, list->count, sizeof(char *), compare_paths);
+    return matches;
+}
 
-    *num_matches = 0;
-    size_t capacity = 100;
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        
-        if (entry->d_name[0] == '.' && search_pattern[0] != '.') {
-            continue;
+/**
+ * @brief Composant d'un motif de chemin (entre deux `/`).
+ */
+typedef struct {
+    GlobPattern glob;
+    bool globstar;  ///< `**` : zéro, un ou plusieurs répertoires.
+} Segment;
+
+/**
+ * @brief Répertoire à lire : chemin tel qu'il sera affiché, et composant à lui appliquer.
+ */
+typedef struct Task {
+    struct Task *next;
+    int segment;
+    size_t len;
+    char path[];    ///< Vide (répertoire courant) ou terminé par `/`.
+} Task;
+
+/**
+ * @brief Parcours partagé par les threads d'une expansion.
+ */
+typedef struct {
+    Segment *segments;
+    int num_segments;
+    bool dirs_only;         ///< Motif terminé par `/` : seuls les répertoires correspondent.
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    Task *queue;            ///< Répertoires à lire (pile : parcours en profondeur).
+    int pending;            ///< Répertoires en attente ou en cours de lecture.
+} Walk;
+
+/**
+ * @brief État propre à un thread du parcours.
+ */
+typedef struct {
+    Walk *walk;
+    MatchList matches;
+    char *buffer;           ///< Tampon de getdents64.
+    char *path;             ///< Tampon de construction des chemins.
+    size_t path_cap;
+    pthread_t thread;
+} Worker;
+
+/**
+ * @brief Écrit `path` + `name` + `suffix` dans le tampon de chemins du thread.
+ */
+static const char *join_path(Worker *worker, const char *path, size_t path_len,
+                             const char *name, size_t len, const char *suffix) {
+    size_t total = path_len + len + strlen(suffix) + 1;
+    // `path` peut être le résultat précédent, dans le même tampon
+    bool in_place = path == worker->path;
+    if (total > worker->path_cap) {
+        size_t cap = worker->path_cap ? worker->path_cap : 256;
+        while (cap < total) {
+            cap *= 2;
         }
+        char *buffer = realloc(worker->path, cap);
+        if (!buffer) {
+            perror("realloc failed");
+            return NULL;
+        }
+        worker->path = buffer;
+        worker->path_cap = cap;
+    }
+    if (!in_place) {
+        memcpy(worker->path, path, path_len);
+    }
+    memcpy(worker->path + path_len, name, len);
+    strcpy(worker->path + path_len + len, suffix);
+    return worker->path;
+}
+
+
+static void push_task(Walk *walk, const char *path, size_t len, int segment) {
+    Task *task = malloc(sizeof(Task) + len + 1);
+    if (!task) {
+        perror("malloc failed");
+        return;
+    }
+    task->segment = segment;
+    task->len = len;
+    memcpy(task->path, path, len + 1);
 
-        if (fnmatch(search_pattern, entry->d_name, FNM_NOESCAPE) == 0) {
-            size_t full_path_len = strlen(dir_path) + 1 + strlen(entry->d_name) + 1;
-            if (full_path_len > 1024) {
-                fprintf(stderr, "Path is too long: %s/%s\n", dir_path, entry->d_name);
-                continue;
+    pthread_mutex_lock(&walk->lock);
+    task->next = walk->queue;
+    walk->queue = task;
+    walk->pending++;
+    pthread_cond_signal(&walk->cond);
+    pthread_mutex_unlock(&walk->lock);
+}
+
+
+/**
+ * @brief Indique si une entrée est un répertoire, d'après d_type si possible.
+ *
+ * @param follow Suivre un lien symbolique (composants intermédiaires) ou non (`**`).
+ */
+static bool entry_is_dir(int dirfd, const char *name, unsigned char type, bool follow) {
+    if (type == DT_DIR) {
+        return true;
+    }
+    if (type != DT_UNKNOWN && (type != DT_LNK || !follow)) {
+        return false;
+    }
+    struct stat st;
+    return fstatat(dirfd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+/**
+ * @brief Poursuit le motif sous un répertoire déjà reconnu.
+ *
+ * Les composants littéraux sont ajoutés au chemin sans lire de répertoire ; un
+ * chemin entièrement littéral est vérifié par un seul fstatat. Le premier
+ * composant avec jokers devient une tâche.
+ *
+ * @param path Chemin du répertoire, vide ou terminé par `/`.
+ * @param segment Premier composant à appliquer.
+ */
+static void descend(Worker *worker, const char *path, size_t len, int segment) {
+    Walk *walk = worker->walk;
+    char *prefix = NULL;
+
+    while (segment < walk->num_segments && walk->segments[segment].glob.kind == GLOB_LITERAL &&
+           !walk->segments[segment].globstar) {
+        const GlobPattern *glob = &walk->segments[segment].glob;
+        bool last = segment == walk->num_segments - 1;
+        const char *joined = join_path(worker, path, len, glob->literal, glob->prefix_len,
+                                       last && !walk->dirs_only ? "" : "/");
+        if (!joined) {
+            break;
+        }
+        size_t joined_len = strlen(joined);
+        if (last) {
+            struct stat st;
+            if (fstatat(AT_FDCWD, joined, &st, walk->dirs_only ? 0 : AT_SYMLINK_NOFOLLOW) == 0 &&
+                (!walk->dirs_only || S_ISDIR(st.st_mode))) {
+                add_match(&worker->matches, joined, joined_len, "", 0);
+            }
+            free(prefix);
+            return;
+        }
+        char *copy = malloc(joined_len + 1);
+        if (!copy) {
+            perror("malloc failed");
+            break;
+        }
+        memcpy(copy, joined, joined_len + 1);
+        free(prefix);
+        prefix = copy;
+        path = prefix;
+        len = joined_len;
+        segment++;
+    }
+
+    if (segment < walk->num_segments) {
+        // `dir/**` désigne aussi `dir/` lui-même
+        if (len > 0 && segment == walk->num_segments - 1 && walk->segments[segment].globstar) {
+            add_match(&worker->matches, path, len, "", 0);
+        }
+        push_task(walk, path, len, segment);
+    }
+    free(prefix);
+}
+
+
+/**
+ * @brief Applique le composant `segment` à une entrée d'un répertoire.
+ *
+ * `segment == num_segments` n'arrive qu'après un `**` final : toute entrée visible convient.
+ */
+static void visit_entry(Worker *worker, int dirfd, const Task *task, const char *name, size_t len,
+                        unsigned char type, int segment) {
+    Walk *walk = worker->walk;
+    bool last = segment >= walk->num_segments - 1;
+
+    if (segment == walk->num_segments) {
+        if (name[0] == '.') {
+            return;
+        }
+    } else if (!glob_match(&walk->segments[segment].glob, name, len)) {
+        return;
+    }
+
+    if (last) {
+        if (walk->dirs_only) {
+            const char *joined = entry_is_dir(dirfd, name, type, true) ?
+                                 join_path(worker, task->path, task->len, name, len, "/") : NULL;
+            if (joined) {
+                add_match(&worker->matches, joined, strlen(joined), "", 0);
             }
+        } else {
+            add_match(&worker->matches, task->path, task->len, name, len);
+        }
+        return;
+    }
+
+    if (entry_is_dir(dirfd, name, type, true)) {
+        const char *joined = join_path(worker, task->path, task->len, name, len, "/");
+        if (joined) {
+            descend(worker, joined, strlen(joined), segment + 1);
+        }
+    }
+}
+
 
-            char *full_match = malloc(full_path_len);
-            if (!full_match) {
-                perror("malloc failed");
-                continue;
+/**
+ * @brief Lit un répertoire (dir_cache_read) et applique son composant à chaque entrée.
+ *
+ * Pour `**`, chaque entrée est aussi comparée au composant suivant (zéro répertoire),
+ * et chaque sous-répertoire visible (liens symboliques exclus) devient une nouvelle
+ * tâche pour le même `**`.
+ */
+static void read_directory(Worker *worker, const Task *task) {
+    Walk *walk = worker->walk;
+    const Segment *segment = &walk->segments[task->segment];
+
+    int fd = openat(AT_FDCWD, task->len ? task->path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+    const DirListing *listing = dir_cache_read(fd, worker->buffer, GLOB_DIRENT_BUFFER);
+    if (!listing) {
+        close(fd);
+        return;
+    }
+
+    for (size_t i = 0; i < listing->count; i++) {
+        const DirEntry *entry = &listing->entries[i];
+        const char *name = listing->names + entry->name;
+        size_t len = entry->len;
+
+        if (!segment->globstar) {
+            visit_entry(worker, fd, task, name, len, entry->type, task->segment);
+            continue;
+        }
+        visit_entry(worker, fd, task, name, len, entry->type, task->segment + 1);
+        if (name[0] != '.' && entry_is_dir(fd, name, entry->type, false)) {
+            const char *joined = join_path(worker, task->path, task->len, name, len, "/");
+            if (joined) {
+                push_task(walk, joined, strlen(joined), task->segment);
             }
+        }
+    }
+    dir_cache_release(listing);
+    close(fd);
+}
 
-            snprintf(full_match, full_path_len, "%s/%s", dir_path, entry->d_name);
-            matches[*num_matches] = full_match;
-            (*num_matches)++;
 
-            
-            if (*num_matches >= capacity) {
-                capacity += 100;
-                char **temp = realloc(matches, capacity * sizeof(char *));
-                if (!temp) {
-                    perror("realloc failed");
-                    break;
+/**
+ * @brief Boucle d'un thread : lit des répertoires jusqu'à ce qu'il n'y en ait plus
+ * à lire ni en cours de lecture.
+ */
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    Walk *walk = worker->walk;
+
+    pthread_mutex_lock(&walk->lock);
+    while (1) {
+        while (!walk->queue && walk->pending > 0) {
+            pthread_cond_wait(&walk->cond, &walk->lock);
+        }
+        Task *task = walk->queue;
+        if (!task) {
+            break;
+        }
+        walk->queue = task->next;
+        pthread_mutex_unlock(&walk->lock);
+
+        read_directory(worker, task);
+        free(task);
+
+        pthread_mutex_lock(&walk->lock);
+        if (--walk->pending == 0) {
+            pthread_cond_broadcast(&walk->cond);
+        }
+    }
+    pthread_mutex_unlock(&walk->lock);
+    return NULL;
+}
+
+
+/**
+ * @brief Découpe un motif de chemin en composants compilés.
+ *
+ * @return int Nombre de composants, ou -1 en cas d'erreur.
+ */
+static int compile_segments(const char *pattern, Segment **segments) {
+    int count = 1;
+    for (const char *c = pattern; *c; c++) {
+        count += *c == '/';
+    }
+    *segments = calloc(count, sizeof(Segment));
+    if (!*segments) {
+        perror("calloc failed");
+        return -1;
+    }
+
+    int n = 0;
+    const char *start = pattern;
+    while (*start) {
+        const char *end = strchrnul(start, '/');
+        size_t len = end - start;
+        // `a//b` équivaut à `a/b`, et `**/**` à `**`
+        bool globstar = len == 2 && start[0] == '*' && start[1] == '*';
+        if (len > 0 && !(globstar && n > 0 && (*segments)[n - 1].globstar)) {
+            (*segments)[n].globstar = globstar;
+            if (glob_compile(&(*segments)[n].glob, start, len) == -1) {
+                for (int i = 0; i < n; i++) {
+                    glob_free(&(*segments)[i].glob);
                 }
-                matches = temp;
+                free(*segments);
+                return -1;
             }
+            n++;
         }
+        start = *end ? end + 1 : end;
     }
+    return n;
+}
+
 
-    closedir(dir);
+/**
+ * @brief Étend un motif de chemin contenant des jokers (`*`, `?`, `[...]`, `**`).
+ * 
+ * Chaque composant du motif est compilé une fois (glob_compile). Le parcours lit
+ * les répertoires par lots avec getdents64, à travers le cache de dir_cache.h qui
+ * évite de relire un répertoire inchangé, et se sert de d_type pour éviter les
+ * stat ; les composants littéraux (`src/`) ne sont pas lus, seulement traversés.
+ * `**` désigne zéro, un ou plusieurs répertoires (sans suivre les liens
+ * symboliques ni entrer dans les répertoires cachés). Dès que plusieurs
+ * répertoires peuvent être lus, ils sont répartis sur un groupe de threads.
+ * 
+ * Les chemins sont renvoyés triés (ordre des octets), donc dans le même ordre quel
+ * que soit le nombre de threads, et tels que l'utilisateur les a écrits : `*.c`
+ * donne `main.c`, `src/m*.c` donne `src/main.c`. Un motif terminé par `/` ne
+ * désigne que des répertoires.
+ * 
+ * @param pattern Le motif contenant des jokers à étendre.
+ * @param num_matches Reçoit le nombre de correspondances trouvées.
+ * @return char** Tableau des chemins terminé par `NULL`, ou `NULL` en cas d'erreur.
+ * 
+ * @note Le tableau et ses chaînes forment un seul bloc, libéré par free_matches.
+ */
+char **expand_wildcard(const char *pattern, int *num_matches) {
+    long long span = trace_begin();
+    Walk walk = { .queue = NULL, .pending = 0 };
+    size_t pattern_len = strlen(pattern);
+
+    *num_matches = 0;
+    walk.num_segments = compile_segments(pattern, &walk.segments);
+    if (walk.num_segments <= 0) {
+        if (walk.num_segments == 0) {
+            free(walk.segments);
+        }
+        return NULL;
+    }
+    walk.dirs_only = pattern_len > 1 && pattern[pattern_len - 1] == '/';
+    pthread_mutex_init(&walk.lock, NULL);
+    pthread_cond_init(&walk.cond, NULL);
+
+    // Un seul répertoire à lire (`*.c`, `src/*.c`) : pas de threads
+    int listed = 0;
+    for (int i = 0; i < walk.num_segments; i++) {
+        listed += walk.segments[i].globstar ? 2 : walk.segments[i].glob.kind != GLOB_LITERAL;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_workers = listed > 1 ? (cpus > GLOB_MAX_THREADS ? GLOB_MAX_THREADS : cpus > 1 ? cpus : 1) : 1;
+
+    Worker workers[GLOB_MAX_THREADS];
+    memset(workers, 0, sizeof(workers));
+    bool ok = true;
+    for (int i = 0; i < num_workers; i++) {
+        workers[i].walk = &walk;
+        workers[i].buffer = malloc(GLOB_DIRENT_BUFFER);
+        ok = ok && workers[i].buffer;
+    }
+
+    if (ok) {
+        descend(&workers[0], pattern[0] == '/' ? "/" : "", pattern[0] == '/', 0);
+        int started = 1;
+        while (started < num_workers &&
+               pthread_create(&workers[started].thread, NULL, worker_main, &workers[started]) == 0) {
+            started++;
+        }
+        worker_main(&workers[0]);
+        for (int i = 1; i < started; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+    } else {
+        perror("malloc failed");
+    }
+
+    // Regroupement des résultats de tous les threads, puis tri
+    MatchList *list = &workers[0].matches;
+    for (int i = 1; i < num_workers; i++) {
+        for (int j = 0; j < workers[i].matches.count; j++) {
+            const char *path = workers[i].matches.pool + workers[i].matches.offsets[j];
+            add_match(list, path, strlen(path), "", 0);
+        }
+    }
+    char **matches = finish_matches(list);
+    if (matches) {
+        *num_matches = list->count;
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        free(workers[i].matches.pool);
+        free(workers[i].matches.offsets);
+        free(workers[i].buffer);
+        free(workers[i].path);
+    }
+    for (int i = 0; i < walk.num_segments; i++) {
+        glob_free(&walk.segments[i].glob);
+    }
+    free(walk.segments);
+    pthread_mutex_destroy(&walk.lock);
+    pthread_cond_destroy(&walk.cond);
+    trace_end(span, "expand", "glob", pattern);
     return matches;
 }
 
 
 void free_matches(char **matches, int num_matches) {
-    if (!matches) return;
-    for (int i = 0; i < num_matches; i++) {
-        free(matches[i]);
-    }
+    (void)num_matches;
     free(matches);
 }
@@ -0,0 +1,207 @@
+#include "../include/work_pool.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/**
+ * @brief File à deux bouts d'un thread : il prend ses tâches en bas, les autres volent en haut.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    void **items;               ///< Tableau circulaire.
+    size_t head;                ///< Élément du haut (le plus ancien).
+    size_t count;
+    size_t cap;
+} WorkDeque;
+
+typedef struct {
+    WorkPool *pool;
+    int index;
+    WorkDeque deque;
+    pthread_t thread;
+} WorkThread;
+
+struct WorkPool {
+    WorkFunction function;
+    void *context;
+    WorkThread *threads;
+    int num_threads;
+    int started;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        ///< Signalé quand une tâche est ajoutée ou que tout est fini.
+    int idle;                   ///< Threads endormis faute de tâche (protégé par `lock`).
+    atomic_size_t queued;       ///< Tâches en file.
+    atomic_size_t pending;      ///< Tâches en file ou en cours.
+};
+
+
+static bool deque_push(WorkDeque *deque, void *item) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->cap) {
+        size_t cap = deque->cap ? deque->cap * 2 : 64;
+        void **items = malloc(cap * sizeof(void *));
+        if (!items) {
+            pthread_mutex_unlock(&deque->lock);
+            return false;
+        }
+        for (size_t i = 0; i < deque->count; i++) {
+            items[i] = deque->items[(deque->head + i) % deque->cap];
+        }
+        free(deque->items);
+        deque->items = items;
+        deque->head = 0;
+        deque->cap = cap;
+    }
+    deque->items[(deque->head + deque->count++) % deque->cap] = item;
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+
+/**
+ * @brief Prend la tâche du bas (la plus récente), ou celle du haut pour un vol.
+ */
+static void *deque_take(WorkDeque *deque, bool steal) {
+    void *item = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        if (steal) {
+            item = deque->items[deque->head];
+            deque->head = (deque->head + 1) % deque->cap;
+        } else {
+            item = deque->items[(deque->head + deque->count - 1) % deque->cap];
+        }
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return item;
+}
+
+
+WorkPool *work_pool_create(int num_workers, WorkFunction function, void *context) {
+    WorkPool *pool = calloc(1, sizeof(WorkPool));
+    WorkThread *threads = calloc(num_workers > 0 ? num_workers : 1, sizeof(WorkThread));
+    if (!pool || !threads) {
+        free(pool);
+        free(threads);
+        return NULL;
+    }
+    pool->function = function;
+    pool->context = context;
+    pool->threads = threads;
+    pool->num_threads = num_workers > 0 ? num_workers : 1;
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    for (int i = 0; i < pool->num_threads; i++) {
+        threads[i].pool = pool;
+        threads[i].index = i;
+        pthread_mutex_init(&threads[i].deque.lock, NULL);
+    }
+    return pool;
+}
+
+
+bool work_pool_push(WorkPool *pool, int worker, void *item) {
+    // Comptée avant d'être visible : un voleur ne peut pas la terminer avant
+    atomic_fetch_add(&pool->pending, 1);
+    atomic_fetch_add(&pool->queued, 1);
+    if (!deque_push(&pool->threads[worker].deque, item)) {
+        atomic_fetch_sub(&pool->queued, 1);
+        atomic_fetch_sub(&pool->pending, 1);
+        return false;
+    }
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle > 0) {
+        pthread_cond_signal(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+
+/**
+ * @brief Prend une tâche dans la file du thread, sinon en vole une aux autres.
+ */
+static void *take_item(WorkThread *thread) {
+    WorkPool *pool = thread->pool;
+    void *item = deque_take(&thread->deque, false);
+    for (int i = 1; !item && i < pool->num_threads; i++) {
+        item = deque_take(&pool->threads[(thread->index + i) % pool->num_threads].deque, true);
+    }
+    if (item) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+    return item;
+}
+
+
+/**
+ * @brief Boucle d'un thread : traite des tâches jusqu'à ce qu'il n'y en ait plus
+ * en file ni en cours.
+ */
+static void *work_thread_main(void *arg) {
+    WorkThread *thread = arg;
+    WorkPool *pool = thread->pool;
+
+    while (1) {
+        void *item = take_item(thread);
+        if (item) {
+            pool->function(pool, thread->index, item, pool->context);
+            if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_broadcast(&pool->cond);
+                pthread_mutex_unlock(&pool->lock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        pool->idle++;
+        while (atomic_load(&pool->queued) == 0 && atomic_load(&pool->pending) > 0) {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+        pool->idle--;
+        bool finished = atomic_load(&pool->pending) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (finished) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+
+int work_pool_start(WorkPool *pool) {
+    while (pool->started < pool->num_threads &&
+           pthread_create(&pool->threads[pool->started].thread, NULL, work_thread_main,
+                          &pool->threads[pool->started]) == 0) {
+        pool->started++;
+    }
+    // Les files des threads non démarrés restent vides : les voler est sans effet
+    return pool->started;
+}
+
+
+void work_pool_wait(WorkPool *pool) {
+    if (pool->started == 0) {
+        work_thread_main(&pool->threads[0]);
+    }
+    for (int i = 0; i < pool->started; i++) {
+        pthread_join(pool->threads[i].thread, NULL);
+    }
+    pool->started = 0;
+}
+
+
+void work_pool_destroy(WorkPool *pool) {
+    for (int i = 0; i < pool->num_threads; i++) {
+        free(pool->threads[i].deque.items);
+        pthread_mutex_destroy(&pool->threads[i].deque.lock);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
@@ -0,0 +1,19 @@
+# Bornes de l'arithmétique sur 64 bits et division par zéro
+echo $(( (-9223372036854775807 - 1) / -1 ))
+echo $(( (-9223372036854775807 - 1) % -1 ))
+echo $(( 9223372036854775807 + 1 ))
+echo $(( 1 << 63 )) $(( ~0 ))
+echo $(( 7 / 0 ))
+echo "after division $?"
+echo $(( 7 % 0 ))
+echo $(( 2 ** -1 ))
+echo $(( -7 / 2 )) $(( -7 % 2 )) $(( 2 ** 10 )) $(( ( 1 + 2 ) * 3 ))
+# Court-circuit : le côté non évalué ne divise pas par zéro
+echo $(( 1 ? 2 : 3 )) $(( 0 && 1 / 0 )) $(( 1 || 1 / 0 ))
+set n=5
+echo $(( n++ )) $n $(( --n )) $(( n *= 3 )) $n
+echo $(( 010 )) $(( 0x1F ))
+# Une expansion n'est évaluée qu'une fois, même si le joker ne correspond à rien
+set n=1
+echo $(( n += 1 ))zz*
+echo $n
@@ -0,0 +1,36 @@
+# Boucles imbriquées avec break et continue, au niveau courant et sur plusieurs niveaux
+set i=0
+while [ $i -lt 3 ]; do
+    for x in a b c d; do
+        if [ $x = b ]; then continue; fi
+        if [ $x = d ]; then break; fi
+        echo "$i $x"
+    done
+    set i=$((i + 1))
+done
+for a in 1 2; do
+    for b in 1 2 3; do
+        if [ $b = 2 ]; then continue 2; fi
+        echo "continue 2: $a$b"
+    done
+    echo unreachable
+done
+for a in 1 2; do
+    for b in 1 2 3; do
+        if [ $b = 2 ]; then break 2; fi
+        echo "break 2: $a$b"
+    done
+done
+until [ $i -eq 0 ]; do
+    set i=$((i - 1))
+    if [ $i -eq 1 ]; then continue; fi
+    echo "until $i"
+done
+set n=0
+while true; do
+    set n=$((n + 1))
+    for x in a b; do
+        while true; do break 3; done
+    done
+done
+echo "n=$n"
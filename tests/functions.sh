@@ -0,0 +1,39 @@
+# return au milieu d'un for : la boucle et la fonction s'arrêtent
+first_above() {
+    for v in 1 5 4 7; do
+        if [ $v -gt $1 ]; then
+            echo "found $v"
+            return 3
+        fi
+        echo "skip $v"
+    done
+    return 1
+}
+first_above 4
+echo "status $?"
+first_above 9
+echo "status $?"
+# Récursion bornée et récursion infinie arrêtée à la profondeur maximale
+countdown() {
+    if [ $1 -le 0 ]; then
+        echo liftoff
+        return
+    fi
+    echo $1
+    countdown $(($1 - 1))
+}
+countdown 3
+forever() {
+    forever
+}
+forever
+echo "after forever $?"
+nested() {
+    for i in 1 2; do
+        for j in 1 2; do
+            if [ $j = 2 ]; then return $i$j; fi
+        done
+    done
+}
+nested
+echo "nested $?"
@@ -0,0 +1,15 @@
+# `**` et jokers, comparés à bash avec `shopt -s globstar`
+mkdir -p a/b/c a/.hidden d
+touch a/x.c a/b/y.c a/b/c/z.c a/.hidden/h.c d/w.h top.c
+echo **/*.c
+echo a/**/*.c
+echo **/
+echo a/**
+echo **/*.nomatch
+echo **/[xz].c
+echo */*/*.c
+echo **/b
+# Jokers protégés : littéraux
+echo "**"/*.c
+echo \*/*.c
+echo '*'.c
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Tests de non-régression : chaque tests/NOM.sh est exécuté par mysh dans un
+# répertoire temporaire vide, et sa sortie (stdout puis stderr) est comparée à
+# tests/NOM.out.
+#
+# Usage : tests/run.sh [mysh]      (depuis la racine du projet : make test)
+
+MYSH=$(cd "$(dirname "${1:-./mysh}")" && pwd)/$(basename "${1:-./mysh}")
+TESTS=$(cd "$(dirname "$0")" && pwd)
+# Segment d'environnement propre aux tests : les shells ouverts ne sont pas touchés
+MYSH_ENV_SEGMENT=/mysh-test-$$
+export MYSH_ENV_SEGMENT
+
+passed=0
+failed=0
+for script in "$TESTS"/*.sh; do
+    name=$(basename "$script" .sh)
+    [ "$name" = run ] && continue
+
+    scratch=$(mktemp -d)
+    (cd "$scratch" && "$MYSH" "$script" > "$scratch/.stdout" 2> "$scratch/.stderr")
+    cat "$scratch/.stdout" "$scratch/.stderr" > "$scratch/.actual"
+
+    if diff -u "$TESTS/$name.out" "$scratch/.actual"; then
+        passed=$((passed + 1))
+        echo "ok   $name"
+    else
+        failed=$((failed + 1))
+        echo "FAIL $name"
+    fi
+    rm -rf "$scratch"
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]